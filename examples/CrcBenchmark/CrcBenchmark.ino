@@ -0,0 +1,74 @@
+/*
+ * Measures crc16(), crc32() and crc32c() against a bitwise CRC, printing MB/s and cycles per
+ * byte for a few buffer sizes, e.g. a link frame, a log block and a flash sector.
+ *
+ * Buffers are in internal RAM and warm in the cache, as the data being checked usually is.
+ */
+
+#include <Arduino.h>
+#include <crc.h>
+
+static const size_t SIZES[] = {64, 1024, 4096};
+static const uint32_t BYTES_PER_RUN = 1 << 20;
+
+static uint8_t buf[4096];
+static volatile uint32_t sink;
+
+static uint32_t bitwiseCrc32(const uint8_t *data, size_t len, uint32_t crc) {
+    crc = ~crc;
+    for (size_t i = 0; i < len; i++) {
+        crc ^= data[i];
+        for (auto k = 0; k < 8; k++) {
+            crc = (crc >> 1) ^ (0xedb88320 & -(crc & 1));
+        }
+    }
+    return ~crc;
+}
+
+template<class Fn>
+static void bench(const char *name, uint32_t init, Fn fn) {
+    for (auto size : SIZES) {
+        const auto runs = BYTES_PER_RUN / size;
+        auto crc = init;
+        const auto start = micros();
+        for (uint32_t i = 0; i < runs; i++) {
+            crc = fn(buf, size, crc);
+        }
+        const auto us = micros() - start;
+        sink = crc;
+        const auto bytes = static_cast<double>(runs * size);
+        Serial.printf("%-8s %5u bytes: %7.2f MB/s, %5.2f cycles/byte\n", name, static_cast<unsigned>(size),
+            bytes / us, static_cast<double>(us) * getCpuFrequencyMhz() / bytes);
+    }
+}
+
+static void check(const char *name, uint32_t value, uint32_t expected) {
+    Serial.printf("%-8s check 0x%08x %s\n", name, static_cast<unsigned>(value), value == expected ? "ok" : "WRONG");
+}
+
+void setup() {
+    Serial.begin(115200);
+    delay(1000);
+
+    for (size_t i = 0; i < sizeof(buf); i++) {
+        buf[i] = static_cast<uint8_t>(esp_random());
+    }
+
+    // the standard check values of "123456789"
+    const auto nine = reinterpret_cast<const uint8_t*>("123456789");
+    check("crc16", crc16(nine, 9), 0x29b1);
+    check("crc32", crc32(nine, 9), 0xcbf43926);
+    check("crc32c", crc32c(nine, 9), 0xe3069283);
+    check("bitwise", bitwiseCrc32(nine, 9, 0), 0xcbf43926);
+
+    bench("crc16", 0xffff, [](const uint8_t *data, size_t len, uint32_t crc) -> uint32_t {
+        return crc16(data, len, crc);
+    });
+    bench("crc32", 0, [](const uint8_t *data, size_t len, uint32_t crc) { return crc32(data, len, crc); });
+    bench("crc32c", 0, [](const uint8_t *data, size_t len, uint32_t crc) { return crc32c(data, len, crc); });
+    bench("bitwise", 0, bitwiseCrc32);
+}
+
+void loop() {
+    delay(1000);
+}
@@ -0,0 +1,74 @@
+/*
+ * Times each fastmath.h approximation against its libm counterpart, printing nanoseconds and
+ * cycles per call. Inputs cycle through a table within each function's domain, and results
+ * are summed so calls can't be optimized away. Accuracy is checked by test/host.
+ */
+
+#include <Arduino.h>
+#include <math.h>
+#include <fastmath.h>
+
+static const size_t INPUTS = 256;
+static const uint32_t CALLS = 100000;
+
+static float positive[INPUTS];  // 1e-3 .. 1e3
+static float angle[INPUTS];     // -pi .. pi
+static float sine[INPUTS];      // sinf(angle), so atan2 gets all four quadrants
+static float exponent[INPUTS];  // -20 .. 20
+static float pressure[INPUTS];  // 1 .. 110 kPa
+static volatile float sink;
+
+template<class Fn>
+static float measure(const char *name, Fn fn) {
+    float sum = 0;
+    const auto start = micros();
+    for (uint32_t i = 0; i < CALLS; i++) {
+        sum += fn(i % INPUTS);
+    }
+    const auto ns = (micros() - start) * 1000.0f / CALLS;
+    sink = sum;
+    Serial.printf("%-14s %7.1f ns, %6.1f cycles\n", name, ns, ns * getCpuFrequencyMhz() / 1000);
+    return ns;
+}
+
+template<class Fast, class Libm>
+static void compare(const char *fastName, Fast fast, const char *libmName, Libm libm) {
+    const auto f = measure(fastName, fast);
+    const auto l = measure(libmName, libm);
+    Serial.printf("%-14s %7.1fx faster\n", fastName, l / f);
+}
+
+void setup() {
+    Serial.begin(115200);
+    delay(1000);
+
+    for (size_t i = 0; i < INPUTS; i++) {
+        const auto u = static_cast<float>(i) / (INPUTS - 1);
+        positive[i] = powf(10, 6 * u - 3);
+        angle[i] = static_cast<float>(M_PI) * (2 * u - 1);
+        sine[i] = sinf(angle[i]);
+        exponent[i] = 40 * u - 20;
+        pressure[i] = 1000 + 109000 * u;
+    }
+
+    compare("fastInvSqrt", [](size_t i) { return fastInvSqrt(positive[i]); },
+        "1 / sqrtf", [](size_t i) { return 1 / sqrtf(positive[i]); });
+    compare("fastSqrt", [](size_t i) { return fastSqrt(positive[i]); },
+        "sqrtf", [](size_t i) { return sqrtf(positive[i]); });
+    compare("fastAtan2", [](size_t i) { return fastAtan2(sine[i], positive[i]); },
+        "atan2f", [](size_t i) { return atan2f(sine[i], positive[i]); });
+    compare("fastSin", [](size_t i) { return fastSin(angle[i]); },
+        "sinf", [](size_t i) { return sinf(angle[i]); });
+    compare("fastLog2", [](size_t i) { return fastLog2(positive[i]); },
+        "log2f", [](size_t i) { return log2f(positive[i]); });
+    compare("fastExp2", [](size_t i) { return fastExp2(exponent[i]); },
+        "exp2f", [](size_t i) { return exp2f(exponent[i]); });
+    compare("fastPow", [](size_t i) { return fastPow(positive[i], 1.5f); },
+        "powf", [](size_t i) { return powf(positive[i], 1.5f); });
+    compare("baroAltitude", [](size_t i) { return baroAltitude(pressure[i]); },
+        "powf formula", [](size_t i) { return 44330.0f * (1.0f - powf(pressure[i] / 101325.0f, 0.190295f)); });
+}
+
+void loop() {
+    delay(1000);
+}
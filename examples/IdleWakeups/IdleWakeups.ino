@@ -0,0 +1,137 @@
+/*
+ * Shows what wakeSlack() saves. Three periodic subsystems run alternately without and with
+ * slack, 10 s each, while an idle hook on core 0, where the subsystems run, measures:
+ *
+ *    task wakeups/s   subsystem.wakeups, the delayed task wakeups of waitForNextCycle()
+ *    CPU wakeups/s    distinct ticks at which any of them woke, from nextWakeTick()
+ *    idle             passes of the idle loop relative to an unloaded second
+ *    sleepable        ThreadedSubsystem::nextWakeTick() sampled once per idle tick: how many
+ *                     ticks tickless idle could sleep from there
+ *
+ * Slack doesn't change the work done, so task wakeups and idle stay about the same, while
+ * CPU wakeups drop and sleepable grows, by how much depends on the random phases the
+ * subsystems start with. The idle hook keeps core 0 spinning rather than
+ * waiting for interrupts, so don't measure power with it. Tickless idle itself needs no hook,
+ * it finds the coalesced wakeups in the kernel's delayed task list.
+ *
+ * test/host/bench_wakeups measures the same on the host.
+ */
+
+#include <Arduino.h>
+#include <esp_freertos_hooks.h>
+#include <subsystem.h>
+#include <metrics.h>
+#include <histogram.h>
+
+static const TickType_t SLACK = pdMS_TO_TICKS(5);
+static const uint32_t PHASE_MS = 10000;
+
+static volatile TickType_t slack = 0;
+
+class Periodic : public ThreadedSubsystem {
+public:
+    Periodic(const char *name, TickType_t period) : period(period), spec(this, nullptr) {
+        this->name = name;
+        SubsystemManager.addSubsystem(&spec);
+    }
+
+    Status setup() {
+        setStatus(READY);
+        return getStatus();
+    }
+
+protected:
+    TickType_t wakeSlack() const {
+        return slack;
+    }
+
+    void taskFunction(void */*parameter*/) {
+        for (;;) {
+            // stand in for reading a sensor
+            delayMicroseconds(200);
+            waitForNextCycle(period);
+        }
+    }
+
+private:
+    const TickType_t period;
+    SubsystemManagerClass::Spec spec;
+};
+
+static Periodic imu("imu", pdMS_TO_TICKS(20));
+static Periodic baro("baro", pdMS_TO_TICKS(30));
+static Periodic mag("mag", pdMS_TO_TICKS(50));
+
+static volatile uint32_t idlePasses = 0;
+static volatile uint32_t cpuWakeups = 0;
+static TickType_t lastIdleTick = 0;
+static TickType_t earliestWake = 0;
+static LatencyHistogram<> sleepable;
+
+// runs on every pass of the idle task's loop on core 0. Returning false keeps the loop spinning
+// instead of waiting for an interrupt, so the number of passes measures idle time
+static bool onIdle() {
+    idlePasses++;
+    const auto now = xTaskGetTickCount();
+    if (now == lastIdleTick) {
+        return false;
+    }
+    lastIdleTick = now;
+    const auto next = ThreadedSubsystem::nextWakeTick();
+    if (next == portMAX_DELAY) {
+        return false;
+    }
+    sleepable.record(next);
+    // the earliest wakeup moving later means it happened, once however many subsystems shared it
+    const auto wake = now + next;
+    if (static_cast<int32_t>(wake - earliestWake) > 0) {
+        cpuWakeups++;
+    }
+    earliestWake = wake;
+    return false;
+}
+
+static Counter *wakeups;
+static Counter *sharedWakeups;
+static uint32_t idlePassesPerSecond;
+
+void setup() {
+    Serial.begin(115200);
+    delay(1000);
+
+    if (esp_register_freertos_idle_hook_for_cpu(onIdle, 0) != ESP_OK) {
+        Serial.println("can't register the idle hook");
+    }
+    wakeups = static_cast<Counter*>(Metrics.find("subsystem.wakeups"));
+    sharedWakeups = static_cast<Counter*>(Metrics.find("subsystem.wakeups.shared"));
+
+    // calibrate while core 0 has nothing else to do
+    const auto passes = idlePasses;
+    delay(1000);
+    idlePassesPerSecond = std::max<uint32_t>(1, idlePasses - passes);
+
+    SubsystemManager.setup();
+    SubsystemManager.start();
+}
+
+void loop() {
+    const auto startWakeups = wakeups->value();
+    const auto startShared = sharedWakeups->value();
+    const auto startCpuWakeups = cpuWakeups;
+    const auto startPasses = idlePasses;
+    sleepable.reset();
+
+    delay(PHASE_MS);
+
+    const auto taskWakeups = wakeups->value() - startWakeups;
+    Serial.printf("slack %2u: %5.1f task wakeups/s (%4.1f%% shared), %5.1f CPU wakeups/s, %5.1f%% idle, "
+        "sleepable p50 %u p90 %u ticks\n",
+        static_cast<unsigned>(slack),
+        taskWakeups * 1000.0 / PHASE_MS,
+        100.0 * (sharedWakeups->value() - startShared) / std::max<uint32_t>(1, taskWakeups),
+        (cpuWakeups - startCpuWakeups) * 1000.0 / PHASE_MS,
+        100.0 * (idlePasses - startPasses) / idlePassesPerSecond / (PHASE_MS / 1000.0),
+        sleepable.percentile(500), sleepable.percentile(900));
+
+    slack = slack ? 0 : SLACK;
+}
@@ -0,0 +1,95 @@
+/*
+ * Times the matrix.h kernels at state sizes typical of attitude and navigation filters,
+ * printing microseconds and cycles per call:
+ *
+ *    multiply     N x N by N x N, esp-dsp's kernel when MATRIX_ESP_DSP is set
+ *    naive        the same with a plain dot product loop, for comparison
+ *    covariance   propagateCovariance(), p = f * p * transpose(f) + q
+ *    cholesky     cholesky() and choleskySolve() of one right hand side
+ *    invert       invert(), for comparison with solving
+ *
+ * Operands are globals in internal RAM, so timing excludes stack and PSRAM effects.
+ * test/host/bench_matrix is the same on the host.
+ */
+
+#include <Arduino.h>
+#include <matrix.h>
+
+static const uint32_t RUNS = 2000;
+
+static volatile float sink;
+
+template<size_t N>
+static void naiveMultiply(const Matrix<N, N> &a, const Matrix<N, N> &b, Matrix<N, N> &out) {
+    for (size_t r = 0; r < N; r++) {
+        for (size_t c = 0; c < N; c++) {
+            float sum = 0;
+            for (size_t k = 0; k < N; k++) {
+                sum += a.m[r][k] * b.m[k][c];
+            }
+            out.m[r][c] = sum;
+        }
+    }
+}
+
+template<class Fn>
+static void measure(const char *name, size_t n, Fn fn) {
+    const auto start = micros();
+    for (uint32_t i = 0; i < RUNS; i++) {
+        fn();
+    }
+    const auto us = static_cast<double>(micros() - start) / RUNS;
+    Serial.printf("%-10s %2u: %8.2f us, %8.0f cycles\n", name, static_cast<unsigned>(n), us, us * getCpuFrequencyMhz());
+}
+
+template<size_t N>
+static void bench() {
+    // a well conditioned symmetric positive definite p, f close to identity as in a filter
+    static Matrix<N, N> a, b, out, p, f, q, scratch, l;
+    static Vector<N> rhs, x;
+    for (size_t r = 0; r < N; r++) {
+        for (size_t c = 0; c < N; c++) {
+            a.m[r][c] = static_cast<float>(esp_random() % 1000) / 1000;
+            b.m[r][c] = static_cast<float>(esp_random() % 1000) / 1000;
+            f.m[r][c] = r == c ? 1 : 0.01f * a.m[r][c];
+            q.m[r][c] = r == c ? 1e-4f : 0;
+            p.m[r][c] = r == c ? N : 1.0f / (1 + r + c);
+        }
+        rhs[r] = b.m[r][0];
+    }
+    const auto p0 = p;
+
+    measure("multiply", N, [&]() { multiply(a, b, out); });
+    sink = out.m[N - 1][N - 1];
+    measure("naive", N, [&]() { naiveMultiply(a, b, out); });
+    sink = out.m[N - 1][N - 1];
+    measure("covariance", N, [&]() {
+        p = p0;
+        propagateCovariance(p, f, q, scratch);
+    });
+    sink = p.m[N - 1][N - 1];
+    measure("cholesky", N, [&]() {
+        if (cholesky(p0, l)) {
+            choleskySolve(l, rhs, x);
+        }
+    });
+    sink = x[N - 1];
+    measure("invert", N, [&]() { invert(p0, out, scratch); });
+    sink = out.m[N - 1][N - 1];
+}
+
+void setup() {
+    Serial.begin(115200);
+    delay(1000);
+#if MATRIX_ESP_DSP
+    Serial.println("multiply uses esp-dsp");
+#endif
+    bench<3>();
+    bench<6>();
+    bench<9>();
+    bench<15>();
+}
+
+void loop() {
+    delay(1000);
+}
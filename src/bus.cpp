@@ -0,0 +1,149 @@
+#include "bus.h"
+
+I2cBus::I2cBus(TwoWire &wire) : wire(wire) {}
+
+bool I2cBus::transfer(BusTransaction &txn) {
+    wire.beginTransmission(txn.address);
+    if (txn.txLen) {
+        wire.write(txn.tx, txn.txLen);
+    }
+    // repeated start if we're reading back
+    if (wire.endTransmission(txn.rxLen == 0) != 0) {
+        return false;
+    }
+    if (txn.rxLen == 0) {
+        return true;
+    }
+    if (wire.requestFrom(txn.address, txn.rxLen, true) != txn.rxLen) {
+        return false;
+    }
+    for (size_t i = 0; i < txn.rxLen; i++) {
+        txn.rx[i] = wire.read();
+    }
+    return true;
+}
+
+SpiBus::SpiBus(SPIClass &spi, const SPISettings &settings, const uint8_t *csPins, size_t numCsPins) :
+    spi(spi), settings(settings), csPins(csPins), numCsPins(numCsPins), configured(0) {}
+
+void SpiBus::deselect(uint8_t cs) {
+    // level first, so the pin doesn't glitch low when it becomes an output
+    digitalWrite(cs, HIGH);
+    pinMode(cs, OUTPUT);
+    if (cs < 64) {
+        configured |= 1ULL << cs;
+    }
+}
+
+bool SpiBus::begin() {
+    for (size_t i = 0; i < numCsPins; i++) {
+        deselect(csPins[i]);
+    }
+    return true;
+}
+
+bool SpiBus::transfer(BusTransaction &txn) {
+    if (txn.address >= 64 || !(configured & (1ULL << txn.address))) {
+        deselect(txn.address);
+    }
+    spi.beginTransaction(settings);
+    digitalWrite(txn.address, LOW);
+    if (txn.txLen) {
+        spi.transferBytes(txn.tx, nullptr, txn.txLen);
+    }
+    if (txn.rxLen) {
+        spi.transferBytes(nullptr, txn.rx, txn.rxLen);
+    }
+    digitalWrite(txn.address, HIGH);
+    spi.endTransaction();
+    return true;
+}
+
+MockBus::MockBus(uint32_t fixedMicros, uint32_t microsPerByte, DeviceFn *device, void *args) :
+    fixedMicros(fixedMicros), microsPerByte(microsPerByte), device(device), args(args), transferCount(0) {}
+
+void MockBus::setLatency(uint32_t fixedMicros, uint32_t microsPerByte) {
+    this->fixedMicros.store(fixedMicros, std::memory_order_relaxed);
+    this->microsPerByte.store(microsPerByte, std::memory_order_relaxed);
+}
+
+bool MockBus::transfer(BusTransaction &txn) {
+    const auto latency = fixedMicros.load(std::memory_order_relaxed) +
+        microsPerByte.load(std::memory_order_relaxed) * (txn.txLen + txn.rxLen);
+    const uint32_t tickMicros = portTICK_PERIOD_MS * 1000;
+    if (latency >= tickMicros) {
+        vTaskDelay(latency / tickMicros);
+    }
+    delayMicroseconds(latency % tickMicros);
+    transferCount.fetch_add(1, std::memory_order_relaxed);
+    if (device) {
+        return device(txn, args);
+    }
+    if (txn.rxLen) {
+        memset(txn.rx, 0, txn.rxLen);
+    }
+    return true;
+}
+
+uint32_t MockBus::transfers() const {
+    return transferCount.load(std::memory_order_relaxed);
+}
+
+BusManager::BusManager(const char *name, Bus &bus, int priority) :
+    bus(bus), priority(priority), failureCount(0), spec(this, nullptr) {
+    this->name = name;
+    queue = xQueueCreateStatic(QUEUE_LENGTH, sizeof(BusTransaction*), queueStorage, &queueBuffer);
+    SubsystemManager.addSubsystem(&spec);
+}
+
+BusManager::~BusManager() {}
+
+BaseSubsystem::Status BusManager::setup() {
+    setStatus(queue && bus.begin() ? READY : FAULT);
+    return getStatus();
+}
+
+bool BusManager::submit(BusTransaction *txn) {
+    if (txn == nullptr) {
+        return false;
+    }
+    txn->submitted = micros();
+    return xQueueSend(queue, &txn, 0) == pdTRUE;
+}
+
+uint32_t BusManager::failures() const {
+    rwLock.RLock();
+    const auto rc = failureCount;
+    rwLock.RUnlock();
+    return rc;
+}
+
+int BusManager::taskPriority() const {
+    return priority;
+}
+
+void BusManager::run(BusTransaction *txn) {
+    txn->ok = bus.transfer(*txn);
+    if (!txn->ok) {
+        rwLock.Lock();
+        failureCount++;
+        rwLock.UnLock();
+    }
+    latencyMicros.record(micros() - txn->submitted);
+    if (txn->done) {
+        txn->done(*txn, txn->args);
+    }
+}
+
+void BusManager::taskFunction(void */*parameter*/) {
+    BusTransaction *txn;
+    for (;;) {
+        // sleep until there's work, then run the whole batch without going back to sleep
+        if (xQueueReceive(queue, &txn, portMAX_DELAY) != pdTRUE) {
+            continue;
+        }
+        do {
+            run(txn);
+        } while (xQueueReceive(queue, &txn, 0) == pdTRUE);
+    }
+}
@@ -0,0 +1,267 @@
+#pragma once
+
+#include <Arduino.h>
+#include <Wire.h>
+#include <SPI.h>
+#include <atomic>
+#include "subsystem.h"
+#include "histogram.h"
+
+/**
+ * @brief a single write-then-read transfer on a bus
+ *
+ * The transaction and its buffers belong to the client and must stay valid until done is called.
+ */
+struct BusTransaction {
+    typedef void(DoneFn)(BusTransaction &txn, void *args);
+
+    uint8_t address;        ///< I2C device address, or chip select pin on SPI
+    const uint8_t *tx;      ///< bytes to write, e.g. a register address
+    size_t txLen;
+    uint8_t *rx;            ///< buffer for bytes read after writing
+    size_t rxLen;
+    DoneFn *done;           ///< called from the bus task on completion. May resubmit the transaction
+    void *args;             ///< additional argument to call done with
+    bool ok;                ///< set before done is called
+    uint32_t submitted;     ///< micros() at submission, set by BusManager
+};
+
+/**
+ * @brief Bus is the interface to a physical bus. Implement it to add bus types or mock devices
+ *
+ */
+class Bus {
+public:
+    virtual ~Bus() {}
+
+    /**
+     * @brief prepare the bus, called from BusManager::setup(). Defaults to nothing
+     *
+     * @return true on success
+     */
+    virtual bool begin() { return true; }
+
+    /**
+     * @brief run a transaction to completion. Only ever called from one task
+     *
+     * @param txn
+     * @return true on success
+     */
+    virtual bool transfer(BusTransaction &txn) = 0;
+};
+
+/**
+ * @brief I2C bus on a TwoWire instance, which must already be begun
+ *
+ */
+class I2cBus : public Bus {
+public:
+    I2cBus(TwoWire &wire);
+    bool transfer(BusTransaction &txn);
+
+private:
+    TwoWire &wire;
+};
+
+/**
+ * @brief SPI bus on an SPIClass instance, which must already be begun. address is the chip select pin
+ *
+ * The chip selects passed in are made outputs and deselected in begin(), so no device sees a
+ * floating select before its first transaction. Any other pin is set up on its first transaction.
+ */
+class SpiBus : public Bus {
+public:
+    /**
+     * @brief Construct a new Spi Bus
+     *
+     * @param spi
+     * @param settings
+     * @param csPins chip select pins of the devices on the bus
+     * @param numCsPins
+     */
+    SpiBus(SPIClass &spi, const SPISettings &settings, const uint8_t *csPins = nullptr, size_t numCsPins = 0);
+    bool begin();
+    bool transfer(BusTransaction &txn);
+
+private:
+    void deselect(uint8_t cs);
+
+    SPIClass &spi;
+    SPISettings settings;
+    const uint8_t *csPins;
+    size_t numCsPins;
+    uint64_t configured; ///< bit n set once pin n is an output
+};
+
+/**
+ * @brief a bus of simulated devices with configurable latency, to test and benchmark clients
+ * and BusManager without hardware
+ *
+ * Each transfer takes fixed plus per byte latency, whole ticks with vTaskDelay(), freeing the
+ * CPU like an interrupt driven transfer, and the rest busy waiting. The device function then
+ * answers it.
+ *
+ * static MockBus mockBus(200, 25, [](BusTransaction &txn, void *args) {
+ *    memset(txn.rx, 0x42, txn.rxLen);
+ *    return true;
+ * });
+ * static BusManager imuBus("imuBus", mockBus);
+ */
+class MockBus : public Bus {
+public:
+    /**
+     * @brief answer a transfer, e.g. fill rx from a register map
+     *
+     * @return false to fail the transfer
+     */
+    typedef bool(DeviceFn)(BusTransaction &txn, void *args);
+
+    /**
+     * @brief Construct a new Mock Bus
+     *
+     * @param fixedMicros latency of every transfer
+     * @param microsPerByte latency per byte written or read
+     * @param device answers transfers, nullptr to read zeros
+     * @param args additional argument to call device with
+     */
+    MockBus(uint32_t fixedMicros = 0, uint32_t microsPerByte = 0, DeviceFn *device = nullptr, void *args = nullptr);
+
+    /**
+     * @brief change the latency, from any task
+     *
+     * @param fixedMicros
+     * @param microsPerByte
+     */
+    void setLatency(uint32_t fixedMicros, uint32_t microsPerByte);
+
+    bool transfer(BusTransaction &txn);
+
+    /**
+     * @brief number of transfers run
+     *
+     * @return uint32_t
+     */
+    uint32_t transfers() const;
+
+private:
+    std::atomic<uint32_t> fixedMicros;
+    std::atomic<uint32_t> microsPerByte;
+    DeviceFn *device;
+    void *args;
+    std::atomic<uint32_t> transferCount;
+};
+
+/**
+ * @brief BusManager owns a bus and runs transactions queued by any number of clients
+ *
+ * Clients submit() and carry on; the bus task runs everything queued back to back and calls
+ * each transaction's done function, which typically decodes rx and publishes into a DataThing
+ * (see PublishingTransaction). A slow device only delays other transactions on the same bus,
+ * and no client needs its own lock around the bus. Use one BusManager per bus.
+ */
+class BusManager : public ThreadedSubsystem {
+public:
+    /**
+     * @brief Construct a new Bus Manager object and add it to SubsystemManager
+     *
+     * @param name subsystem name
+     * @param bus the bus to run transactions on
+     * @param priority task priority, should be above that of the clients
+     */
+    BusManager(const char *name, Bus &bus, int priority = tskIDLE_PRIORITY + 2);
+    virtual ~BusManager();
+
+    Status setup();
+
+    /**
+     * @brief queue a transaction without blocking
+     *
+     * @param txn
+     * @return false if the queue is full
+     */
+    bool submit(BusTransaction *txn);
+
+    /**
+     * @brief time from submit() to the done call, in microseconds
+     *
+     * @return const LatencyHistogram<>&
+     */
+    const LatencyHistogram<> &latency() const { return latencyMicros; }
+
+    /**
+     * @brief number of transactions that failed on the bus
+     *
+     * @return uint32_t
+     */
+    uint32_t failures() const;
+
+protected:
+    int taskPriority() const;
+    void taskFunction(void *parameter);
+
+private:
+    static const auto QUEUE_LENGTH = 16;
+
+    void run(BusTransaction *txn);
+
+    Bus &bus;
+    const int priority;
+    uint32_t failureCount;
+    LatencyHistogram<> latencyMicros;
+
+    StaticQueue_t queueBuffer;
+    uint8_t queueStorage[QUEUE_LENGTH * sizeof(BusTransaction*)];
+    QueueHandle_t queue;
+
+    SubsystemManagerClass::Spec spec;
+};
+
+/**
+ * @brief a transaction that decodes its result straight into a DataThing
+ *
+ * @tparam T the DataThing's type
+ * @tparam Placement the DataThing's placement
+ */
+template<class T, class Placement = InlinePlacement>
+struct PublishingTransaction : public BusTransaction {
+    typedef void(DecodeFn)(const uint8_t *rx, size_t len, T &data);
+
+    /**
+     * @brief Construct a new Publishing Transaction
+     *
+     * @param address device address or chip select pin
+     * @param tx bytes to write
+     * @param txLen
+     * @param rx buffer for reading
+     * @param rxLen
+     * @param thing where to publish
+     * @param decode called with the thing write locked to decode rx into it. Not called on failure
+     */
+    PublishingTransaction(uint8_t address, const uint8_t *tx, size_t txLen, uint8_t *rx, size_t rxLen,
+                          DataThing<T, Placement> &thing, DecodeFn *decode) : thing(thing), decode(decode) {
+        this->address = address;
+        this->tx = tx;
+        this->txLen = txLen;
+        this->rx = rx;
+        this->rxLen = rxLen;
+        this->done = publish;
+        this->args = nullptr;
+        this->ok = false;
+        this->submitted = 0;
+    }
+
+    DataThing<T, Placement> &thing;
+    DecodeFn *decode;
+
+private:
+    static void publish(BusTransaction &txn, void */*args*/) {
+        auto &self = static_cast<PublishingTransaction&>(txn);
+        if (!self.ok) {
+            return;
+        }
+        self.thing.accessData([](T &data, void *args) {
+            auto self = static_cast<PublishingTransaction*>(args);
+            self->decode(self->rx, self->rxLen, data);
+        }, &self);
+    }
+};
@@ -0,0 +1,66 @@
+#include "command.h"
+
+CommandInbox::CommandInbox() {
+    queue = xQueueCreateStatic(LENGTH, sizeof(Command), queueStorage, &queueBuffer);
+}
+
+bool CommandInbox::post(const Command &command) {
+    return xQueueSend(queue, &command, 0) == pdTRUE;
+}
+
+int CommandInbox::process(TickType_t wait) {
+    Command command;
+    auto handled = 0;
+    while (xQueueReceive(queue, &command, handled ? 0 : wait) == pdTRUE) {
+        latencyMicros.record(micros() - command.dispatched);
+        const auto route = CommandRouter.routes[command.id];
+        if (route && route->fn) {
+            route->fn(command, route->args);
+        }
+        handled++;
+    }
+    return handled;
+}
+
+CommandRouterClass::Route::Route(uint8_t id, CommandInbox *inbox, HandlerFn *fn, void *args) :
+    id(id), inbox(inbox), fn(fn), args(args) {}
+
+bool CommandRouterClass::addRoute(Route *route) {
+    if (route == nullptr || route->inbox == nullptr || routes[route->id] != nullptr) {
+        return false;
+    }
+    routes[route->id] = route;
+    return true;
+}
+
+bool CommandRouterClass::dispatch(const uint8_t *data, size_t len) {
+    if (len == 0 || len - 1 > COMMAND_MAX_PAYLOAD) {
+        rejectedCount.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    const auto route = routes[data[0]];
+    if (route == nullptr) {
+        rejectedCount.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    Command command;
+    command.id = data[0];
+    command.length = len - 1;
+    memcpy(command.payload, data + 1, len - 1);
+    command.dispatched = micros();
+    if (!route->inbox->post(command)) {
+        rejectedCount.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    return true;
+}
+
+void CommandRouterClass::onFrame(const uint8_t *payload, size_t len, void *args) {
+    static_cast<CommandRouterClass*>(args)->dispatch(payload, len);
+}
+
+uint32_t CommandRouterClass::rejected() const {
+    return rejectedCount.load(std::memory_order_relaxed);
+}
+
+CommandRouterClass CommandRouter;
@@ -0,0 +1,128 @@
+#pragma once
+
+#include <Arduino.h>
+#include <atomic>
+#include "histogram.h"
+
+#ifndef COMMAND_MAX_PAYLOAD
+#define COMMAND_MAX_PAYLOAD 32 ///< longer commands are rejected
+#endif
+
+/**
+ * @brief a command as delivered to a handler
+ *
+ */
+struct Command {
+    uint8_t id;
+    uint8_t length;
+    uint8_t payload[COMMAND_MAX_PAYLOAD];
+    uint32_t dispatched;    ///< micros() when routed
+};
+
+/**
+ * @brief queue of commands for one subsystem, drained by the subsystem's own task
+ *
+ */
+class CommandInbox {
+public:
+    CommandInbox();
+
+    /**
+     * @brief run the handlers of queued commands
+     *
+     * @param wait ticks to wait for the first command, 0 to only handle what is queued
+     * @return int number of commands handled
+     */
+    int process(TickType_t wait = 0);
+
+    /**
+     * @brief time from dispatch to the start of the handler, in microseconds
+     *
+     * @return const LatencyHistogram<>&
+     */
+    const LatencyHistogram<> &latency() const { return latencyMicros; }
+
+    // to post commands
+    friend class CommandRouterClass;
+
+private:
+    static const auto LENGTH = 8;
+
+    bool post(const Command &command);
+
+    StaticQueue_t queueBuffer;
+    uint8_t queueStorage[LENGTH * sizeof(Command)];
+    QueueHandle_t queue;
+    LatencyHistogram<> latencyMicros;
+};
+
+/**
+ * @brief CommandRouter delivers commands from a link to the subsystems handling them
+ *
+ * Command ids are 8 bit and index the route table directly, so routing is a single lookup.
+ * dispatch() never blocks: the command is copied into the handling subsystem's inbox and
+ * the handler runs when that subsystem calls CommandInbox::process().
+ */
+class CommandRouterClass {
+public:
+    typedef void(HandlerFn)(const Command &command, void *args);
+
+    /**
+     * @brief a command handled by a subsystem
+     *
+     */
+    struct Route {
+        Route(uint8_t id, CommandInbox *inbox, HandlerFn *fn, void *args);
+        uint8_t id;
+        CommandInbox *inbox;    ///< where to deliver
+        HandlerFn *fn;          ///< called from the inbox owner's task
+        void *args;             ///< additional argument to call fn with
+    };
+
+    constexpr CommandRouterClass() : routes{}, rejectedCount(0) {}
+
+    /**
+     * @brief add a route
+     *
+     * In your constructor, use as:
+     * static CommandRouterClass::Route route(CMD_ARM, &inbox, handleArm, this);
+     * CommandRouter.addRoute(&route);
+     *
+     * @param route
+     * @return false if the id is already routed
+     */
+    bool addRoute(Route *route);
+
+    /**
+     * @brief route a command
+     *
+     * @param data command id followed by its payload
+     * @param len
+     * @return false if the command is unknown, too long or the inbox is full
+     */
+    bool dispatch(const uint8_t *data, size_t len);
+
+    /**
+     * @brief FrameParser::FrameFn adapter, to dispatch frames from a link
+     *
+     * e.g. CobsFrameParser parser(CommandRouterClass::onFrame, &CommandRouter);
+     */
+    static void onFrame(const uint8_t *payload, size_t len, void *args);
+
+    /**
+     * @brief number of commands that could not be delivered
+     *
+     * @return uint32_t
+     */
+    uint32_t rejected() const;
+
+    // to look up handlers
+    friend class CommandInbox;
+
+private:
+    // constant initialized, so routes can be added during static construction
+    Route *routes[256];
+    std::atomic<uint32_t> rejectedCount;
+};
+
+extern CommandRouterClass CommandRouter;
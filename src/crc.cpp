@@ -0,0 +1,126 @@
+#include "crc.h"
+
+#if defined(ESP_PLATFORM)
+#include <esp_rom_crc.h>
+#endif
+#if defined(__SSE4_2__)
+#include <nmmintrin.h>
+#endif
+
+namespace {
+
+// table s gives the CRC of a byte followed by s zero bytes, for slicing-by-8
+template<class T>
+struct SliceTables {
+    T t[8][256];
+};
+
+constexpr SliceTables<uint16_t> makeTables16(uint16_t poly) {
+    SliceTables<uint16_t> tables{};
+    for (uint32_t i = 0; i < 256; i++) {
+        uint16_t c = i << 8;
+        for (auto k = 0; k < 8; k++) {
+            c = (c & 0x8000) ? (c << 1) ^ poly : c << 1;
+        }
+        tables.t[0][i] = c;
+    }
+    for (auto s = 1; s < 8; s++) {
+        for (uint32_t i = 0; i < 256; i++) {
+            const uint16_t prev = tables.t[s - 1][i];
+            tables.t[s][i] = (prev << 8) ^ tables.t[0][prev >> 8];
+        }
+    }
+    return tables;
+}
+
+constexpr SliceTables<uint32_t> makeReflectedTables32(uint32_t poly) {
+    SliceTables<uint32_t> tables{};
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t c = i;
+        for (auto k = 0; k < 8; k++) {
+            c = (c & 1) ? (c >> 1) ^ poly : c >> 1;
+        }
+        tables.t[0][i] = c;
+    }
+    for (auto s = 1; s < 8; s++) {
+        for (uint32_t i = 0; i < 256; i++) {
+            const uint32_t prev = tables.t[s - 1][i];
+            tables.t[s][i] = (prev >> 8) ^ tables.t[0][prev & 0xff];
+        }
+    }
+    return tables;
+}
+
+constexpr auto crc16Tables = makeTables16(0x1021);
+#if !defined(ESP_PLATFORM)
+constexpr auto crc32Tables = makeReflectedTables32(0xedb88320);
+#endif
+#if !defined(__SSE4_2__)
+constexpr auto crc32cTables = makeReflectedTables32(0x82f63b78);
+#endif
+
+inline uint32_t load32le(const uint8_t *p) {
+    return p[0] | (p[1] << 8) | (p[2] << 16) | (static_cast<uint32_t>(p[3]) << 24);
+}
+
+// raw register update, without the inversions
+uint32_t sliceReflected32(const SliceTables<uint32_t> &tables, const uint8_t *data, size_t len, uint32_t crc) {
+    const auto &t = tables.t;
+    while (len >= 8) {
+        const auto one = load32le(data) ^ crc;
+        const auto two = load32le(data + 4);
+        crc = t[7][one & 0xff] ^ t[6][(one >> 8) & 0xff] ^ t[5][(one >> 16) & 0xff] ^ t[4][one >> 24] ^
+              t[3][two & 0xff] ^ t[2][(two >> 8) & 0xff] ^ t[1][(two >> 16) & 0xff] ^ t[0][two >> 24];
+        data += 8;
+        len -= 8;
+    }
+    while (len--) {
+        crc = (crc >> 8) ^ t[0][(crc ^ *data++) & 0xff];
+    }
+    return crc;
+}
+
+} // namespace
+
+uint16_t crc16(const uint8_t *data, size_t len, uint16_t crc) {
+    const auto &t = crc16Tables.t;
+    while (len >= 8) {
+        crc = t[7][data[0] ^ (crc >> 8)] ^ t[6][data[1] ^ (crc & 0xff)] ^ t[5][data[2]] ^ t[4][data[3]] ^
+              t[3][data[4]] ^ t[2][data[5]] ^ t[1][data[6]] ^ t[0][data[7]];
+        data += 8;
+        len -= 8;
+    }
+    while (len--) {
+        crc = (crc << 8) ^ t[0][((crc >> 8) ^ *data++) & 0xff];
+    }
+    return crc;
+}
+
+uint32_t crc32(const uint8_t *data, size_t len, uint32_t crc) {
+#if defined(ESP_PLATFORM)
+    return esp_rom_crc32_le(crc, data, len);
+#else
+    return ~sliceReflected32(crc32Tables, data, len, ~crc);
+#endif
+}
+
+uint32_t crc32c(const uint8_t *data, size_t len, uint32_t crc) {
+#if defined(__SSE4_2__)
+    uint32_t c = ~crc;
+#if defined(__x86_64__)
+    uint64_t c64 = c;
+    for (; len >= 8; data += 8, len -= 8) {
+        uint64_t v;
+        memcpy(&v, data, sizeof(v));
+        c64 = _mm_crc32_u64(c64, v);
+    }
+    c = static_cast<uint32_t>(c64);
+#endif
+    while (len--) {
+        c = _mm_crc32_u8(c, *data++);
+    }
+    return ~c;
+#else
+    return ~sliceReflected32(crc32cTables, data, len, ~crc);
+#endif
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <Arduino.h>
+
+/*
+ * All functions take the result of a previous call as crc to checksum data in pieces.
+ *
+ * The implementation is picked at compile time: the ESP32 ROM routine for CRC-32 on target,
+ * the SSE4.2 crc32 instruction for CRC-32C on x86 hosts built with -msse4.2, and slicing-by-8
+ * over tables generated at compile time otherwise.
+ */
+
+/**
+ * @brief CRC-16/CCITT-FALSE (poly 0x1021, init 0xffff), used by link framing
+ *
+ * @param data
+ * @param len
+ * @param crc running value
+ * @return uint16_t
+ */
+uint16_t crc16(const uint8_t *data, size_t len, uint16_t crc = 0xffff);
+
+/**
+ * @brief CRC-32 (IEEE 802.3, as zlib's crc32())
+ *
+ * @param data
+ * @param len
+ * @param crc running value, 0 to start
+ * @return uint32_t
+ */
+uint32_t crc32(const uint8_t *data, size_t len, uint32_t crc = 0);
+
+/**
+ * @brief CRC-32C (Castagnoli), better error detection than CRC-32 for the same cost
+ *
+ * @param data
+ * @param len
+ * @param crc running value, 0 to start
+ * @return uint32_t
+ */
+uint32_t crc32c(const uint8_t *data, size_t len, uint32_t crc = 0);
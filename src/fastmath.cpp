@@ -0,0 +1,140 @@
+#include "fastmath.h"
+#include <math.h>
+#include <string.h>
+
+namespace {
+
+constexpr double PI = 3.14159265358979323846;
+constexpr auto SIN_TABLE_BITS = 8;
+constexpr auto SIN_TABLE_SIZE = 1 << SIN_TABLE_BITS;
+
+// one period, plus the first entry again so interpolation never wraps
+struct SinTable {
+    float v[SIN_TABLE_SIZE + 1];
+};
+
+constexpr double taylorSin(double x) {
+    double term = x, sum = x;
+    for (auto n = 1; n < 15; n++) {
+        term *= -x * x / ((2 * n) * (2 * n + 1));
+        sum += term;
+    }
+    return sum;
+}
+
+constexpr SinTable makeSinTable() {
+    SinTable table{};
+    for (auto i = 0; i <= SIN_TABLE_SIZE; i++) {
+        auto a = 2 * PI * i / SIN_TABLE_SIZE;
+        if (a > PI) {
+            a -= 2 * PI;
+        }
+        table.v[i] = static_cast<float>(taylorSin(a));
+    }
+    return table;
+}
+
+constexpr auto sinTable = makeSinTable();
+
+inline uint32_t bitsOf(float f) {
+    uint32_t u;
+    memcpy(&u, &f, sizeof(u));
+    return u;
+}
+
+inline float floatOf(uint32_t u) {
+    float f;
+    memcpy(&f, &u, sizeof(f));
+    return f;
+}
+
+}
+
+float fastInvSqrt(float x) {
+    auto y = floatOf(0x5f3759df - (bitsOf(x) >> 1));
+    const auto half = 0.5f * x;
+    y = y * (1.5f - half * y * y);
+    y = y * (1.5f - half * y * y);
+    return y;
+}
+
+float fastSqrt(float x) {
+    return x > 0 ? x * fastInvSqrt(x) : 0;
+}
+
+float fastAtan2(float y, float x) {
+    const auto ax = fabsf(x), ay = fabsf(y);
+    const auto hi = ax > ay ? ax : ay;
+    if (hi == 0) {
+        return 0;
+    }
+    const auto lo = ax > ay ? ay : ax;
+    // odd polynomial for atan on [0, 1]
+    const auto z = lo / hi;
+    const auto z2 = z * z;
+    auto a = z * (0.9998660f + z2 * (-0.3302995f + z2 * (0.1801410f + z2 * (-0.0851330f + z2 * 0.0208351f))));
+    if (ay > ax) {
+        a = static_cast<float>(PI / 2) - a;
+    }
+    if (x < 0) {
+        a = static_cast<float>(PI) - a;
+    }
+    return y < 0 ? -a : a;
+}
+
+float fastSin(float x) {
+    const auto t = x * static_cast<float>(SIN_TABLE_SIZE / (2 * PI));
+    auto i = static_cast<int32_t>(t);
+    if (t < i) {
+        i--;
+    }
+    const auto frac = t - i;
+    const auto idx = i & (SIN_TABLE_SIZE - 1);
+    const auto a = sinTable.v[idx];
+    return a + (sinTable.v[idx + 1] - a) * frac;
+}
+
+float fastCos(float x) {
+    return fastSin(x + static_cast<float>(PI / 2));
+}
+
+float fastLog2(float x) {
+    const auto bits = bitsOf(x);
+    auto e = static_cast<int32_t>((bits >> 23) & 0xff) - 127;
+    auto m = floatOf((bits & 0x007fffff) | 0x3f800000);
+    // center the mantissa on 1 so the series below converges fast
+    if (m > 1.41421356f) {
+        m *= 0.5f;
+        e++;
+    }
+    // log2(m) = 2 / ln(2) * atanh(s)
+    const auto s = (m - 1) / (m + 1);
+    const auto s2 = s * s;
+    const auto l = s * (2.88539008f + s2 * (0.961796694f + s2 * (0.577078016f + s2 * 0.412198583f)));
+    return e + l;
+}
+
+float fastExp2(float x) {
+    if (x <= -126) {
+        return 0;
+    }
+    if (x >= 128) {
+        return INFINITY;
+    }
+    auto i = static_cast<int32_t>(x);
+    if (x < i) {
+        i--;
+    }
+    const auto f = x - i;
+    // 2 ^ f on [0, 1)
+    const auto p = 0.999999898f + f * (0.69315449f + f * (0.240141818f + f * (0.0558603371f + f * (0.00894959042f + f * 0.00189375406f))));
+    return floatOf(bitsOf(p) + (static_cast<uint32_t>(i) << 23));
+}
+
+float fastPow(float x, float y) {
+    return fastExp2(y * fastLog2(x));
+}
+
+float baroAltitude(float pressure, float seaLevelPressure) {
+    return 44330.0f * (1.0f - fastPow(pressure / seaLevelPressure, 0.190295f));
+}
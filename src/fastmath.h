@@ -0,0 +1,166 @@
+#pragma once
+
+#include <Arduino.h>
+#include <type_traits>
+
+/*
+ * Fast approximations for hot paths on cores where libm is slow, e.g. without a double
+ * precision FPU. Error bounds are over the whole documented domain, measured against libm in
+ * double precision; use libm where they don't suffice.
+ */
+
+/**
+ * @brief 1 / sqrt(x)
+ *
+ * @note relative error below 5e-6, x > 0
+ *
+ * @param x
+ * @return float
+ */
+float fastInvSqrt(float x);
+
+/**
+ * @brief sqrt(x)
+ *
+ * @note relative error below 5e-6, 0 for x <= 0
+ *
+ * @param x
+ * @return float
+ */
+float fastSqrt(float x);
+
+/**
+ * @brief atan2(y, x)
+ *
+ * @note absolute error below 1.2e-5 rad, 0 for (0, 0)
+ *
+ * @param y
+ * @param x
+ * @return float
+ */
+float fastAtan2(float y, float x);
+
+/**
+ * @brief sin(x), by table lookup with linear interpolation
+ *
+ * @note absolute error below 8e-5 for |x| < 16, growing by about 8e-8 * |x| beyond; reduce large angles first
+ *
+ * @param x radians
+ * @return float
+ */
+float fastSin(float x);
+
+/**
+ * @brief cos(x), see fastSin()
+ *
+ * @param x radians
+ * @return float
+ */
+float fastCos(float x);
+
+/**
+ * @brief log2(x)
+ *
+ * @note absolute error below 2e-7 for 0.25 < x < 4, within 4e-6 for any positive normal x
+ *
+ * @param x
+ * @return float
+ */
+float fastLog2(float x);
+
+/**
+ * @brief 2 ^ x
+ *
+ * @note relative error below 2e-7 for -126 < x < 128
+ *
+ * @param x
+ * @return float
+ */
+float fastExp2(float x);
+
+/**
+ * @brief x ^ y, as fastExp2(y * fastLog2(x))
+ *
+ * @note relative error below 2e-7 + 3e-6 * |y|, x > 0
+ *
+ * @param x
+ * @param y
+ * @return float
+ */
+float fastPow(float x, float y);
+
+/**
+ * @brief altitude from static pressure with the international barometric formula
+ *
+ * @note error below 1 cm for 1 to 110 kPa versus the formula in double precision; powf() gets 3 mm
+ *
+ * @param pressure Pa
+ * @param seaLevelPressure Pa
+ * @return float meters
+ */
+float baroAltitude(float pressure, float seaLevelPressure = 101325.0f);
+
+/**
+ * @brief a signed fixed point number with FRAC fractional bits, e.g. Fixed<16> is Q15.16
+ *
+ * Arithmetic is integer only; products and quotients are computed at twice the width, so
+ * they don't overflow before rescaling. Conversions from float round to nearest.
+ *
+ * @tparam FRAC fractional bits
+ * @tparam T int16_t or int32_t storage
+ */
+template<int FRAC, class T = int32_t>
+class Fixed {
+public:
+    static_assert(std::is_same<T, int16_t>::value || std::is_same<T, int32_t>::value, "int16_t or int32_t storage");
+    static_assert(FRAC > 0 && FRAC < static_cast<int>(sizeof(T) * 8) - 1, "FRAC out of range");
+
+    typedef typename std::conditional<std::is_same<T, int16_t>::value, int32_t, int64_t>::type Wide;
+
+    static constexpr T ONE = T(1) << FRAC;
+
+    constexpr Fixed() : raw(0) {}
+    constexpr Fixed(float value) : raw(static_cast<T>(value * ONE + (value < 0 ? -0.5f : 0.5f))) {}
+
+    /**
+     * @brief from the raw representation
+     *
+     * @param raw value * 2 ^ FRAC
+     * @return Fixed
+     */
+    static constexpr Fixed fromRaw(T raw) { return Fixed(raw, 0); }
+
+    constexpr T toRaw() const { return raw; }
+    constexpr float toFloat() const { return static_cast<float>(raw) / ONE; }
+    constexpr T toInt() const { return raw >> FRAC; }
+
+    constexpr Fixed operator+(Fixed other) const { return fromRaw(raw + other.raw); }
+    constexpr Fixed operator-(Fixed other) const { return fromRaw(raw - other.raw); }
+    constexpr Fixed operator-() const { return fromRaw(-raw); }
+    constexpr Fixed operator*(Fixed other) const {
+        return fromRaw(static_cast<T>((static_cast<Wide>(raw) * other.raw + (Wide(1) << (FRAC - 1))) >> FRAC));
+    }
+    constexpr Fixed operator/(Fixed other) const {
+        return fromRaw(static_cast<T>((static_cast<Wide>(raw) << FRAC) / other.raw));
+    }
+
+    Fixed &operator+=(Fixed other) { raw += other.raw; return *this; }
+    Fixed &operator-=(Fixed other) { raw -= other.raw; return *this; }
+    Fixed &operator*=(Fixed other) { return *this = *this * other; }
+    Fixed &operator/=(Fixed other) { return *this = *this / other; }
+
+    constexpr bool operator==(Fixed other) const { return raw == other.raw; }
+    constexpr bool operator!=(Fixed other) const { return raw != other.raw; }
+    constexpr bool operator<(Fixed other) const { return raw < other.raw; }
+    constexpr bool operator<=(Fixed other) const { return raw <= other.raw; }
+    constexpr bool operator>(Fixed other) const { return raw > other.raw; }
+    constexpr bool operator>=(Fixed other) const { return raw >= other.raw; }
+
+private:
+    constexpr Fixed(T raw, int) : raw(raw) {}
+
+    T raw;
+};
+
+template<int FRAC, class T>
+constexpr T Fixed<FRAC, T>::ONE;
@@ -0,0 +1,215 @@
+#pragma once
+
+#include <Arduino.h>
+#include <string.h>
+#include "history.h"
+
+/**
+ * @brief one frame of a multi-channel signal; an array of frames is channel interleaved
+ *
+ * @tparam CHANNELS
+ */
+template<size_t CHANNELS>
+struct Samples {
+    float ch[CHANNELS];
+};
+
+/**
+ * @brief FIR filter over blocks of channel interleaved frames
+ *
+ * The delay line is kept twice, so the taps of every output are contiguous and no index
+ * wraps inside the dot product, and channels are innermost, so the multiply-accumulate
+ * vectorizes across channels.
+ *
+ * @tparam TAPS
+ * @tparam CHANNELS
+ */
+template<size_t TAPS, size_t CHANNELS>
+class FirFilter {
+public:
+    /**
+     * @brief Construct a new Fir Filter object
+     *
+     * @param coefficients TAPS coefficients, applied to the newest sample first
+     */
+    FirFilter(const float *coefficients) : pos(0) {
+        memcpy(coeffs, coefficients, sizeof(coeffs));
+        reset();
+    }
+
+    /**
+     * @brief clear the delay line
+     *
+     */
+    void reset() {
+        memset(delay, 0, sizeof(delay));
+    }
+
+    /**
+     * @brief filter a block
+     *
+     * @param in frames
+     * @param out frames, may be the same as in
+     * @param frames number of frames
+     */
+    void process(const Samples<CHANNELS> *in, Samples<CHANNELS> *out, size_t frames) {
+        for (size_t f = 0; f < frames; f++) {
+            pos = pos == 0 ? TAPS - 1 : pos - 1;
+            for (size_t c = 0; c < CHANNELS; c++) {
+                delay[pos][c] = delay[pos + TAPS][c] = in[f].ch[c];
+            }
+            float acc[CHANNELS] = {};
+            for (size_t t = 0; t < TAPS; t++) {
+                const auto k = coeffs[t];
+                const float *__restrict d = delay[pos + t];
+                for (size_t c = 0; c < CHANNELS; c++) {
+                    acc[c] += k * d[c];
+                }
+            }
+            memcpy(out[f].ch, acc, sizeof(acc));
+        }
+    }
+
+private:
+    float coeffs[TAPS];
+    float delay[2 * TAPS][CHANNELS];
+    size_t pos; ///< newest sample, also at pos + TAPS
+};
+
+/**
+ * @brief coefficients of a biquad section, normalized so a0 is 1
+ *
+ */
+struct BiquadCoefficients {
+    float b0, b1, b2, a1, a2;
+};
+
+/**
+ * @brief cascade of biquad sections over blocks of channel interleaved frames
+ *
+ * Sections are direct form II transposed, the best behaved form in single precision, and
+ * channels are innermost so each section vectorizes across channels.
+ *
+ * @tparam SECTIONS
+ * @tparam CHANNELS
+ */
+template<size_t SECTIONS, size_t CHANNELS>
+class BiquadCascade {
+public:
+    /**
+     * @brief Construct a new Biquad Cascade object
+     *
+     * @param sections SECTIONS coefficient sets, applied in order
+     */
+    BiquadCascade(const BiquadCoefficients *sections) {
+        memcpy(coeffs, sections, sizeof(coeffs));
+        reset();
+    }
+
+    /**
+     * @brief clear the filter state
+     *
+     */
+    void reset() {
+        memset(z1, 0, sizeof(z1));
+        memset(z2, 0, sizeof(z2));
+    }
+
+    /**
+     * @brief filter a block
+     *
+     * @param in frames
+     * @param out frames, may be the same as in
+     * @param frames number of frames
+     */
+    void process(const Samples<CHANNELS> *in, Samples<CHANNELS> *out, size_t frames) {
+        for (size_t f = 0; f < frames; f++) {
+            float x[CHANNELS];
+            memcpy(x, in[f].ch, sizeof(x));
+            for (size_t s = 0; s < SECTIONS; s++) {
+                const auto &k = coeffs[s];
+                float *__restrict s1 = z1[s];
+                float *__restrict s2 = z2[s];
+                for (size_t c = 0; c < CHANNELS; c++) {
+                    const auto y = k.b0 * x[c] + s1[c];
+                    s1[c] = k.b1 * x[c] - k.a1 * y + s2[c];
+                    s2[c] = k.b2 * x[c] - k.a2 * y;
+                    x[c] = y;
+                }
+            }
+            memcpy(out[f].ch, x, sizeof(x));
+        }
+    }
+
+private:
+    BiquadCoefficients coeffs[SECTIONS];
+    float z1[SECTIONS][CHANNELS];
+    float z2[SECTIONS][CHANNELS];
+};
+
+/**
+ * @brief FilterStage filters every batch published by a source and publishes the result
+ *
+ * static FilterStage<BiquadCascade<2, 3>, 3, 32> gyroFiltered(gyroRaw, lowpass);
+ *
+ * Filtering runs in the publishing task, a block at a time.
+ *
+ * @tparam Filter FirFilter or BiquadCascade with the same number of channels
+ * @tparam CHANNELS
+ * @tparam N number of filtered frames kept, also the block size
+ * @tparam Placement where the filtered frames are kept, see placement.h
+ */
+template<class Filter, size_t CHANNELS, size_t N, class Placement = InlinePlacement>
+class FilterStage : public HistoryDataThing<Samples<CHANNELS>, N, Placement> {
+public:
+    typedef Samples<CHANNELS> Frame;
+
+    /**
+     * @brief Construct a new Filter Stage and subscribe it to the source
+     *
+     * @note the source must be constructed first, e.g. defined earlier in the same file
+     *
+     * @param source publishing batches of frames
+     * @param coefficients for the Filter constructor
+     */
+    template<class Source, class Coefficients>
+    FilterStage(Source &source, const Coefficients *coefficients) :
+        HistoryDataThing<Frame, N, Placement>(lock), filter(coefficients) {
+        source.registerBatchCallback([](const Frame *samples, size_t count, void *args) {
+            static_cast<FilterStage*>(args)->onBatch(samples, count);
+        }, this);
+    }
+
+#ifdef SUBSYSTEM_STATS
+    /**
+     * @brief time to filter and publish each block, in microseconds
+     *
+     * @return const LatencyHistogram<>&
+     */
+    const LatencyHistogram<> &blockDurations() const { return blockMicros; }
+#endif
+
+private:
+    void onBatch(const Frame *samples, size_t count) {
+        while (count > 0) {
+            const auto n = count < N ? count : N;
+#ifdef SUBSYSTEM_STATS
+            const auto t0 = micros();
+#endif
+            filter.process(samples, block, n);
+            this->publish(block, n);
+#ifdef SUBSYSTEM_STATS
+            blockMicros.record(micros() - t0);
+#endif
+            samples += n;
+            count -= n;
+        }
+    }
+
+    ReadWriteLock lock;
+    Filter filter;
+    Frame block[N];
+#ifdef SUBSYSTEM_STATS
+    LatencyHistogram<> blockMicros;
+#endif
+};
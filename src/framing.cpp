@@ -0,0 +1,165 @@
+#include "framing.h"
+
+CobsEncoder::CobsEncoder(uint8_t *out, size_t size) :
+    out(out), size(size), pos(1), codePos(0), code(1), crc(0xffff), overflow(size < 2) {}
+
+void CobsEncoder::put(uint8_t b) {
+    // pos starts past the end of a buffer of less than 2 bytes
+    if (overflow) {
+        return;
+    }
+    if (b != 0) {
+        if (pos == size) {
+            overflow = true;
+            return;
+        }
+        out[pos++] = b;
+        if (++code != 0xff) {
+            return;
+        }
+    }
+    // close the block and reserve the code byte of the next one
+    if (pos == size) {
+        overflow = true;
+        return;
+    }
+    out[codePos] = code;
+    codePos = pos++;
+    code = 1;
+}
+
+void CobsEncoder::write(const uint8_t *data, size_t len) {
+    crc = crc16(data, len, crc);
+    for (size_t i = 0; i < len && !overflow; i++) {
+        put(data[i]);
+    }
+}
+
+size_t CobsEncoder::end() {
+    put(static_cast<uint8_t>(crc));
+    put(static_cast<uint8_t>(crc >> 8));
+    if (overflow || pos == size) {
+        return 0;
+    }
+    out[codePos] = code;
+    out[pos++] = 0;
+    return pos;
+}
+
+SlipEncoder::SlipEncoder(uint8_t *out, size_t size) :
+    out(out), size(size), pos(0), crc(0xffff), overflow(false) {
+    put(END);
+}
+
+void SlipEncoder::put(uint8_t b) {
+    if (pos == size) {
+        overflow = true;
+        return;
+    }
+    out[pos++] = b;
+}
+
+void SlipEncoder::putEscaped(uint8_t b) {
+    if (b == END) {
+        put(ESC);
+        put(ESC_END);
+    } else if (b == ESC) {
+        put(ESC);
+        put(ESC_ESC);
+    } else {
+        put(b);
+    }
+}
+
+void SlipEncoder::write(const uint8_t *data, size_t len) {
+    crc = crc16(data, len, crc);
+    for (size_t i = 0; i < len && !overflow; i++) {
+        putEscaped(data[i]);
+    }
+}
+
+size_t SlipEncoder::end() {
+    putEscaped(static_cast<uint8_t>(crc));
+    putEscaped(static_cast<uint8_t>(crc >> 8));
+    put(END);
+    return overflow ? 0 : pos;
+}
+
+// check and strip the CRC trailer of a decoded frame
+static ptrdiff_t checkCrc(const uint8_t *buf, size_t len) {
+    if (len < 2) {
+        return -1;
+    }
+    const auto payload = len - 2;
+    const uint16_t expected = buf[payload] | (buf[payload + 1] << 8);
+    return crc16(buf, payload) == expected ? static_cast<ptrdiff_t>(payload) : -1;
+}
+
+ptrdiff_t cobsDecode(uint8_t *buf, size_t len) {
+    size_t in = 0, out = 0;
+    while (in < len) {
+        const auto code = buf[in++];
+        if (code == 0 || in + code - 1 > len) {
+            return -1;
+        }
+        // out never passes in, so moving forward in place is safe
+        for (auto i = 1; i < code; i++) {
+            buf[out++] = buf[in++];
+        }
+        if (code != 0xff && in < len) {
+            buf[out++] = 0;
+        }
+    }
+    return checkCrc(buf, out);
+}
+
+ptrdiff_t slipDecode(uint8_t *buf, size_t len) {
+    size_t out = 0;
+    for (size_t in = 0; in < len; in++) {
+        auto b = buf[in];
+        if (b == SlipEncoder::ESC) {
+            if (++in == len) {
+                return -1;
+            }
+            b = buf[in] == SlipEncoder::ESC_END ? SlipEncoder::END : (buf[in] == SlipEncoder::ESC_ESC ? SlipEncoder::ESC : 0);
+            if (b == 0) {
+                return -1;
+            }
+        }
+        buf[out++] = b;
+    }
+    return checkCrc(buf, out);
+}
+
+FrameParser::FrameParser(uint8_t delimiter, DecodeFn *decode, FrameFn *fn, void *args) :
+    delimiter(delimiter), decode(decode), fn(fn), args(args), length(0), overflow(false) {}
+
+void FrameParser::consume(const uint8_t *data, size_t len) {
+    while (len) {
+        // copy up to the next delimiter in one go
+        auto end = static_cast<const uint8_t*>(memchr(data, delimiter, len));
+        const auto n = end ? static_cast<size_t>(end - data) : len;
+        if (!overflow && length + n <= sizeof(frame)) {
+            memcpy(frame + length, data, n);
+            length += n;
+        } else {
+            overflow = true;
+        }
+        if (end == nullptr) {
+            return;
+        }
+        // empty frames are delimiters back to back, e.g. the leading SLIP END
+        if (length || overflow) {
+            const auto payload = overflow ? -1 : decode(frame, length);
+            if (payload < 0) {
+                errorCount++;
+            } else if (fn) {
+                fn(frame, payload, args);
+            }
+        }
+        length = 0;
+        overflow = false;
+        data += n + 1;
+        len -= n + 1;
+    }
+}
@@ -0,0 +1,184 @@
+#pragma once
+
+#include <Arduino.h>
+#include "subsystem.h"
+#include "streamparser.h"
+#include "crc.h"
+
+#ifndef FRAMING_MAX_FRAME
+#define FRAMING_MAX_FRAME 256 ///< largest encoded frame a frame parser accepts
+#endif
+
+/**
+ * @brief streaming COBS encoder writing a frame straight into an output buffer, e.g. a UART TX buffer
+ *
+ * A frame is the payload followed by its CRC-16 (little endian), COBS encoded and terminated
+ * by a 0 delimiter. It takes at most len + (len + 2) / 254 + 4 bytes.
+ */
+class CobsEncoder {
+public:
+    /**
+     * @brief start a frame
+     *
+     * @param out buffer to encode into
+     * @param size of out
+     */
+    CobsEncoder(uint8_t *out, size_t size);
+
+    /**
+     * @brief append payload bytes
+     *
+     * @param data
+     * @param len
+     */
+    void write(const uint8_t *data, size_t len);
+
+    /**
+     * @brief append CRC and delimiter
+     *
+     * @return size_t length of the frame, 0 if out was too small
+     */
+    size_t end();
+
+private:
+    void put(uint8_t b);
+
+    uint8_t *out;
+    size_t size;
+    size_t pos;
+    size_t codePos;
+    uint8_t code;
+    uint16_t crc;
+    bool overflow;
+};
+
+/**
+ * @brief streaming SLIP (RFC 1055) encoder, framing like CobsEncoder
+ *
+ * A frame is a leading END, the escaped payload and CRC-16 (little endian) and a trailing END.
+ * It takes at most 2 * (len + 2) + 2 bytes.
+ */
+class SlipEncoder {
+public:
+    static const uint8_t END = 0xc0;
+    static const uint8_t ESC = 0xdb;
+    static const uint8_t ESC_END = 0xdc;
+    static const uint8_t ESC_ESC = 0xdd;
+
+    /**
+     * @brief start a frame
+     *
+     * @param out buffer to encode into
+     * @param size of out
+     */
+    SlipEncoder(uint8_t *out, size_t size);
+
+    /**
+     * @brief append payload bytes
+     *
+     * @param data
+     * @param len
+     */
+    void write(const uint8_t *data, size_t len);
+
+    /**
+     * @brief append CRC and END
+     *
+     * @return size_t length of the frame, 0 if out was too small
+     */
+    size_t end();
+
+private:
+    void put(uint8_t b);
+    void putEscaped(uint8_t b);
+
+    uint8_t *out;
+    size_t size;
+    size_t pos;
+    uint16_t crc;
+    bool overflow;
+};
+
+/**
+ * @brief encode a consistent snapshot of a DataThing into a frame, with the thing read locked
+ *
+ * @tparam Encoder CobsEncoder or SlipEncoder
+ * @tparam T
+ * @param thing
+ * @param out buffer to encode into
+ * @param size of out
+ * @return size_t length of the frame, 0 if out was too small
+ */
+template<class Encoder, class T, class Placement>
+size_t encodeFrame(const DataThing<T, Placement> &thing, uint8_t *out, size_t size) {
+    Encoder encoder(out, size);
+    thing.readData([](const T &data, void *args) {
+        static_cast<Encoder*>(args)->write(reinterpret_cast<const uint8_t*>(&data), sizeof(T));
+    }, &encoder);
+    return encoder.end();
+}
+
+/**
+ * @brief decode a COBS frame in place and check its CRC
+ *
+ * @param buf encoded frame, without the 0 delimiter
+ * @param len
+ * @return ptrdiff_t payload length, -1 on error
+ */
+ptrdiff_t cobsDecode(uint8_t *buf, size_t len);
+
+/**
+ * @brief decode a SLIP frame in place and check its CRC
+ *
+ * @param buf escaped frame, without END bytes
+ * @param len
+ * @return ptrdiff_t payload length, -1 on error
+ */
+ptrdiff_t slipDecode(uint8_t *buf, size_t len);
+
+/**
+ * @brief splits a byte stream into frames and decodes them in place. Not to be directly used
+ *
+ */
+class FrameParser : public StreamParser {
+public:
+    /**
+     * @brief called with the payload of each frame with a valid CRC, which may be empty
+     *
+     */
+    typedef void(FrameFn)(const uint8_t *payload, size_t len, void *args);
+
+    void consume(const uint8_t *data, size_t len);
+
+protected:
+    typedef ptrdiff_t(DecodeFn)(uint8_t *buf, size_t len);
+
+    FrameParser(uint8_t delimiter, DecodeFn *decode, FrameFn *fn, void *args);
+
+private:
+    const uint8_t delimiter;
+    DecodeFn *decode;
+    FrameFn *fn;
+    void *args;
+    size_t length;
+    bool overflow;
+    uint8_t frame[FRAMING_MAX_FRAME];
+};
+
+/**
+ * @brief parses frames made by CobsEncoder
+ *
+ */
+class CobsFrameParser : public FrameParser {
+public:
+    CobsFrameParser(FrameFn *fn, void *args) : FrameParser(0, cobsDecode, fn, args) {}
+};
+
+/**
+ * @brief parses frames made by SlipEncoder
+ *
+ */
+class SlipFrameParser : public FrameParser {
+public:
+    SlipFrameParser(FrameFn *fn, void *args) : FrameParser(SlipEncoder::END, slipDecode, fn, args) {}
+};
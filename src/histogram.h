@@ -0,0 +1,172 @@
+#pragma once
+
+#include <Arduino.h>
+#include <atomic>
+
+/**
+ * @brief Fixed size log-linear histogram for latencies and other non-negative integers
+ *
+ * Values below 2^SUB_BITS get a bucket each; above that every power of 2 range is split
+ * into 2^SUB_BITS linear buckets, so the relative error of a bucket is at most 2^-SUB_BITS.
+ * Values of 2^MAX_BITS and above are counted in the last bucket. record() is O(1), uses no
+ * floating point and may be called concurrently from any task or ISR.
+ *
+ * With the defaults (12.5% precision up to about 1 second in microseconds) it takes 580 bytes.
+ *
+ * @tparam SUB_BITS log2 of the number of linear buckets per power of 2
+ * @tparam MAX_BITS log2 of the largest value tracked exactly
+ */
+template<unsigned SUB_BITS = 3, unsigned MAX_BITS = 20>
+class LatencyHistogram {
+public:
+    static_assert(SUB_BITS > 0 && SUB_BITS < MAX_BITS && MAX_BITS <= 32, "bad histogram dimensions");
+
+    static constexpr size_t NUM_BUCKETS = (MAX_BITS - SUB_BITS + 1) << SUB_BITS;
+
+    LatencyHistogram() {
+        reset();
+    }
+
+    /**
+     * @brief record one value
+     *
+     * @param v
+     */
+    void record(uint32_t v) {
+        counts[bucketOf(v)].fetch_add(1, std::memory_order_relaxed);
+        auto m = maximum.load(std::memory_order_relaxed);
+        while (v > m && !maximum.compare_exchange_weak(m, v, std::memory_order_relaxed)) {
+        }
+    }
+
+    /**
+     * @brief add the counts of another histogram of the same type, e.g. one per core
+     *
+     * @param other
+     */
+    void merge(const LatencyHistogram &other) {
+        for (size_t i = 0; i < NUM_BUCKETS; i++) {
+            counts[i].fetch_add(other.counts[i].load(std::memory_order_relaxed), std::memory_order_relaxed);
+        }
+        const auto v = other.max();
+        auto m = maximum.load(std::memory_order_relaxed);
+        while (v > m && !maximum.compare_exchange_weak(m, v, std::memory_order_relaxed)) {
+        }
+    }
+
+    /**
+     * @brief clear all counts
+     *
+     */
+    void reset() {
+        for (auto &c : counts) {
+            c.store(0, std::memory_order_relaxed);
+        }
+        maximum.store(0, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief the number of values recorded
+     *
+     * @return uint32_t
+     */
+    uint32_t count() const {
+        uint32_t total = 0;
+        for (auto &c : counts) {
+            total += c.load(std::memory_order_relaxed);
+        }
+        return total;
+    }
+
+    /**
+     * @brief the largest value recorded
+     *
+     * @return uint32_t
+     */
+    uint32_t max() const {
+        return maximum.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief the value below which the given share of recorded values fall
+     *
+     * @param perMille e.g. 500 for the median, 990 for the 99th percentile
+     * @return uint32_t the upper bound of the bucket containing the percentile, capped at max()
+     */
+    uint32_t percentile(uint32_t perMille) const {
+        const auto total = count();
+        if (total == 0) {
+            return 0;
+        }
+        // rank of the wanted value, 1 based
+        auto rank = static_cast<uint32_t>((static_cast<uint64_t>(total) * perMille + 999) / 1000);
+        if (rank == 0) {
+            rank = 1;
+        }
+        uint32_t seen = 0;
+        for (size_t i = 0; i < NUM_BUCKETS; i++) {
+            seen += counts[i].load(std::memory_order_relaxed);
+            if (seen >= rank) {
+                const auto upper = upperBoundOf(i);
+                return upper < max() ? upper : max();
+            }
+        }
+        return max();
+    }
+
+    /**
+     * @brief the number of values in bucket i
+     *
+     * @param i
+     * @return uint32_t
+     */
+    uint32_t bucketCount(size_t i) const {
+        return i < NUM_BUCKETS ? counts[i].load(std::memory_order_relaxed) : 0;
+    }
+
+    /**
+     * @brief the smallest value counted in bucket i
+     *
+     * @param i
+     * @return uint32_t
+     */
+    static constexpr uint32_t lowerBoundOf(size_t i) {
+        return (i >> SUB_BITS) == 0
+            ? static_cast<uint32_t>(i)
+            : static_cast<uint32_t>(((1UL << SUB_BITS) | (i & ((1UL << SUB_BITS) - 1))) << ((i >> SUB_BITS) - 1));
+    }
+
+    /**
+     * @brief the largest value counted in bucket i
+     *
+     * @param i
+     * @return uint32_t
+     */
+    static constexpr uint32_t upperBoundOf(size_t i) {
+        return i + 1 >= NUM_BUCKETS ? UINT32_MAX : lowerBoundOf(i + 1) - 1;
+    }
+
+    /**
+     * @brief the bucket a value is counted in
+     *
+     * @param v
+     * @return size_t
+     */
+    static size_t bucketOf(uint32_t v) {
+        if (v < (1UL << SUB_BITS)) {
+            return v;
+        }
+        const unsigned msb = 31 - __builtin_clz(v);
+        if (msb >= MAX_BITS) {
+            return NUM_BUCKETS - 1;
+        }
+        const auto shift = msb - SUB_BITS;
+        return ((shift + 1) << SUB_BITS) + ((v >> shift) & ((1UL << SUB_BITS) - 1));
+    }
+
+private:
+    LatencyHistogram(const LatencyHistogram &other) = delete;
+
+    std::atomic<uint32_t> counts[NUM_BUCKETS];
+    std::atomic<uint32_t> maximum;
+};
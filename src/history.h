@@ -0,0 +1,129 @@
+#pragma once
+
+#include <Arduino.h>
+#include "subsystem.h"
+
+/**
+ * @brief HistoryDataThing is a DataThing that keeps its last N values and is published in batches
+ *
+ * A producer sampling faster than its consumers care to be woken, e.g. an IMU FIFO, publishes
+ * a whole batch with one lock and one round of notifications. Regular callbacks see the
+ * latest value, batch callbacks see every sample of the batch, and readHistory() gives the
+ * last N.
+ *
+ * The placement applies to the N values kept: a large history can live in PSRAM while the
+ * latest value, read by every callback, stays in the object.
+ *
+ * @tparam T
+ * @tparam N number of values kept
+ * @tparam Placement where the history is kept, see placement.h
+ */
+template<class T, size_t N, class Placement = InlinePlacement>
+class HistoryDataThing : public DataThing<T> {
+public:
+    typedef void(BatchFn)(const T *samples, size_t count, void *args);
+
+    /**
+     * @brief Construct a new History Data Thing object
+     *
+     * @note Use this constructor in your subclass's constructor as HistoryDataThing<klass, N>(rwLock)
+     *
+     * @param locker a ReadWriteLocker to lock
+     */
+    HistoryDataThing(ReadWriteLock &locker) : DataThing<T>(locker), historyLock(locker), ring(), history(ring.get()), head(0), total(0), numBatchCallbacks(0) {}
+
+    /**
+     * @brief register a callback to be called with each published batch
+     *
+     * @param fn called with the samples of the batch, oldest first
+     * @param args additional arguments to call fn with
+     */
+    void registerBatchCallback(BatchFn *fn, void *args) {
+        historyLock.Lock();
+        if (numBatchCallbacks < MAX_BATCH_CALLBACKS) {
+            batchCallbacks[numBatchCallbacks].fn = fn;
+            batchCallbacks[numBatchCallbacks].args = args;
+            numBatchCallbacks++;
+        }
+        historyLock.UnLock();
+    }
+
+    /**
+     * @brief copy the most recent values
+     *
+     * @param out
+     * @param count at most this many
+     * @return size_t number copied, oldest first
+     */
+    size_t readHistory(T *out, size_t count) const {
+        historyLock.RLock();
+        const auto available = total < N ? static_cast<size_t>(total) : N;
+        if (count > available) {
+            count = available;
+        }
+        auto i = (head + N - count) % N;
+        for (size_t n = 0; n < count; n++) {
+            out[n] = history[i];
+            i = i + 1 == N ? 0 : i + 1;
+        }
+        historyLock.RUnlock();
+        return count;
+    }
+
+    /**
+     * @brief publish a batch of values, the last one becoming the current data
+     *
+     * @param samples oldest first
+     * @param count
+     */
+    void publish(const T *samples, size_t count) {
+        if (count == 0) {
+            return;
+        }
+        historyLock.Lock();
+        this->willWrite();
+        // only the last N can be kept
+        const auto skip = count > N ? count - N : 0;
+        for (auto i = skip; i < count; i++) {
+            history[head] = samples[i];
+            head = head + 1 == N ? 0 : head + 1;
+        }
+        total += count;
+        this->data = samples[count - 1];
+        const auto n = numBatchCallbacks;
+        historyLock.UnLock();
+
+        this->callCallbacks();
+        for (size_t i = 0; i < n; i++) {
+            batchCallbacks[i].fn(samples, count, batchCallbacks[i].args);
+        }
+    }
+
+    /**
+     * @brief total number of values published so far
+     *
+     * @return uint32_t
+     */
+    uint32_t sequence() const {
+        historyLock.RLock();
+        const auto s = total;
+        historyLock.RUnlock();
+        return s;
+    }
+
+private:
+    static constexpr size_t MAX_BATCH_CALLBACKS = 4;
+
+    struct BatchCallback {
+        BatchFn *fn;
+        void *args;
+    };
+
+    ReadWriteLock &historyLock;
+    typename Placement::template Storage<T, N> ring;
+    T *const history;
+    size_t head;    ///< where the next value goes
+    uint32_t total;
+    size_t numBatchCallbacks;
+    BatchCallback batchCallbacks[MAX_BATCH_CALLBACKS];
+};
@@ -0,0 +1,458 @@
+#include "logger.h"
+#include <Arduino.h>
+#include "framing.h"
+
+namespace {
+
+void putU16(uint8_t *p, uint16_t v) {
+    p[0] = v;
+    p[1] = v >> 8;
+}
+
+void putU32(uint8_t *p, uint32_t v) {
+    putU16(p, v);
+    putU16(p + 2, v >> 16);
+}
+
+uint16_t getU16(const uint8_t *p) {
+    return p[0] | p[1] << 8;
+}
+
+uint32_t getU32(const uint8_t *p) {
+    return getU16(p) | static_cast<uint32_t>(getU16(p + 2)) << 16;
+}
+
+// encode a payload into a frame and write it
+void writeFrame(Print &out, const uint8_t *payload, size_t len) {
+    uint8_t frame[FRAMING_MAX_FRAME];
+    CobsEncoder encoder(frame, sizeof(frame));
+    encoder.write(payload, len);
+    const auto n = encoder.end();
+    if (n) {
+        out.write(frame, n);
+    }
+}
+
+// the largest payload that always fits in a frame a FrameParser accepts
+constexpr size_t MAX_PAYLOAD = FRAMING_MAX_FRAME - FRAMING_MAX_FRAME / 254 - 5;
+
+}
+
+LoggerClass::LoggerClass() :
+    droppedCount(0), reportedDropped(0), output(&Serial), outputFormat(TEXT), formats(), namesSent(0), spec(this, nullptr) {
+    name = "Logger";
+    for (auto &ring : rings) {
+        ring.head.store(0, std::memory_order_relaxed);
+        ring.tail = 0;
+        for (uint32_t i = 0; i < RING_SIZE; i++) {
+            ring.records[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+    drainMutex = xSemaphoreCreateMutexStatic(&drainMutexBuffer);
+    SubsystemManager.addSubsystem(&spec);
+}
+
+LoggerClass::~LoggerClass() {}
+
+BaseSubsystem::Status LoggerClass::setup() {
+    setStatus(READY);
+    return getStatus();
+}
+
+void LoggerClass::setOutput(Print &out, Format format) {
+    // the drain mutex keeps the BINARY state from changing under the draining task
+    xSemaphoreTake(drainMutex, portMAX_DELAY);
+    rwLock.Lock();
+    output = &out;
+    outputFormat = format;
+    rwLock.UnLock();
+    // a new output has seen no definitions
+    memset(formats, 0, sizeof(formats));
+    namesSent = 0;
+    xSemaphoreGive(drainMutex);
+}
+
+uint32_t LoggerClass::dropped() const {
+    return droppedCount.load(std::memory_order_relaxed);
+}
+
+void IRAM_ATTR LoggerClass::push(const char *fmt, const Arg *args, uint8_t numArgs, uint8_t source) {
+    auto &ring = rings[xPortGetCoreID()];
+    auto pos = ring.head.load(std::memory_order_relaxed);
+    Record *record;
+    for (;;) {
+        record = &ring.records[pos & (RING_SIZE - 1)];
+        const auto seq = record->sequence.load(std::memory_order_acquire);
+        const auto diff = static_cast<int32_t>(seq - pos);
+        if (diff == 0) {
+            if (ring.head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            droppedCount.fetch_add(1, std::memory_order_relaxed);
+            return;
+        } else {
+            pos = ring.head.load(std::memory_order_relaxed);
+        }
+    }
+    record->timestamp = micros();
+    record->fmt = fmt;
+    record->numArgs = numArgs;
+    record->source = source;
+    for (auto i = 0; i < numArgs; i++) {
+        record->args[i] = args[i];
+    }
+    record->sequence.store(pos + 1, std::memory_order_release);
+}
+
+LoggerClass::Record *LoggerClass::peek(Ring &ring) {
+    auto record = &ring.records[ring.tail & (RING_SIZE - 1)];
+    if (record->sequence.load(std::memory_order_acquire) != ring.tail + 1) {
+        return nullptr;
+    }
+    return record;
+}
+
+void LoggerClass::drain() {
+    xSemaphoreTake(drainMutex, portMAX_DELAY);
+    rwLock.RLock();
+    auto &out = *output;
+    const auto binary = outputFormat == BINARY;
+    rwLock.RUnlock();
+    for (;;) {
+        // merge the per core rings, oldest first
+        Ring *oldest = nullptr;
+        Record *record = nullptr;
+        for (auto &ring : rings) {
+            auto r = peek(ring);
+            if (r && (record == nullptr || static_cast<int32_t>(r->timestamp - record->timestamp) < 0)) {
+                oldest = &ring;
+                record = r;
+            }
+        }
+        if (record == nullptr) {
+            break;
+        }
+        if (binary) {
+            writeBinary(out, *record);
+        } else {
+            write(out, *record);
+        }
+        record->sequence.store(oldest->tail + RING_SIZE, std::memory_order_release);
+        oldest->tail++;
+    }
+    const auto lost = dropped();
+    if (lost != reportedDropped) {
+        if (binary) {
+            uint8_t payload[5] = {DROPPED_FRAME};
+            putU32(payload + 1, lost - reportedDropped);
+            writeFrame(out, payload, sizeof(payload));
+        } else {
+            out.printf("[logger dropped %u messages]\n", (unsigned)(lost - reportedDropped));
+        }
+        reportedDropped = lost;
+    }
+    xSemaphoreGive(drainMutex);
+}
+
+void LoggerClass::write(Print &out, const Record &record) {
+    if (record.source != NO_ID) {
+        out.printf("[%s] ", SubsystemManager.nameOf(record.source));
+    }
+    format(out, record.fmt, record.args, record.numArgs);
+}
+
+uint16_t LoggerClass::formatId(Print &out, const char *fmt) {
+    auto id = static_cast<uint16_t>((reinterpret_cast<uintptr_t>(fmt) >> 2) & (MAX_FORMATS - 1));
+    for (uint16_t probes = 0; formats[id].fmt != fmt; probes++) {
+        if (probes == MAX_FORMATS) {
+            // full: start over, the decoder replaces definitions it sees again
+            memset(formats, 0, sizeof(formats));
+        }
+        if (formats[id].fmt == nullptr) {
+            uint8_t payload[MAX_PAYLOAD];
+            payload[0] = FORMAT_FRAME;
+            putU16(payload + 1, id);
+            const auto len = strnlen(fmt, sizeof(payload) - 3);
+            memcpy(payload + 3, fmt, len);
+            writeFrame(out, payload, len + 3);
+            formats[id].fmt = fmt;
+            formats[id].stringArgs = stringArgs(fmt);
+            break;
+        }
+        id = (id + 1) & (MAX_FORMATS - 1);
+    }
+    return id;
+}
+
+void LoggerClass::writeBinary(Print &out, const Record &record) {
+    const auto id = formatId(out, record.fmt);
+    if (record.source != NO_ID && !(namesSent & (1ULL << record.source))) {
+        uint8_t payload[MAX_PAYLOAD] = {NAME_FRAME, record.source};
+        const auto name = SubsystemManager.nameOf(record.source);
+        const auto len = strnlen(name, sizeof(payload) - 2);
+        memcpy(payload + 2, name, len);
+        writeFrame(out, payload, len + 2);
+        namesSent |= 1ULL << record.source;
+    }
+    uint8_t payload[MAX_PAYLOAD];
+    payload[0] = RECORD_FRAME;
+    putU16(payload + 1, id);
+    putU32(payload + 3, record.timestamp);
+    payload[7] = record.source;
+    size_t len = 8;
+    for (auto i = 0; i < record.numArgs; i++) {
+        const auto &a = record.args[i];
+        if (formats[id].stringArgs & (1 << i)) {
+            // strings are cut to fit, the terminator is always sent
+            const auto s = a.p ? static_cast<const char*>(a.p) : "(null)";
+            const auto room = sizeof(payload) - len - 4 * (record.numArgs - i - 1) - 1;
+            const auto n = strnlen(s, room);
+            memcpy(payload + len, s, n);
+            len += n;
+            payload[len++] = 0;
+        } else {
+            putU32(payload + len, a.u);
+            len += 4;
+        }
+    }
+    writeFrame(out, payload, len);
+}
+
+uint8_t LoggerClass::stringArgs(const char *fmt) {
+    // walks conversions exactly like format()
+    uint8_t mask = 0;
+    uint8_t arg = 0;
+    for (auto p = fmt; *p && arg < MAX_ARGS; p++) {
+        if (*p != '%') {
+            continue;
+        }
+        if (p[1] == '%') {
+            p++;
+            continue;
+        }
+        p++;
+        while (*p && strchr("-+ #0123456789.hlLqjzt", *p)) {
+            p++;
+        }
+        if (*p == '\0') {
+            break;
+        }
+        if (*p == 's') {
+            mask |= 1 << arg;
+        }
+        arg++;
+    }
+    return mask;
+}
+
+void LoggerClass::format(Print &out, const char *fmt, const Arg *args, uint8_t numArgs) {
+    char spec[16];
+    char buf[64];
+    auto arg = 0;
+
+    for (auto p = fmt; *p; p++) {
+        if (*p != '%') {
+            out.write(*p);
+            continue;
+        }
+        if (p[1] == '%') {
+            out.write('%');
+            p++;
+            continue;
+        }
+        // copy flags, width and precision, skip length modifiers
+        size_t len = 0;
+        spec[len++] = *p++;
+        while (*p && strchr("-+ #0123456789.", *p) && len < sizeof(spec) - 2) {
+            spec[len++] = *p++;
+        }
+        while (*p && strchr("hlLqjzt", *p)) {
+            p++;
+        }
+        if (*p == '\0') {
+            break;
+        }
+        spec[len++] = *p;
+        spec[len] = '\0';
+        if (arg >= numArgs) {
+            out.write(reinterpret_cast<const uint8_t*>(spec), len);
+            continue;
+        }
+        const auto &a = args[arg++];
+        switch (*p) {
+        case 'd':
+        case 'i':
+            snprintf(buf, sizeof(buf), spec, static_cast<int>(a.u));
+            break;
+        case 'u':
+        case 'x':
+        case 'X':
+        case 'o':
+        case 'c':
+            snprintf(buf, sizeof(buf), spec, static_cast<unsigned>(a.u));
+            break;
+        case 'f':
+        case 'F':
+        case 'e':
+        case 'E':
+        case 'g':
+        case 'G':
+            snprintf(buf, sizeof(buf), spec, static_cast<double>(a.f));
+            break;
+        case 's':
+            if (len == 2) {
+                // plain %s, may be longer than buf
+                out.print(a.p ? static_cast<const char*>(a.p) : "(null)");
+                continue;
+            }
+            snprintf(buf, sizeof(buf), spec, a.p ? static_cast<const char*>(a.p) : "(null)");
+            break;
+        case 'p':
+            snprintf(buf, sizeof(buf), spec, a.p);
+            break;
+        default:
+            snprintf(buf, sizeof(buf), "%s", spec);
+            break;
+        }
+        out.print(buf);
+    }
+}
+
+void LoggerClass::flush() {
+    drain();
+}
+
+void LoggerClass::taskFunction(void */*parameter*/) {
+    for (;;) {
+        drain();
+        vTaskDelay(pdMS_TO_TICKS(DRAIN_INTERVAL_MS));
+    }
+}
+
+struct LogDecoder::State {
+    State(LogDecoder *decoder) : parser(onFrame, decoder), formats(), names(), errors(0) {}
+
+    CobsFrameParser parser;
+    char *formats[LOGGER_MAX_FORMATS];
+    char *names[SubsystemManagerClass::MAX_IDS];
+    uint32_t errors;
+};
+
+LogDecoder::LogDecoder(Print &out, bool timestamps) : out(out), timestamps(timestamps), state(new State(this)) {}
+
+LogDecoder::~LogDecoder() {
+    for (auto f : state->formats) {
+        free(f);
+    }
+    for (auto n : state->names) {
+        free(n);
+    }
+    delete state;
+}
+
+void LogDecoder::consume(const uint8_t *data, size_t len) {
+    state->parser.consume(data, len);
+}
+
+uint32_t LogDecoder::errors() const {
+    return state->errors + state->parser.errors();
+}
+
+void LogDecoder::onFrame(const uint8_t *payload, size_t len, void *args) {
+    static_cast<LogDecoder*>(args)->decode(payload, len);
+}
+
+void LogDecoder::decode(const uint8_t *payload, size_t len) {
+    // replace a definition with the string in payload[from, len)
+    auto define = [payload, len](char *&slot, size_t from) {
+        free(slot);
+        slot = static_cast<char*>(malloc(len - from + 1));
+        memcpy(slot, payload + from, len - from);
+        slot[len - from] = '\0';
+    };
+    if (len == 0) {
+        state->errors++;
+        return;
+    }
+    switch (payload[0]) {
+    case LoggerClass::FORMAT_FRAME:
+        if (len < 3 || getU16(payload + 1) >= LOGGER_MAX_FORMATS) {
+            break;
+        }
+        define(state->formats[getU16(payload + 1)], 3);
+        return;
+    case LoggerClass::NAME_FRAME:
+        if (len < 2 || payload[1] >= SubsystemManagerClass::MAX_IDS) {
+            break;
+        }
+        define(state->names[payload[1]], 2);
+        return;
+    case LoggerClass::DROPPED_FRAME:
+        if (len != 5) {
+            break;
+        }
+        out.printf("[logger dropped %u messages]\n", (unsigned)getU32(payload + 1));
+        return;
+    case LoggerClass::RECORD_FRAME: {
+        if (len < 8) {
+            break;
+        }
+        const auto id = getU16(payload + 1);
+        const auto source = payload[7];
+        const char *fmt = id < LOGGER_MAX_FORMATS ? state->formats[id] : nullptr;
+        if (timestamps) {
+            out.printf("%10u ", (unsigned)getU32(payload + 3));
+        }
+        if (source != BaseSubsystem::NO_ID) {
+            const char *name = source < SubsystemManagerClass::MAX_IDS ? state->names[source] : nullptr;
+            if (name) {
+                out.printf("[%s] ", name);
+            } else {
+                out.printf("[#%u] ", (unsigned)source);
+            }
+        }
+        if (fmt == nullptr) {
+            out.printf("<format %u>\n", (unsigned)id);
+            return;
+        }
+        // take the arguments apart the way LoggerClass put them together
+        LoggerClass::Arg args[LoggerClass::MAX_ARGS];
+        uint8_t numArgs = 0;
+        size_t pos = 8;
+        const auto stringArgs = LoggerClass::stringArgs(fmt);
+        while (pos < len && numArgs < LoggerClass::MAX_ARGS) {
+            auto &a = args[numArgs];
+            if (stringArgs & (1 << numArgs)) {
+                const auto end = static_cast<const uint8_t*>(memchr(payload + pos, 0, len - pos));
+                if (end == nullptr) {
+                    break;
+                }
+                a.p = payload + pos;
+                pos = end - payload + 1;
+            } else {
+                if (len - pos < 4) {
+                    break;
+                }
+                // pointers are 32 bits on the target
+                a.p = nullptr;
+                a.u = getU32(payload + pos);
+                pos += 4;
+            }
+            numArgs++;
+        }
+        if (pos != len) {
+            break;
+        }
+        LoggerClass::format(out, fmt, args, numArgs);
+        return;
+    }
+    default:
+        break;
+    }
+    state->errors++;
+}
+
+#ifdef SUBSYSTEM_LOGGER
+LoggerClass Logger;
+#endif
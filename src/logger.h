@@ -0,0 +1,264 @@
+#pragma once
+
+#include <Arduino.h>
+#include <atomic>
+#include "subsystem.h"
+
+// MANAGER_DEBUG output goes through the Logger
+#if defined(MANAGER_DEBUG) && !defined(SUBSYSTEM_LOGGER)
+#define SUBSYSTEM_LOGGER
+#endif
+
+#ifndef LOGGER_RING_SIZE
+#define LOGGER_RING_SIZE 64 ///< records per core, must be a power of 2
+#endif
+
+#ifndef LOGGER_MAX_FORMATS
+#define LOGGER_MAX_FORMATS 64 ///< format strings with an id in binary output, must be a power of 2
+#endif
+
+/**
+ * @brief Logger defers formatting and output of log messages to a low priority task
+ *
+ * log() only stores the format string pointer, a timestamp and the raw arguments in a
+ * lock-free ring belonging to the calling core, so it is safe to call from any task or ISR
+ * and never waits on the UART. The logger task merges the rings in timestamp order,
+ * formats the records and writes them to the output.
+ *
+ * In BINARY output the logger task does not format at all. Each record is written as a
+ * frame holding a format id, the timestamp, the source id and the raw arguments; the format
+ * string and subsystem name behind an id are sent once, the first time it is used. Frames
+ * are COBS encoded with a CRC, see CobsEncoder, and LogDecoder turns them back into text on
+ * the host, e.g. with test/host/logdecode. The output can be a UART or a file on flash:
+ *
+ *     Logger.setOutput(logFile, LoggerClass::BINARY);
+ *
+ * The global Logger, with its task and rings, only exists if built with SUBSYSTEM_LOGGER,
+ * which MANAGER_DEBUG implies, so applications that don't log don't pay for it.
+ *
+ * @note the format string and any %s arguments are kept as pointers until the record is
+ * drained, so they must be string literals or otherwise outlive the call
+ */
+class LoggerClass : public ThreadedSubsystem {
+public:
+    /**
+     * @brief maximum number of arguments per message
+     *
+     */
+    static constexpr size_t MAX_ARGS = 6;
+
+    /**
+     * @brief how records are written to the output
+     *
+     */
+    enum Format {
+        TEXT,       ///< formatted on target
+        BINARY,     ///< format id and raw arguments, see LogDecoder
+    };
+
+    /**
+     * @brief type, the first byte, of a BINARY frame. Multi byte fields are little endian
+     *
+     */
+    enum FrameType : uint8_t {
+        FORMAT_FRAME = 1,   ///< uint16 format id, format string
+        NAME_FRAME,         ///< uint8 subsystem id, name
+        RECORD_FRAME,       ///< uint16 format id, uint32 micros, uint8 subsystem id, arguments
+        DROPPED_FRAME,      ///< uint32 messages dropped since the last one
+    };
+
+    /**
+     * @brief a raw argument. In a RECORD_FRAME each is 4 bytes, except %s arguments which are
+     * sent as a 0 terminated string
+     *
+     */
+    union Arg {
+        Arg() : u(0) {}
+        uint32_t u;
+        float f;
+        const void *p;
+    };
+
+    LoggerClass();
+    virtual ~LoggerClass();
+
+    Status setup();
+
+    /**
+     * @brief log a printf style message
+     *
+     * Supports the d, i, u, x, X, o, c, f, e, g, s and p conversions with flags, width and
+     * precision. Length modifiers are ignored; integers are stored as 32 bits and floating
+     * point values as float. If the ring of the calling core is full the message is dropped.
+     *
+     * @param fmt format string, must be static
+     * @param args at most MAX_ARGS arguments
+     */
+    template<class... Args>
+    void log(const char *fmt, Args... args) {
+        static_assert(sizeof...(Args) <= MAX_ARGS, "too many arguments to log");
+        const Arg packed[] = {pack(args)..., Arg()};
+        push(fmt, packed, sizeof...(Args), BaseSubsystem::NO_ID);
+    }
+
+    /**
+     * @brief log a message prefixed with the name of a subsystem
+     *
+     * Only the subsystem's id is stored, the name is looked up when the message is written.
+     *
+     * @param from usually this
+     * @param fmt see log()
+     * @param args see log()
+     */
+    template<class... Args>
+    void log(const BaseSubsystem *from, const char *fmt, Args... args) {
+        static_assert(sizeof...(Args) <= MAX_ARGS, "too many arguments to log");
+        const Arg packed[] = {pack(args)..., Arg()};
+        push(fmt, packed, sizeof...(Args), from->getId());
+    }
+
+    /**
+     * @brief Set where messages are written to. Defaults to Serial as TEXT
+     *
+     * @param out
+     * @param format
+     */
+    void setOutput(Print &out, Format format = TEXT);
+
+    /**
+     * @brief format and write all pending messages from the calling task, e.g. before a restart
+     *
+     */
+    void flush();
+
+    /**
+     * @brief number of messages dropped because a ring was full
+     *
+     * @return uint32_t
+     */
+    uint32_t dropped() const;
+
+    /**
+     * @brief format a message as log() would
+     *
+     * @param out
+     * @param fmt
+     * @param args
+     * @param numArgs
+     */
+    static void format(Print &out, const char *fmt, const Arg *args, uint8_t numArgs);
+
+protected:
+    void taskFunction(void *parameter);
+
+private:
+    friend class LogDecoder;
+
+    static constexpr uint32_t RING_SIZE = LOGGER_RING_SIZE;
+    static_assert((RING_SIZE & (RING_SIZE - 1)) == 0, "LOGGER_RING_SIZE must be a power of 2");
+    static constexpr auto DRAIN_INTERVAL_MS = 20;
+    static constexpr uint16_t MAX_FORMATS = LOGGER_MAX_FORMATS;
+    static_assert((MAX_FORMATS & (MAX_FORMATS - 1)) == 0, "LOGGER_MAX_FORMATS must be a power of 2");
+
+    struct Record {
+        std::atomic<uint32_t> sequence;
+        uint32_t timestamp;
+        const char *fmt;
+        uint8_t numArgs;
+        uint8_t source;     ///< id of the logging subsystem or NO_ID
+        Arg args[MAX_ARGS];
+    };
+
+    // bounded multi producer, single consumer queue
+    struct Ring {
+        std::atomic<uint32_t> head;
+        uint32_t tail;
+        Record records[RING_SIZE];
+    };
+
+    // format strings sent in BINARY output, the id is the slot
+    struct FormatSlot {
+        const char *fmt;
+        uint8_t stringArgs; ///< bit n set if argument n is a %s
+    };
+
+    template<class T>
+    static Arg pack(T value) {
+        static_assert(sizeof(T) <= sizeof(uint32_t), "64 bit integers are not supported, cast to 32 bit");
+        Arg a;
+        a.u = static_cast<uint32_t>(value);
+        return a;
+    }
+    static Arg pack(float value) { Arg a; a.f = value; return a; }
+    static Arg pack(double value) { Arg a; a.f = static_cast<float>(value); return a; }
+    template<class T>
+    static Arg pack(T *value) { Arg a; a.p = value; return a; }
+
+    void push(const char *fmt, const Arg *args, uint8_t numArgs, uint8_t source);
+    Record *peek(Ring &ring);
+    void drain();
+    void write(Print &out, const Record &record);
+    void writeBinary(Print &out, const Record &record);
+    uint16_t formatId(Print &out, const char *fmt);
+    static uint8_t stringArgs(const char *fmt);
+
+    Ring rings[portNUM_PROCESSORS];
+    std::atomic<uint32_t> droppedCount;
+    uint32_t reportedDropped;
+    Print *output;
+    Format outputFormat;
+    // BINARY output state, only used by the draining task
+    FormatSlot formats[MAX_FORMATS];
+    uint64_t namesSent;
+    StaticSemaphore_t drainMutexBuffer;
+    SemaphoreHandle_t drainMutex;
+
+    SubsystemManagerClass::Spec spec;
+};
+
+/**
+ * @brief turns the BINARY output of a LoggerClass back into text, as TEXT output would have been
+ *
+ * Feed it the byte stream with consume(). Records whose format or name definition was lost,
+ * e.g. because decoding started mid stream, are printed with the ids instead.
+ */
+class LogDecoder {
+public:
+    /**
+     * @brief
+     *
+     * @param out where the text goes
+     * @param timestamps prefix each message with its micros() timestamp
+     */
+    LogDecoder(Print &out, bool timestamps = false);
+    ~LogDecoder();
+
+    /**
+     * @brief decode a part of the stream
+     *
+     * @param data
+     * @param len
+     */
+    void consume(const uint8_t *data, size_t len);
+
+    /**
+     * @brief frames with a bad CRC or that could not be decoded
+     *
+     * @return uint32_t
+     */
+    uint32_t errors() const;
+
+private:
+    struct State;
+
+    static void onFrame(const uint8_t *payload, size_t len, void *args);
+    void decode(const uint8_t *payload, size_t len);
+
+    Print &out;
+    const bool timestamps;
+    State *state;
+};
+
+#ifdef SUBSYSTEM_LOGGER
+extern LoggerClass Logger;
+#endif
@@ -0,0 +1,341 @@
+#pragma once
+
+#include <stddef.h>
+#include <math.h>
+#include <limits>
+
+// esp-dsp has assembly matrix multiply kernels for the ESP32 and ESP32-S3; define to 0 to not use them
+#ifndef MATRIX_ESP_DSP
+#if defined(ESP_PLATFORM) && defined(__has_include)
+#if __has_include(<dspm_mult.h>)
+#define MATRIX_ESP_DSP 1
+#endif
+#endif
+#endif
+
+#if MATRIX_ESP_DSP
+#include <dspm_mult.h>
+#endif
+
+/**
+ * @brief a fixed size, row major matrix. No heap, sizes checked at compile time
+ *
+ * Matrix<3, 3> a = {{{1, 0, 0}, {0, 1, 0}, {0, 0, 1}}};
+ *
+ * Loops have compile time bounds, so the compiler unrolls and vectorizes them. The operators
+ * return by value for convenience; in estimator hot paths use multiply() and friends into
+ * preallocated results.
+ *
+ * @tparam R rows
+ * @tparam C columns
+ * @tparam T element type
+ */
+template<size_t R, size_t C, class T = float>
+struct Matrix {
+    T m[R][C];
+
+    static constexpr size_t ROWS = R;
+    static constexpr size_t COLS = C;
+
+    T &operator()(size_t r, size_t c) { return m[r][c]; }
+    const T &operator()(size_t r, size_t c) const { return m[r][c]; }
+
+    /**
+     * @brief element of a vector
+     *
+     */
+    T &operator[](size_t i) {
+        static_assert(C == 1, "only vectors are indexed by one subscript");
+        return m[i][0];
+    }
+    const T &operator[](size_t i) const {
+        static_assert(C == 1, "only vectors are indexed by one subscript");
+        return m[i][0];
+    }
+
+    static Matrix zeros() {
+        Matrix z;
+        for (size_t r = 0; r < R; r++) {
+            for (size_t c = 0; c < C; c++) {
+                z.m[r][c] = 0;
+            }
+        }
+        return z;
+    }
+
+    static Matrix identity() {
+        static_assert(R == C, "identity must be square");
+        auto i = zeros();
+        for (size_t d = 0; d < R; d++) {
+            i.m[d][d] = 1;
+        }
+        return i;
+    }
+
+    Matrix<C, R, T> transposed() const {
+        Matrix<C, R, T> t;
+        for (size_t r = 0; r < R; r++) {
+            for (size_t c = 0; c < C; c++) {
+                t.m[c][r] = m[r][c];
+            }
+        }
+        return t;
+    }
+
+    Matrix &operator+=(const Matrix &other) {
+        for (size_t r = 0; r < R; r++) {
+            for (size_t c = 0; c < C; c++) {
+                m[r][c] += other.m[r][c];
+            }
+        }
+        return *this;
+    }
+
+    Matrix &operator-=(const Matrix &other) {
+        for (size_t r = 0; r < R; r++) {
+            for (size_t c = 0; c < C; c++) {
+                m[r][c] -= other.m[r][c];
+            }
+        }
+        return *this;
+    }
+
+    Matrix &operator*=(T s) {
+        for (size_t r = 0; r < R; r++) {
+            for (size_t c = 0; c < C; c++) {
+                m[r][c] *= s;
+            }
+        }
+        return *this;
+    }
+};
+
+template<size_t N, class T = float>
+using Vector = Matrix<N, 1, T>;
+
+/**
+ * @brief out = a * b
+ *
+ * @note out must not alias a or b
+ */
+template<size_t R, size_t K, size_t C, class T>
+void multiply(const Matrix<R, K, T> &a, const Matrix<K, C, T> &b, Matrix<R, C, T> &out) {
+    // i-k-j order streams rows of b and out, which vectorizes
+    for (size_t r = 0; r < R; r++) {
+        T *__restrict o = out.m[r];
+        for (size_t c = 0; c < C; c++) {
+            o[c] = 0;
+        }
+        for (size_t k = 0; k < K; k++) {
+            const T s = a.m[r][k];
+            const T *__restrict row = b.m[k];
+            for (size_t c = 0; c < C; c++) {
+                o[c] += s * row[c];
+            }
+        }
+    }
+}
+
+#if MATRIX_ESP_DSP
+template<size_t R, size_t K, size_t C>
+void multiply(const Matrix<R, K, float> &a, const Matrix<K, C, float> &b, Matrix<R, C, float> &out) {
+    dspm_mult_f32(&a.m[0][0], &b.m[0][0], &out.m[0][0], R, K, C);
+}
+#endif
+
+/**
+ * @brief out = a * transpose(b), without forming the transpose
+ *
+ * @note out must not alias a or b
+ */
+template<size_t R, size_t K, size_t C, class T>
+void multiplyTransposed(const Matrix<R, K, T> &a, const Matrix<C, K, T> &b, Matrix<R, C, T> &out) {
+    for (size_t r = 0; r < R; r++) {
+        for (size_t c = 0; c < C; c++) {
+            T sum = 0;
+            for (size_t k = 0; k < K; k++) {
+                sum += a.m[r][k] * b.m[c][k];
+            }
+            out.m[r][c] = sum;
+        }
+    }
+}
+
+template<size_t R, size_t K, size_t C, class T>
+Matrix<R, C, T> operator*(const Matrix<R, K, T> &a, const Matrix<K, C, T> &b) {
+    Matrix<R, C, T> out;
+    multiply(a, b, out);
+    return out;
+}
+
+template<size_t R, size_t C, class T>
+Matrix<R, C, T> operator*(Matrix<R, C, T> a, T s) {
+    return a *= s;
+}
+
+template<size_t R, size_t C, class T>
+Matrix<R, C, T> operator+(Matrix<R, C, T> a, const Matrix<R, C, T> &b) {
+    return a += b;
+}
+
+template<size_t R, size_t C, class T>
+Matrix<R, C, T> operator-(Matrix<R, C, T> a, const Matrix<R, C, T> &b) {
+    return a -= b;
+}
+
+/**
+ * @brief Cholesky decomposition a = l * transpose(l)
+ *
+ * @param a symmetric; only the lower triangle is read
+ * @param l lower triangular result, may alias a
+ * @return false if a is not positive definite
+ */
+template<size_t N, class T>
+bool cholesky(const Matrix<N, N, T> &a, Matrix<N, N, T> &l) {
+    for (size_t j = 0; j < N; j++) {
+        T d = a.m[j][j];
+        for (size_t k = 0; k < j; k++) {
+            d -= l.m[j][k] * l.m[j][k];
+        }
+        if (!(d > 0)) {
+            return false;
+        }
+        const T ljj = sqrt(d);
+        const T inv = 1 / ljj;
+        l.m[j][j] = ljj;
+        for (size_t i = j + 1; i < N; i++) {
+            T s = a.m[i][j];
+            for (size_t k = 0; k < j; k++) {
+                s -= l.m[i][k] * l.m[j][k];
+            }
+            l.m[i][j] = s * inv;
+        }
+        for (size_t c = j + 1; c < N; c++) {
+            l.m[j][c] = 0;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief solve a * x = b given l from cholesky(a)
+ *
+ * @param l
+ * @param b
+ * @param x may alias b
+ */
+template<size_t N, size_t C, class T>
+void choleskySolve(const Matrix<N, N, T> &l, const Matrix<N, C, T> &b, Matrix<N, C, T> &x) {
+    // forward substitution l * y = b
+    for (size_t i = 0; i < N; i++) {
+        const T inv = 1 / l.m[i][i];
+        for (size_t c = 0; c < C; c++) {
+            T s = b.m[i][c];
+            for (size_t k = 0; k < i; k++) {
+                s -= l.m[i][k] * x.m[k][c];
+            }
+            x.m[i][c] = s * inv;
+        }
+    }
+    // back substitution transpose(l) * x = y
+    for (size_t i = N; i-- > 0;) {
+        const T inv = 1 / l.m[i][i];
+        for (size_t c = 0; c < C; c++) {
+            T s = x.m[i][c];
+            for (size_t k = i + 1; k < N; k++) {
+                s -= l.m[k][i] * x.m[k][c];
+            }
+            x.m[i][c] = s * inv;
+        }
+    }
+}
+
+/**
+ * @brief inverse of a general square matrix, by Gauss-Jordan elimination with partial pivoting
+ *
+ * For a symmetric positive definite a, e.g. an innovation covariance, cholesky() and
+ * choleskySolve() are cheaper and more accurate; prefer solving over inverting.
+ *
+ * @param a
+ * @param inv result, must not alias a
+ * @param scratch work space, so nothing large lands on the task stack
+ * @return false if a is singular to working precision, inv is then undefined
+ */
+template<size_t N, class T>
+bool invert(const Matrix<N, N, T> &a, Matrix<N, N, T> &inv, Matrix<N, N, T> &scratch) {
+    auto &w = scratch;
+    w = a;
+    inv = Matrix<N, N, T>::identity();
+    T scale = 0;
+    for (size_t r = 0; r < N; r++) {
+        for (size_t c = 0; c < N; c++) {
+            scale = fabs(w.m[r][c]) > scale ? fabs(w.m[r][c]) : scale;
+        }
+    }
+    const T tiny = scale * N * std::numeric_limits<T>::epsilon();
+    for (size_t j = 0; j < N; j++) {
+        size_t pivot = j;
+        for (size_t r = j + 1; r < N; r++) {
+            if (fabs(w.m[r][j]) > fabs(w.m[pivot][j])) {
+                pivot = r;
+            }
+        }
+        if (!(fabs(w.m[pivot][j]) > tiny)) {
+            return false;
+        }
+        if (pivot != j) {
+            for (size_t c = 0; c < N; c++) {
+                const T t = w.m[j][c];
+                w.m[j][c] = w.m[pivot][c];
+                w.m[pivot][c] = t;
+                const T u = inv.m[j][c];
+                inv.m[j][c] = inv.m[pivot][c];
+                inv.m[pivot][c] = u;
+            }
+        }
+        const T d = 1 / w.m[j][j];
+        for (size_t c = 0; c < N; c++) {
+            w.m[j][c] *= d;
+            inv.m[j][c] *= d;
+        }
+        for (size_t r = 0; r < N; r++) {
+            const T f = w.m[r][j];
+            if (r == j || f == 0) {
+                continue;
+            }
+            for (size_t c = 0; c < N; c++) {
+                w.m[r][c] -= f * w.m[j][c];
+                inv.m[r][c] -= f * inv.m[j][c];
+            }
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Kalman covariance propagation p = f * p * transpose(f) + q, kept exactly symmetric
+ *
+ * @param p covariance, updated in place
+ * @param f state transition
+ * @param q process noise
+ * @param scratch work space, so nothing large lands on the task stack
+ */
+template<size_t N, class T>
+void propagateCovariance(Matrix<N, N, T> &p, const Matrix<N, N, T> &f, const Matrix<N, N, T> &q, Matrix<N, N, T> &scratch) {
+    multiply(f, p, scratch);
+    // only the upper triangle of f * p * transpose(f), then mirror it
+    for (size_t r = 0; r < N; r++) {
+        for (size_t c = r; c < N; c++) {
+            T sum = 0;
+            for (size_t k = 0; k < N; k++) {
+                sum += scratch.m[r][k] * f.m[c][k];
+            }
+            p.m[r][c] = sum + q.m[r][c];
+        }
+    }
+    for (size_t r = 1; r < N; r++) {
+        for (size_t c = 0; c < r; c++) {
+            p.m[r][c] = p.m[c][r];
+        }
+    }
+}
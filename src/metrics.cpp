@@ -0,0 +1,123 @@
+#include "metrics.h"
+
+Metric::Metric(const char *name, Type type) : name(name), type(type), next(nullptr) {
+    Metrics.addMetric(this);
+}
+
+Metric::~Metric() {}
+
+const char *Metric::getName() const {
+    return name;
+}
+
+Metric::Type Metric::getType() const {
+    return type;
+}
+
+Counter::Counter(const char *name) : Metric(name, COUNTER) {
+    for (auto &c : counts) {
+        c.store(0, std::memory_order_relaxed);
+    }
+}
+
+uint32_t Counter::value() const {
+    uint32_t total = 0;
+    for (auto &c : counts) {
+        total += c.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+void Counter::print(Print &out) const {
+    out.printf("%s counter %u\n", getName(), (unsigned)value());
+}
+
+Gauge::Gauge(const char *name) : Metric(name, GAUGE), current(0) {}
+
+void Gauge::print(Print &out) const {
+    out.printf("%s gauge %d\n", getName(), (int)value());
+}
+
+Histogram::Histogram(const char *name) : Metric(name, HISTOGRAM) {
+    for (auto &s : sums) {
+        s.store(0, std::memory_order_relaxed);
+    }
+}
+
+uint32_t Histogram::bucketCount(size_t bucket) const {
+    uint32_t total = 0;
+    for (auto &b : buckets) {
+        total += b.bucketCount(bucket);
+    }
+    return total;
+}
+
+uint32_t Histogram::count() const {
+    uint32_t total = 0;
+    for (auto &b : buckets) {
+        total += b.count();
+    }
+    return total;
+}
+
+uint32_t Histogram::percentile(uint32_t perMille) const {
+    Buckets merged;
+    for (auto &b : buckets) {
+        merged.merge(b);
+    }
+    return merged.percentile(perMille);
+}
+
+uint32_t Histogram::sum() const {
+    uint32_t total = 0;
+    for (auto &s : sums) {
+        total += s.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+void Histogram::print(Print &out) const {
+    out.printf("%s histogram count %u sum %u", getName(), (unsigned)count(), (unsigned)sum());
+    for (size_t i = 0; i < NUM_BUCKETS; i++) {
+        const auto n = bucketCount(i);
+        if (n) {
+            // upper bound of the bucket, inclusive
+            out.printf(" <=%u:%u", (unsigned)Buckets::upperBoundOf(i), (unsigned)n);
+        }
+    }
+    out.println();
+}
+
+void MetricsClass::addMetric(Metric *metric) {
+    if (metric == nullptr) {
+        return;
+    }
+    // lock-free prepend, metrics may be constructed concurrently after startup
+    auto head = metrics.load(std::memory_order_relaxed);
+    do {
+        metric->next = head;
+    } while (!metrics.compare_exchange_weak(head, metric, std::memory_order_release, std::memory_order_relaxed));
+}
+
+void MetricsClass::forEach(MetricFn fn, void *args) const {
+    for (auto m = metrics.load(std::memory_order_acquire); m != nullptr; m = m->next) {
+        fn(*m, args);
+    }
+}
+
+Metric *MetricsClass::find(const char *name) const {
+    for (auto m = metrics.load(std::memory_order_acquire); m != nullptr; m = m->next) {
+        if (strcmp(m->name, name) == 0) {
+            return m;
+        }
+    }
+    return nullptr;
+}
+
+void MetricsClass::dump(Print &out) const {
+    forEach([](const Metric &m, void *args) {
+        m.print(*static_cast<Print*>(args));
+    }, &out);
+}
+
+MetricsClass Metrics;
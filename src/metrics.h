@@ -0,0 +1,244 @@
+#pragma once
+
+#include <Arduino.h>
+#include <atomic>
+#include "histogram.h"
+
+/**
+ * @brief Metric is the base class of Counter, Gauge and Histogram. It is not to be directly used.
+ *
+ * Metrics register themselves with Metrics on construction and are never removed, so they
+ * must live as long as the program: declare them as static or global objects, or as members
+ * of a static subsystem instance. Allocating them with new is not allowed.
+ *
+ * static Counter packetsDropped("radio.dropped");
+ * ...
+ * packetsDropped.add();
+ */
+class Metric {
+public:
+    enum Type {
+        COUNTER,    ///< monotonically increasing count
+        GAUGE,      ///< value that is set
+        HISTOGRAM   ///< distribution of recorded values
+    };
+
+    /**
+     * @brief Get the name of the metric
+     *
+     * @return const char*
+     */
+    const char *getName() const;
+
+    /**
+     * @brief Get the Type of the metric
+     *
+     * @return Type
+     */
+    Type getType() const;
+
+    /**
+     * @brief print the aggregated value(s) as one line of text
+     *
+     * @param out
+     */
+    virtual void print(Print &out) const = 0;
+
+    // to walk the list of metrics
+    friend class MetricsClass;
+
+protected:
+    Metric(const char *name, Type type);
+    virtual ~Metric();
+
+private:
+    Metric() = delete;
+    Metric(const Metric &other) = delete;
+    static void *operator new(size_t size) = delete;
+    static void *operator new[](size_t size) = delete;
+
+    const char *name;
+    const Type type;
+    Metric *next;
+};
+
+/**
+ * @brief a counter that can be incremented concurrently from any task or ISR
+ *
+ * Each core adds to its own slot and slots are summed on read.
+ */
+class Counter : public Metric {
+public:
+    Counter(const char *name);
+
+    /**
+     * @brief add to the counter
+     *
+     * @param n
+     */
+    void add(uint32_t n = 1) {
+        counts[xPortGetCoreID()].fetch_add(n, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief the sum over all cores
+     *
+     * @return uint32_t
+     */
+    uint32_t value() const;
+
+    void print(Print &out) const;
+
+private:
+    std::atomic<uint32_t> counts[portNUM_PROCESSORS];
+};
+
+/**
+ * @brief a value that is set rather than accumulated, e.g. a queue depth
+ *
+ */
+class Gauge : public Metric {
+public:
+    Gauge(const char *name);
+
+    /**
+     * @brief Set the value
+     *
+     * @param v
+     */
+    void set(int32_t v) {
+        current.store(v, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief add (or subtract) from the value
+     *
+     * @param delta
+     */
+    void add(int32_t delta) {
+        current.fetch_add(delta, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief the current value
+     *
+     * @return int32_t
+     */
+    int32_t value() const {
+        return current.load(std::memory_order_relaxed);
+    }
+
+    void print(Print &out) const;
+
+private:
+    std::atomic<int32_t> current;
+};
+
+/**
+ * @brief a histogram of the full uint32_t range, with two buckets per power of 2
+ *
+ * Each core records into its own LatencyHistogram, merged on read. See LatencyHistogram for
+ * the bucket bounds.
+ */
+class Histogram : public Metric {
+public:
+    typedef LatencyHistogram<1, 32> Buckets;
+
+    static constexpr size_t NUM_BUCKETS = Buckets::NUM_BUCKETS;
+
+    Histogram(const char *name);
+
+    /**
+     * @brief record a value
+     *
+     * @param v
+     */
+    void record(uint32_t v) {
+        const auto core = xPortGetCoreID();
+        buckets[core].record(v);
+        sums[core].fetch_add(v, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief the number of values recorded in a bucket, over all cores
+     *
+     * @param bucket
+     * @return uint32_t
+     */
+    uint32_t bucketCount(size_t bucket) const;
+
+    /**
+     * @brief the value below which the given share of recorded values fall, over all cores
+     *
+     * @param perMille see LatencyHistogram::percentile()
+     * @return uint32_t
+     */
+    uint32_t percentile(uint32_t perMille) const;
+
+    /**
+     * @brief the number of values recorded
+     *
+     * @return uint32_t
+     */
+    uint32_t count() const;
+
+    /**
+     * @brief the sum of values recorded. Wraps at 2^32
+     *
+     * @return uint32_t
+     */
+    uint32_t sum() const;
+
+    void print(Print &out) const;
+
+private:
+    Buckets buckets[portNUM_PROCESSORS];
+    std::atomic<uint32_t> sums[portNUM_PROCESSORS];
+};
+
+/**
+ * @brief MetricsClass keeps track of all metrics, for telemetry and debugging
+ *
+ */
+class MetricsClass {
+public:
+    typedef void(MetricFn)(const Metric &, void *args);
+
+    constexpr MetricsClass() : metrics(nullptr) {}
+
+    /**
+     * @brief add a metric. Called by the Metric constructor
+     *
+     * @param metric
+     */
+    void addMetric(Metric *metric);
+
+    /**
+     * @brief call fn for every registered metric, e.g. to pack them into telemetry
+     *
+     * @param fn
+     * @param args additional arguments to call fn with
+     */
+    void forEach(MetricFn fn, void *args) const;
+
+    /**
+     * @brief find a metric by name
+     *
+     * @param name
+     * @return Metric* or nullptr if not found
+     */
+    Metric *find(const char *name) const;
+
+    /**
+     * @brief print all metrics, one per line
+     *
+     * @param out
+     */
+    void dump(Print &out) const;
+
+private:
+    // constant initialized, so metrics can be added during static construction
+    std::atomic<Metric*> metrics;
+};
+
+extern MetricsClass Metrics;
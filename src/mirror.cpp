@@ -0,0 +1,254 @@
+#include "mirror.h"
+
+namespace {
+
+void put16(uint8_t *p, uint16_t v) {
+    p[0] = v;
+    p[1] = v >> 8;
+}
+
+void put32(uint8_t *p, uint32_t v) {
+    put16(p, v);
+    put16(p + 2, v >> 16);
+}
+
+uint16_t get16(const uint8_t *p) {
+    return p[0] | (p[1] << 8);
+}
+
+uint32_t get32(const uint8_t *p) {
+    return get16(p) | (static_cast<uint32_t>(get16(p + 2)) << 16);
+}
+
+uint8_t chunkOf(size_t size) {
+    return (size + 31) / 32;
+}
+
+size_t chunkLength(size_t size, uint8_t chunk, int i) {
+    const auto offset = i * chunk;
+    return size - offset < chunk ? size - offset : chunk;
+}
+
+}
+
+MirrorSender::MirrorSender(const char *name, Print &out, TickType_t period, uint32_t keyframeInterval, int priority) :
+    out(out), period(period), keyframeInterval(keyframeInterval), priority(priority), numEntries(0), poolUsed(0),
+    sequence(0), frameCount(0), byteCount(0), spec(this, nullptr) {
+    this->name = name;
+    SubsystemManager.addSubsystem(&spec);
+}
+
+MirrorSender::~MirrorSender() {}
+
+BaseSubsystem::Status MirrorSender::setup() {
+    setStatus(READY);
+    return getStatus();
+}
+
+MirrorSender::Entry *MirrorSender::add(uint8_t id, size_t size) {
+    if (numEntries == MAX_THINGS || size == 0 || size > MAX_PAYLOAD - HEADER_SIZE - RECORD_HEADER_SIZE ||
+        poolUsed + 2 * size > MIRROR_POOL_SIZE) {
+        return nullptr;
+    }
+    auto &entry = entries[numEntries];
+    entry.sender = this;
+    entry.id = id;
+    entry.size = size;
+    entry.chunk = chunkOf(size);
+    entry.staged = pool + poolUsed;
+    entry.sent = pool + poolUsed + size;
+    entry.dirty = false;
+    entry.changedMicros = 0;
+    memset(entry.staged, 0, 2 * size);
+    poolUsed += 2 * size;
+    rwLock.Lock();
+    numEntries++;
+    rwLock.UnLock();
+    return &entry;
+}
+
+void MirrorSender::stage(Entry &entry, const void *value) {
+    rwLock.Lock();
+    memcpy(entry.staged, value, entry.size);
+    if (!entry.dirty) {
+        entry.dirty = true;
+        entry.changedMicros = micros();
+    }
+    rwLock.UnLock();
+}
+
+void MirrorSender::send(bool keyframe) {
+    size_t len = HEADER_SIZE;
+    for (auto i = 0; i < numEntries; i++) {
+        auto &entry = entries[i];
+        rwLock.Lock();
+        if (!entry.dirty && !keyframe) {
+            rwLock.UnLock();
+            continue;
+        }
+        memcpy(value, entry.staged, entry.size);
+        const auto changed = entry.dirty ? entry.changedMicros : micros();
+        entry.dirty = false;
+        rwLock.UnLock();
+
+        uint32_t mask = 0;
+        size_t bytes = 0;
+        for (auto c = 0; c * entry.chunk < entry.size; c++) {
+            const auto n = chunkLength(entry.size, entry.chunk, c);
+            if (keyframe || memcmp(value + c * entry.chunk, entry.sent + c * entry.chunk, n) != 0) {
+                mask |= 1UL << c;
+                bytes += n;
+            }
+        }
+        if (mask == 0) {
+            continue;
+        }
+        if (len + RECORD_HEADER_SIZE + bytes > MAX_PAYLOAD) {
+            flush(len);
+            len = HEADER_SIZE;
+        }
+        const auto age = micros() - changed;
+        auto p = payload + len;
+        p[0] = entry.id;
+        put16(p + 1, entry.size);
+        put16(p + 3, age > 0xffff ? 0xffff : age);
+        put32(p + 5, mask);
+        p += RECORD_HEADER_SIZE;
+        for (auto c = 0; c * entry.chunk < entry.size; c++) {
+            if (mask & (1UL << c)) {
+                const auto n = chunkLength(entry.size, entry.chunk, c);
+                memcpy(p, value + c * entry.chunk, n);
+                memcpy(entry.sent + c * entry.chunk, value + c * entry.chunk, n);
+                p += n;
+            }
+        }
+        len = p - payload;
+    }
+    if (len > HEADER_SIZE) {
+        flush(len);
+    }
+}
+
+void MirrorSender::flush(size_t len) {
+    payload[0] = MAGIC;
+    put16(payload + 1, sequence++);
+    put32(payload + 3, micros());
+    CobsEncoder encoder(frame, sizeof(frame));
+    encoder.write(payload, len);
+    const auto n = encoder.end();
+    if (n) {
+        out.write(frame, n);
+        frameCount.fetch_add(1, std::memory_order_relaxed);
+        byteCount.fetch_add(n, std::memory_order_relaxed);
+    }
+}
+
+uint32_t MirrorSender::framesSent() const {
+    return frameCount.load(std::memory_order_relaxed);
+}
+
+uint32_t MirrorSender::bytesSent() const {
+    return byteCount.load(std::memory_order_relaxed);
+}
+
+int MirrorSender::taskPriority() const {
+    return priority;
+}
+
+void MirrorSender::taskFunction(void */*parameter*/) {
+    uint32_t cycles = 0;
+    for (;;) {
+        waitForNextCycle(period);
+        const auto keyframe = ++cycles >= keyframeInterval;
+        if (keyframe) {
+            cycles = 0;
+        }
+        send(keyframe);
+    }
+}
+
+MirrorReceiver::MirrorReceiver() : CobsFrameParser(onFrame, this), numEntries(0), expected(0), minTransit(0),
+    frameCount(0), lostCount(0) {}
+
+bool MirrorReceiver::add(uint8_t id, size_t size, void *thing, ApplyFn *apply) {
+    if (numEntries == MAX_THINGS) {
+        return false;
+    }
+    auto &entry = entries[numEntries++];
+    entry.id = id;
+    entry.size = size;
+    entry.thing = thing;
+    entry.apply = apply;
+    return true;
+}
+
+void MirrorReceiver::onFrame(const uint8_t *payload, size_t len, void *args) {
+    static_cast<MirrorReceiver*>(args)->receive(payload, len);
+}
+
+void MirrorReceiver::applyPatch(void *data, const Patch &patch) {
+    auto dst = static_cast<uint8_t*>(data);
+    auto src = patch.data;
+    for (auto c = 0; c * patch.chunk < patch.size; c++) {
+        if (patch.mask & (1UL << c)) {
+            const auto n = chunkLength(patch.size, patch.chunk, c);
+            memcpy(dst + c * patch.chunk, src, n);
+            src += n;
+        }
+    }
+}
+
+void MirrorReceiver::receive(const uint8_t *payload, size_t len) {
+    if (len < MirrorSender::HEADER_SIZE || payload[0] != MirrorSender::MAGIC) {
+        return;
+    }
+    const auto now = micros();
+    const auto sequence = get16(payload + 1);
+    // only the offset between the clocks is unknown, the fastest frame has the least transit
+    const auto transit = static_cast<int32_t>(now - get32(payload + 3));
+    const auto received = frameCount.fetch_add(1, std::memory_order_relaxed);
+    if (received == 0 || transit < minTransit) {
+        minTransit = transit;
+    }
+    if (received != 0 && sequence != expected) {
+        lostCount.fetch_add(static_cast<uint16_t>(sequence - expected), std::memory_order_relaxed);
+    }
+    expected = sequence + 1;
+
+    auto p = payload + MirrorSender::HEADER_SIZE;
+    const auto end = payload + len;
+    while (end - p >= MirrorSender::RECORD_HEADER_SIZE) {
+        Patch patch;
+        const auto id = p[0];
+        patch.size = get16(p + 1);
+        const auto age = get16(p + 3);
+        patch.mask = get32(p + 5);
+        patch.chunk = chunkOf(patch.size);
+        patch.data = p + MirrorSender::RECORD_HEADER_SIZE;
+        size_t bytes = 0;
+        for (auto c = 0; c * patch.chunk < patch.size; c++) {
+            if (patch.mask & (1UL << c)) {
+                bytes += chunkLength(patch.size, patch.chunk, c);
+            }
+        }
+        if (patch.size == 0 || static_cast<size_t>(end - patch.data) < bytes) {
+            return;
+        }
+        for (auto i = 0; i < numEntries; i++) {
+            if (entries[i].id == id && entries[i].size == patch.size) {
+                entries[i].apply(entries[i].thing, patch);
+                stalenessMicros.record(age + (transit - minTransit));
+                break;
+            }
+        }
+        p = patch.data + bytes;
+    }
+}
+
+uint32_t MirrorReceiver::framesReceived() const {
+    return frameCount.load(std::memory_order_relaxed);
+}
+
+uint32_t MirrorReceiver::framesLost() const {
+    return lostCount.load(std::memory_order_relaxed);
+}
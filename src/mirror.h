@@ -0,0 +1,218 @@
+#pragma once
+
+#include <Arduino.h>
+#include <atomic>
+#include "subsystem.h"
+#include "framing.h"
+#include "histogram.h"
+
+#ifndef MIRROR_POOL_SIZE
+#define MIRROR_POOL_SIZE 2048 ///< bytes for the two copies the sender keeps of each mirrored thing
+#endif
+
+/*
+ * Mirroring keeps a replica of DataThings on another MCU over a serial link.
+ *
+ * A frame is a COBS frame (see framing.h) whose payload is, little endian:
+ *    uint8_t  MAGIC
+ *    uint16_t sequence         incremented per frame, to count lost frames
+ *    uint32_t sent             sender micros()
+ * followed by a record per changed thing:
+ *    uint8_t  id
+ *    uint16_t size             of the thing
+ *    uint16_t age              micros from the first unsent change to sent, saturated
+ *    uint32_t mask             bit i set if chunk i follows
+ *    uint8_t  chunks[]         the thing is split in at most 32 chunks of (size + 31) / 32 bytes
+ *
+ * Only changed chunks are sent, several things per frame, and every few frames all chunks
+ * of all things are sent so a receiver recovers from lost frames.
+ */
+
+/**
+ * @brief MirrorSender sends changes of DataThings to a MirrorReceiver on the other end of a link
+ *
+ * static MirrorSender mirrorTx("mirrorTx", Serial1, pdMS_TO_TICKS(10));
+ * mirrorTx.mirror(1, gps);
+ *
+ */
+class MirrorSender : public ThreadedSubsystem {
+public:
+    static const uint8_t MAGIC = 0x4d;
+    static const auto HEADER_SIZE = 7;
+    static const auto RECORD_HEADER_SIZE = 9;
+    // so any payload COBS encodes into FRAMING_MAX_FRAME
+    static const auto MAX_PAYLOAD = FRAMING_MAX_FRAME - FRAMING_MAX_FRAME / 254 - 6;
+
+    /**
+     * @brief Construct a new Mirror Sender and add it to SubsystemManager
+     *
+     * @param name subsystem name
+     * @param out the link, e.g. Serial1
+     * @param period ticks between frames
+     * @param keyframeInterval send everything every this many periods
+     * @param priority task priority
+     */
+    MirrorSender(const char *name, Print &out, TickType_t period, uint32_t keyframeInterval = 50,
+        int priority = tskIDLE_PRIORITY + 1);
+    virtual ~MirrorSender();
+
+    Status setup();
+
+    /**
+     * @brief mirror a DataThing, before start()
+     *
+     * @param id the receiver's id of the replica
+     * @param thing
+     * @return false if the thing is too large, MIRROR_POOL_SIZE is used up or too many are mirrored
+     */
+    template<class T, class Placement>
+    bool mirror(uint8_t id, DataThing<T, Placement> &thing) {
+        const auto entry = add(id, sizeof(T));
+        if (entry == nullptr) {
+            return false;
+        }
+        thing.registerCallback([](const T &value, void *args) {
+            const auto entry = static_cast<Entry*>(args);
+            entry->sender->stage(*entry, &value);
+        }, entry);
+        return true;
+    }
+
+    /**
+     * @brief number of frames sent
+     *
+     * @return uint32_t
+     */
+    uint32_t framesSent() const;
+
+    /**
+     * @brief number of bytes sent, framing included
+     *
+     * @return uint32_t
+     */
+    uint32_t bytesSent() const;
+
+protected:
+    int taskPriority() const;
+    void taskFunction(void *parameter);
+
+private:
+    static const auto MAX_THINGS = 16;
+
+    struct Entry {
+        MirrorSender *sender;
+        uint8_t id;
+        uint16_t size;
+        uint8_t chunk;          ///< bytes per chunk
+        uint8_t *staged;        ///< latest value, written by callbacks
+        uint8_t *sent;          ///< as last sent, only used by the task
+        bool dirty;
+        uint32_t changedMicros; ///< of the first change since the last send
+    };
+
+    Entry *add(uint8_t id, size_t size);
+    void stage(Entry &entry, const void *value);
+    void send(bool keyframe);
+    void flush(size_t len);
+
+    Print &out;
+    const TickType_t period;
+    const uint32_t keyframeInterval;
+    const int priority;
+    Entry entries[MAX_THINGS];
+    uint8_t numEntries;
+    uint8_t pool[MIRROR_POOL_SIZE];
+    size_t poolUsed;
+    uint16_t sequence;
+    std::atomic<uint32_t> frameCount;
+    std::atomic<uint32_t> byteCount;
+    uint8_t value[MAX_PAYLOAD];
+    uint8_t payload[MAX_PAYLOAD];
+    uint8_t frame[FRAMING_MAX_FRAME];
+
+    SubsystemManagerClass::Spec spec;
+};
+
+/**
+ * @brief MirrorReceiver applies frames of a MirrorSender to replica DataThings
+ *
+ * Feed it the link, e.g. as one of the parsers of a UartIngest. Replicas are published with
+ * accessData() from the parsing task.
+ */
+class MirrorReceiver : public CobsFrameParser {
+public:
+    MirrorReceiver();
+
+    /**
+     * @brief keep a replica
+     *
+     * @param id the sender's id of the thing
+     * @param replica
+     * @return false if too many replicas are kept
+     */
+    template<class T, class Placement>
+    bool mirror(uint8_t id, DataThing<T, Placement> &replica) {
+        return add(id, sizeof(T), &replica, [](void *thing, const Patch &patch) {
+            static_cast<DataThing<T, Placement>*>(thing)->accessData([](T &data, void *args) {
+                applyPatch(&data, *static_cast<const Patch*>(args));
+            }, const_cast<Patch*>(&patch));
+        });
+    }
+
+    /**
+     * @brief number of frames applied
+     *
+     * @return uint32_t
+     */
+    uint32_t framesReceived() const;
+
+    /**
+     * @brief number of frames missing from the sequence
+     *
+     * @return uint32_t
+     */
+    uint32_t framesLost() const;
+
+    /**
+     * @brief age of the changes applied, in microseconds
+     *
+     * The age at the sender plus the transit time beyond the fastest frame seen, as the two
+     * clocks aren't synchronized; true staleness is higher by the wire time of a short frame.
+     *
+     * @return const LatencyHistogram<>&
+     */
+    const LatencyHistogram<> &staleness() const { return stalenessMicros; }
+
+private:
+    static const auto MAX_THINGS = 16;
+
+    struct Patch {
+        const uint8_t *data;
+        uint32_t mask;
+        uint16_t size;
+        uint8_t chunk;
+    };
+
+    typedef void(ApplyFn)(void *thing, const Patch &patch);
+
+    struct Entry {
+        uint8_t id;
+        uint16_t size;
+        void *thing;
+        ApplyFn *apply;
+    };
+
+    static void onFrame(const uint8_t *payload, size_t len, void *args);
+    static void applyPatch(void *data, const Patch &patch);
+
+    bool add(uint8_t id, size_t size, void *thing, ApplyFn *apply);
+    void receive(const uint8_t *payload, size_t len);
+
+    Entry entries[MAX_THINGS];
+    uint8_t numEntries;
+    uint16_t expected;
+    int32_t minTransit;
+    std::atomic<uint32_t> frameCount;
+    std::atomic<uint32_t> lostCount;
+    LatencyHistogram<> stalenessMicros;
+};
@@ -0,0 +1,230 @@
+#pragma once
+
+#include <Arduino.h>
+#include <Preferences.h>
+#include <atomic>
+#include <type_traits>
+#include "crc.h"
+
+/**
+ * @brief header of a persisted parameter block
+ *
+ * A persisted block is this header followed directly by the raw parameter struct, all little
+ * endian, so tools can map a dumped image and use it in place.
+ */
+struct ParameterImageHeader {
+    static const uint32_t MAGIC = 0x314d5250; ///< "PRM1"
+
+    uint32_t magic;
+    uint16_t headerSize;    ///< sizeof(ParameterImageHeader)
+    uint16_t valuesSize;    ///< sizeof the parameter struct
+    uint32_t version;       ///< ParameterStore version when saved
+    uint32_t crc;           ///< crc32() of the parameter struct
+};
+
+/**
+ * @brief ParameterStore holds a block of tunable parameters read far more often than written
+ *
+ * Readers get a pointer to an immutable, versioned copy without taking a lock, so reading on
+ * every tick is cheap. Writers copy the current block, modify the copy and publish it
+ * atomically; readers still holding the old block keep seeing consistent values.
+ *
+ * static ParameterStore<Gains> gains(defaultGains);
+ * ...
+ * auto g = gains.read();
+ * out = g->kp * error;
+ *
+ * @tparam T a trivially copyable struct of parameters
+ */
+template<class T>
+class ParameterStore {
+public:
+    static_assert(std::is_trivially_copyable<T>::value, "parameters must be trivially copyable");
+
+    /**
+     * @brief a read reference to a parameter block. Keep it short lived: while it exists,
+     * its block can't be reused by writers
+     *
+     */
+    class Reader {
+    public:
+        Reader(Reader &&other) : store(other.store), index(other.index) { other.store = nullptr; }
+        ~Reader() {
+            if (store) {
+                store->readers[index].fetch_sub(1);
+            }
+        }
+
+        const T &operator*() const { return store->blocks[index].values; }
+        const T *operator->() const { return &store->blocks[index].values; }
+
+        /**
+         * @brief version of the block being read
+         *
+         * @return uint32_t
+         */
+        uint32_t version() const { return store->blocks[index].version; }
+
+    private:
+        friend class ParameterStore;
+        Reader(const ParameterStore *store, uint8_t index) : store(store), index(index) {}
+        Reader(const Reader &other) = delete;
+
+        const ParameterStore *store;
+        uint8_t index;
+    };
+
+    /**
+     * @brief Construct a new Parameter Store, version 0
+     *
+     * @param defaults initial values
+     */
+    ParameterStore(const T &defaults) : current(0) {
+        for (auto &r : readers) {
+            r.store(0);
+        }
+        blocks[0].version = 0;
+        blocks[0].values = defaults;
+        writeMutex = xSemaphoreCreateMutexStatic(&writeMutexBuffer);
+    }
+
+    /**
+     * @brief get the current parameters. Lock-free
+     *
+     * @return Reader
+     */
+    Reader read() const {
+        for (;;) {
+            const auto i = current.load();
+            readers[i].fetch_add(1);
+            // a writer may have moved on between loading and pinning; retry if so
+            if (current.load() == i) {
+                return Reader(this, i);
+            }
+            readers[i].fetch_sub(1);
+        }
+    }
+
+    /**
+     * @brief the version of the current parameters, incremented on every update
+     *
+     * @return uint32_t
+     */
+    uint32_t version() const {
+        return read().version();
+    }
+
+    /**
+     * @brief publish a modified copy of the current parameters
+     *
+     * @param fn called with a copy of the current parameters to modify
+     * @param args additional arguments to call fn with
+     */
+    void update(void(fn)(T &values, void *args), void *args) {
+        xSemaphoreTake(writeMutex, portMAX_DELAY);
+        const auto from = current.load();
+        const auto to = freeBlock(from);
+        blocks[to].values = blocks[from].values;
+        fn(blocks[to].values, args);
+        blocks[to].version = blocks[from].version + 1;
+        current.store(to);
+        xSemaphoreGive(writeMutex);
+    }
+
+    /**
+     * @brief publish new parameters
+     *
+     * @param values
+     */
+    void set(const T &values) {
+        update([](T &v, void *args) {
+            v = *static_cast<const T*>(args);
+        }, const_cast<T*>(&values));
+    }
+
+    /**
+     * @brief save the current parameters as one blob, e.g. prefs.begin("params") first
+     *
+     * @param prefs an open Preferences namespace
+     * @param key
+     * @return true on success
+     */
+    bool save(Preferences &prefs, const char *key) const {
+        Image image;
+        {
+            auto r = read();
+            image.values = *r;
+            image.header.version = r.version();
+        }
+        image.header.magic = ParameterImageHeader::MAGIC;
+        image.header.headerSize = sizeof(ParameterImageHeader);
+        image.header.valuesSize = sizeof(T);
+        image.header.crc = crc32(reinterpret_cast<const uint8_t*>(&image.values), sizeof(T));
+        return prefs.putBytes(key, &image, IMAGE_SIZE) == IMAGE_SIZE;
+    }
+
+    /**
+     * @brief load and publish parameters saved with save()
+     *
+     * @param prefs an open Preferences namespace
+     * @param key
+     * @return false if nothing valid was saved for this parameter struct; the parameters are unchanged
+     */
+    bool load(Preferences &prefs, const char *key) {
+        Image image;
+        if (prefs.getBytesLength(key) != IMAGE_SIZE || prefs.getBytes(key, &image, IMAGE_SIZE) != IMAGE_SIZE) {
+            return false;
+        }
+        if (image.header.magic != ParameterImageHeader::MAGIC ||
+            image.header.headerSize != sizeof(ParameterImageHeader) ||
+            image.header.valuesSize != sizeof(T) ||
+            image.header.crc != crc32(reinterpret_cast<const uint8_t*>(&image.values), sizeof(T))) {
+            return false;
+        }
+        xSemaphoreTake(writeMutex, portMAX_DELAY);
+        const auto to = freeBlock(current.load());
+        blocks[to].values = image.values;
+        blocks[to].version = image.header.version;
+        current.store(to);
+        xSemaphoreGive(writeMutex);
+        return true;
+    }
+
+private:
+    // current, the one before it still being read, and one to write
+    static const uint8_t NUM_BLOCKS = 3;
+
+    struct Block {
+        uint32_t version;
+        T values;
+    };
+
+    struct Image {
+        ParameterImageHeader header;
+        T values;
+    };
+    // without any tail padding of Image
+    static const size_t IMAGE_SIZE = sizeof(ParameterImageHeader) + sizeof(T);
+    static_assert(offsetof(Image, values) == sizeof(ParameterImageHeader), "values must follow the header directly");
+
+    ParameterStore(const ParameterStore &other) = delete;
+
+    // find a block no reader holds, called with writeMutex held
+    uint8_t freeBlock(uint32_t inUse) {
+        for (;;) {
+            for (uint8_t i = 0; i < NUM_BLOCKS; i++) {
+                if (i != inUse && readers[i].load() == 0) {
+                    return i;
+                }
+            }
+            // only if readers hold on to old blocks across updates
+            vTaskDelay(1);
+        }
+    }
+
+    Block blocks[NUM_BLOCKS];
+    mutable std::atomic<uint32_t> readers[NUM_BLOCKS];
+    std::atomic<uint32_t> current;
+    StaticSemaphore_t writeMutexBuffer;
+    SemaphoreHandle_t writeMutex;
+};
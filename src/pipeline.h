@@ -0,0 +1,253 @@
+#pragma once
+
+#include <Arduino.h>
+#include "subsystem.h"
+
+/*
+ * Operator pipelines transform the values of one DataThing into another.
+ *
+ * static auto altitude = makePipeline(altitudeThing,
+ *    pipeMap([](const Baro &b) { return baroAltitude(b.pressure); }),
+ *    pipeWindow<float, 8>(),
+ *    pipeMap([](const PipeWindow<float, 8> &w) { return w.mean(); }),
+ *    pipeDecimate<4>());
+ * ...
+ * altitude.attach(baroThing);
+ *
+ * The operators are composed as types, so the whole chain compiles into the one callback
+ * registered on the source: intermediate values live on the stack and only the sink is
+ * locked and notified, once per value reaching it.
+ */
+
+/**
+ * @brief the last N values seen by pipeWindow(), oldest first
+ *
+ * @tparam T
+ * @tparam N
+ */
+template<class T, size_t N>
+class PipeWindow {
+public:
+    PipeWindow() : head(0), count(0) {}
+
+    size_t size() const { return count; }
+    bool full() const { return count == N; }
+
+    /**
+     * @brief a value, 0 being the oldest
+     *
+     */
+    const T &operator[](size_t i) const {
+        const auto oldest = count == N ? head : 0;
+        const auto j = oldest + i;
+        return values[j < N ? j : j - N];
+    }
+
+    /**
+     * @brief average of the values, for arithmetic types
+     *
+     * @return T
+     */
+    T mean() const {
+        T sum = 0;
+        for (size_t i = 0; i < count; i++) {
+            sum += values[i];
+        }
+        return count ? sum / static_cast<T>(count) : sum;
+    }
+
+    void add(const T &value) {
+        values[head] = value;
+        head = head + 1 == N ? 0 : head + 1;
+        if (count < N) {
+            count++;
+        }
+    }
+
+private:
+    T values[N];
+    size_t head;
+    size_t count;
+};
+
+template<class F>
+struct PipeMapOp {
+    F fn;
+    template<class V, class Next>
+    void push(const V &value, Next &next) {
+        next.push(fn(value));
+    }
+};
+
+template<class F>
+struct PipeFilterOp {
+    F fn;
+    template<class V, class Next>
+    void push(const V &value, Next &next) {
+        if (fn(value)) {
+            next.push(value);
+        }
+    }
+};
+
+template<class Acc, class F>
+struct PipeScanOp {
+    Acc acc;
+    F fn;
+    template<class V, class Next>
+    void push(const V &value, Next &next) {
+        acc = fn(acc, value);
+        next.push(acc);
+    }
+};
+
+template<class T, size_t N>
+struct PipeWindowOp {
+    PipeWindow<T, N> window;
+    template<class V, class Next>
+    void push(const V &value, Next &next) {
+        window.add(value);
+        if (window.full()) {
+            next.push(window);
+        }
+    }
+};
+
+template<size_t N>
+struct PipeDecimateOp {
+    size_t count;
+    template<class V, class Next>
+    void push(const V &value, Next &next) {
+        if (++count == N) {
+            count = 0;
+            next.push(value);
+        }
+    }
+};
+
+/**
+ * @brief transform each value with fn(value)
+ *
+ */
+template<class F>
+PipeMapOp<F> pipeMap(F fn) {
+    return PipeMapOp<F>{fn};
+}
+
+/**
+ * @brief pass only values for which fn(value) is true
+ *
+ */
+template<class F>
+PipeFilterOp<F> pipeFilter(F fn) {
+    return PipeFilterOp<F>{fn};
+}
+
+/**
+ * @brief pass the running acc = fn(acc, value), e.g. an integral
+ *
+ */
+template<class Acc, class F>
+PipeScanOp<Acc, F> pipeScan(Acc initial, F fn) {
+    return PipeScanOp<Acc, F>{initial, fn};
+}
+
+/**
+ * @brief pass a PipeWindow of the last N values once N have been seen, then on every value
+ *
+ */
+template<class T, size_t N>
+PipeWindowOp<T, N> pipeWindow() {
+    return PipeWindowOp<T, N>();
+}
+
+/**
+ * @brief pass every Nth value
+ *
+ */
+template<size_t N>
+PipeDecimateOp<N> pipeDecimate() {
+    return PipeDecimateOp<N>{0};
+}
+
+/**
+ * @brief a pipeline, see makePipeline()
+ *
+ * @tparam Out the sink's data type
+ * @tparam Placement the sink's placement
+ * @tparam Ops operators, applied in order
+ */
+template<class Out, class Placement, class... Ops>
+class Pipeline;
+
+template<class Out, class Placement>
+class Pipeline<Out, Placement> {
+public:
+    Pipeline(DataThing<Out, Placement> &sink) : sink(sink) {}
+
+    template<class V>
+    void push(const V &value) {
+        const Out out = value;
+        sink.accessData([](Out &data, void *args) {
+            data = *static_cast<const Out*>(args);
+        }, const_cast<Out*>(&out));
+    }
+
+    /**
+     * @brief start feeding the values of a source through the pipeline
+     *
+     * @note call once, after both the source and the pipeline are constructed
+     *
+     * @param source
+     */
+    template<class In, class InPlacement>
+    void attach(DataThing<In, InPlacement> &source) {
+        source.registerCallback([](const In &value, void *args) {
+            static_cast<Pipeline*>(args)->push(value);
+        }, this);
+    }
+
+private:
+    DataThing<Out, Placement> &sink;
+};
+
+template<class Out, class Placement, class Op, class... Rest>
+class Pipeline<Out, Placement, Op, Rest...> {
+public:
+    Pipeline(DataThing<Out, Placement> &sink, Op op, Rest... rest) : op(op), rest(sink, rest...) {}
+
+    template<class V>
+    void push(const V &value) {
+        op.push(value, rest);
+    }
+
+    /**
+     * @brief start feeding the values of a source through the pipeline
+     *
+     * @note call once, after both the source and the pipeline are constructed
+     *
+     * @param source
+     */
+    template<class In, class InPlacement>
+    void attach(DataThing<In, InPlacement> &source) {
+        source.registerCallback([](const In &value, void *args) {
+            static_cast<Pipeline*>(args)->push(value);
+        }, this);
+    }
+
+private:
+    Op op;
+    Pipeline<Out, Placement, Rest...> rest;
+};
+
+/**
+ * @brief compose operators into a pipeline writing into sink
+ *
+ * @param sink
+ * @param ops pipeMap(), pipeFilter(), pipeScan(), pipeWindow(), pipeDecimate()
+ * @return Pipeline keep it where it lives, e.g. static, and attach() it to a source
+ */
+template<class Out, class Placement, class... Ops>
+Pipeline<Out, Placement, Ops...> makePipeline(DataThing<Out, Placement> &sink, Ops... ops) {
+    return Pipeline<Out, Placement, Ops...>(sink, ops...);
+}
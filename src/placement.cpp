@@ -0,0 +1,43 @@
+#include "placement.h"
+#include <atomic>
+
+namespace {
+
+std::atomic<uint32_t> fallbacks(0);
+
+}
+
+void *placementAlloc(size_t size, size_t align, uint32_t caps) {
+    if (align < sizeof(void*)) {
+        align = sizeof(void*);
+    }
+#if defined(ESP_PLATFORM)
+    auto p = heap_caps_aligned_alloc(align, size, caps);
+    if (p == nullptr) {
+        fallbacks.fetch_add(1, std::memory_order_relaxed);
+        p = heap_caps_aligned_alloc(align, size, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    }
+#else
+    (void)caps;
+    void *p = nullptr;
+    if (posix_memalign(&p, align, size) != 0) {
+        p = nullptr;
+    }
+#endif
+    if (p == nullptr) {
+        abort();
+    }
+    return p;
+}
+
+void placementFree(void *p) {
+#if defined(ESP_PLATFORM)
+    heap_caps_free(p);
+#else
+    free(p);
+#endif
+}
+
+uint32_t placementFallbacks() {
+    return fallbacks.load(std::memory_order_relaxed);
+}
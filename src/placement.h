@@ -0,0 +1,113 @@
+#pragma once
+
+#include <Arduino.h>
+#include <new>
+#include <stdlib.h>
+
+#if defined(ESP_PLATFORM)
+#include <esp_heap_caps.h>
+#define PLACEMENT_CAPS_INTERNAL (MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT)
+#define PLACEMENT_CAPS_PSRAM (MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT)
+#else
+// hosts have one kind of RAM
+#define PLACEMENT_CAPS_INTERNAL 0
+#define PLACEMENT_CAPS_PSRAM 0
+#endif
+
+/*
+ * Placements decide where DataThing and HistoryDataThing keep their values:
+ *
+ *    InlinePlacement     in the object, wherever it lives. The default
+ *    InternalPlacement   internal DRAM, for small values read often, e.g. by control loops
+ *    PsramPlacement      external PSRAM, for large values read rarely, e.g. history and frames
+ *
+ * A placement is a class with a member template Storage<T, N> that constructs N values of T
+ * and returns them from get(). Placed storage is allocated by the constructor, so things
+ * constructed before PSRAM is added to the heap, e.g. globals under Arduino, which does so in
+ * initArduino(), fall back to internal RAM: construct them from setup(), or check
+ * placementFallbacks().
+ *
+ * PSRAM is reached through the data cache, a miss stalls for a whole cache line, so access
+ * placed values sequentially and copy what is used more than once instead of re-reading it.
+ * IRAM isn't offered: it only allows 32 bit accesses, which arbitrary values don't respect.
+ */
+
+/**
+ * @brief allocate size bytes with the given heap capabilities, any internal RAM if none is left
+ *
+ * @note aborts if no RAM at all is left, as the thing being constructed couldn't work
+ *
+ * @param size
+ * @param align
+ * @param caps PLACEMENT_CAPS_INTERNAL or PLACEMENT_CAPS_PSRAM
+ * @return void*
+ */
+void *placementAlloc(size_t size, size_t align, uint32_t caps);
+
+/**
+ * @brief free what placementAlloc() returned
+ *
+ * @param p
+ */
+void placementFree(void *p);
+
+/**
+ * @brief number of placementAlloc() calls that fell back to other RAM
+ *
+ * @return uint32_t
+ */
+uint32_t placementFallbacks();
+
+/**
+ * @brief keep values in the object
+ *
+ */
+struct InlinePlacement {
+    template<class T, size_t N>
+    class Storage {
+    public:
+        T *get() { return values; }
+        const T *get() const { return values; }
+
+    private:
+        T values[N];
+    };
+};
+
+/**
+ * @brief keep values in heap memory with the given capabilities
+ *
+ * @tparam CAPS PLACEMENT_CAPS_INTERNAL or PLACEMENT_CAPS_PSRAM
+ */
+template<uint32_t CAPS>
+struct HeapPlacement {
+    template<class T, size_t N>
+    class Storage {
+    public:
+        // value initialized, so zeroed like a global would be
+        Storage() : values(static_cast<T*>(placementAlloc(sizeof(T) * N, alignof(T), CAPS))) {
+            for (size_t i = 0; i < N; i++) {
+                new (values + i) T();
+            }
+        }
+
+        ~Storage() {
+            for (size_t i = 0; i < N; i++) {
+                values[i].~T();
+            }
+            placementFree(values);
+        }
+
+        Storage(const Storage &other) = delete;
+        Storage &operator=(const Storage &other) = delete;
+
+        T *get() { return values; }
+        const T *get() const { return values; }
+
+    private:
+        T *const values;
+    };
+};
+
+typedef HeapPlacement<PLACEMENT_CAPS_INTERNAL> InternalPlacement;
+typedef HeapPlacement<PLACEMENT_CAPS_PSRAM> PsramPlacement;
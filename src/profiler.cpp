@@ -0,0 +1,153 @@
+#include "profiler.h"
+
+#ifdef SUBSYSTEM_PROFILER
+
+#include <esp_freertos_hooks.h>
+#if defined(ESP_PLATFORM) && defined(__XTENSA__)
+#include <xtensa_context.h>
+#elif defined(ESP_PLATFORM) && defined(__riscv)
+#include <riscv/rvruntime-frames.h>
+#endif
+
+ProfilerClass::ProfilerClass() : divider(1), sampling(false) {
+    reset();
+}
+
+bool ProfilerClass::start(uint32_t divider) {
+    if (sampling) {
+        return true;
+    }
+    this->divider = divider == 0 ? 1 : divider;
+    for (auto core = 0; core < portNUM_PROCESSORS; core++) {
+        if (esp_register_freertos_tick_hook_for_cpu(tickHook, core) != ESP_OK) {
+            stop();
+            return false;
+        }
+    }
+    sampling = true;
+    return true;
+}
+
+void ProfilerClass::stop() {
+    sampling = false;
+    for (auto core = 0; core < portNUM_PROCESSORS; core++) {
+        esp_deregister_freertos_tick_hook_for_cpu(tickHook, core);
+    }
+}
+
+void ProfilerClass::reset() {
+    const auto wasSampling = sampling;
+    sampling = false;
+    for (auto &ring : rings) {
+        ring.head = 0;
+        ring.ticks = 0;
+    }
+    sampling = wasSampling;
+}
+
+void IRAM_ATTR ProfilerClass::tickHook() {
+    Profiler.sample(xPortGetCoreID());
+}
+
+uintptr_t IRAM_ATTR ProfilerClass::interruptedPc(TaskHandle_t task) {
+#if defined(ESP_PLATFORM) && defined(__XTENSA__)
+    // on interrupt entry the port saves the task's registers on its stack and points
+    // pxTopOfStack, the first member of the TCB, at them
+    return (*reinterpret_cast<XtExcFrame *const *>(task))->pc;
+#elif defined(ESP_PLATFORM) && defined(__riscv)
+    return (*reinterpret_cast<RvExcFrame *const *>(task))->mepc;
+#else
+    (void)task;
+    return hostInterruptedPc();
+#endif
+}
+
+void IRAM_ATTR ProfilerClass::sample(int core) {
+    if (!sampling) {
+        return;
+    }
+    auto &ring = rings[core];
+    if (++ring.ticks < divider) {
+        return;
+    }
+    ring.ticks = 0;
+
+    auto &s = ring.samples[ring.head % RING_SIZE];
+    s.task = xTaskGetCurrentTaskHandle();
+    s.pc = interruptedPc(s.task);
+    s.subsystem = BaseSubsystem::NO_ID;
+    s.depth = 0;
+    for (auto t = ThreadedSubsystem::threadedSubsystems; t != nullptr; t = t->nextThreaded) {
+        if (t->taskHandle == s.task) {
+            s.subsystem = t->id;
+            // the task is interrupted, so its zones can't change under us
+            const uint8_t depth = t->profileDepth;
+            s.depth = depth < MAX_DEPTH ? depth : MAX_DEPTH;
+            for (auto i = 0; i < s.depth; i++) {
+                s.zones[i] = t->profileZones[i];
+            }
+            break;
+        }
+    }
+    ring.head++;
+}
+
+bool ProfilerClass::sameStack(const Sample &a, const Sample &b) {
+    if (a.task != b.task || a.pc != b.pc || a.depth != b.depth) {
+        return false;
+    }
+    for (auto i = 0; i < a.depth; i++) {
+        if (a.zones[i] != b.zones[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+const char *ProfilerClass::taskName(const Sample &s) {
+    if (s.subsystem != BaseSubsystem::NO_ID) {
+        return SubsystemManager.nameOf(s.subsystem);
+    }
+    // idle, loop, timer and other non subsystem tasks, or subsystems beyond MAX_IDS
+    return pcTaskGetName(s.task);
+}
+
+void ProfilerClass::printFolded(Print &out) {
+    const auto wasSampling = sampling;
+    sampling = false;
+    vTaskDelay(1); // let a tick hook in progress on the other core finish
+
+    for (auto core = 0; core < portNUM_PROCESSORS; core++) {
+        const auto &ring = rings[core];
+        const auto n = ring.head < RING_SIZE ? ring.head : RING_SIZE;
+        uint8_t counted[(RING_SIZE + 7) / 8] = {0};
+
+        for (uint32_t i = 0; i < n; i++) {
+            if (counted[i / 8] & (1 << (i % 8))) {
+                continue;
+            }
+            const auto &s = ring.samples[i];
+            uint32_t count = 0;
+            for (auto j = i; j < n; j++) {
+                if (!(counted[j / 8] & (1 << (j % 8))) && sameStack(s, ring.samples[j])) {
+                    counted[j / 8] |= 1 << (j % 8);
+                    count++;
+                }
+            }
+            out.printf("core%d;%s", core, taskName(s));
+            for (auto z = 0; z < s.depth; z++) {
+                out.printf(";%s", s.zones[z]);
+            }
+            if (s.pc) {
+                out.printf(";0x%lx", (unsigned long)s.pc);
+            }
+            out.printf(" %u\n", (unsigned)count);
+        }
+    }
+
+    sampling = wasSampling;
+}
+
+ProfilerClass Profiler;
+
+#endif
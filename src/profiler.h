@@ -0,0 +1,140 @@
+#pragma once
+
+#include <Arduino.h>
+#include "subsystem.h"
+
+#ifndef PROFILER_RING_SIZE
+#define PROFILER_RING_SIZE 256 ///< samples kept per core
+#endif
+
+#ifdef SUBSYSTEM_PROFILER
+
+/**
+ * @brief Sampling profiler attributing CPU time to subsystems
+ *
+ * Once started, the FreeRTOS tick interrupt of each core records which task it interrupted,
+ * the program counter it interrupted it at, and for threaded subsystems the ProfileZone labels
+ * active at that moment, into a per core ring holding the most recent samples. printFolded()
+ * aggregates the rings into the folded stack format understood by flamegraph.pl and speedscope,
+ * with the program counter as the innermost frame. test/host/symbolize.py replaces those with
+ * function names from the firmware ELF.
+ *
+ * Xtensa code has no frame pointers to walk from an interrupt, so only the program counter is
+ * sampled, not a backtrace; use ProfileZone to break a taskFunction() down further.
+ *
+ * On the host shim, the tick hook is driven by SIGPROF, so samples follow CPU time.
+ *
+ * The profiler and the zone labels of threaded subsystems only exist if built with
+ * SUBSYSTEM_PROFILER, as the rings take 2 * PROFILER_RING_SIZE * 32 bytes. Without it
+ * ProfileZone does nothing.
+ */
+class ProfilerClass {
+public:
+    ProfilerClass();
+
+    /**
+     * @brief start sampling
+     *
+     * @param divider take a sample every divider ticks
+     * @return true on success
+     */
+    bool start(uint32_t divider = 1);
+
+    /**
+     * @brief stop sampling
+     *
+     */
+    void stop();
+
+    /**
+     * @brief discard all samples
+     *
+     */
+    void reset();
+
+    /**
+     * @brief print the samples as folded stacks, "core0;task;zone;zone;0x400d1234 count" per line
+     *
+     * Sampling is paused while printing.
+     *
+     * @param out
+     */
+    void printFolded(Print &out);
+
+private:
+    static const auto MAX_DEPTH = ThreadedSubsystem::PROFILE_DEPTH;
+    static const uint32_t RING_SIZE = PROFILER_RING_SIZE;
+
+    struct Sample {
+        TaskHandle_t task;
+        uintptr_t pc;       ///< where the task was interrupted, 0 if unknown
+        uint8_t subsystem;  ///< id of the task's subsystem, NO_ID for other tasks
+        const char *zones[MAX_DEPTH];
+        uint8_t depth;
+    };
+
+    struct Ring {
+        Sample samples[RING_SIZE];
+        uint32_t head;  ///< total samples taken, the ring holds the last RING_SIZE of them
+        uint32_t ticks;
+    };
+
+    static void tickHook();
+    static uintptr_t interruptedPc(TaskHandle_t task);
+    void sample(int core);
+    static bool sameStack(const Sample &a, const Sample &b);
+    static const char *taskName(const Sample &s);
+
+    Ring rings[portNUM_PROCESSORS];
+    uint32_t divider;
+    volatile bool sampling;
+};
+
+/**
+ * @brief labels a section of a threaded subsystem's code for the profiler for as long as it is in scope
+ *
+ * In your taskFunction():
+ * {
+ *    ProfileZone zone(this, "integrate");
+ *    ...
+ * }
+ */
+class ProfileZone {
+public:
+    /**
+     * @brief push a label
+     *
+     * @param subsystem the subsystem whose task is running this code
+     * @param zone label, must be static
+     */
+    ProfileZone(ThreadedSubsystem *subsystem, const char *zone) : subsystem(subsystem) {
+        const auto depth = subsystem->profileDepth;
+        if (depth < ThreadedSubsystem::PROFILE_DEPTH) {
+            subsystem->profileZones[depth] = zone;
+        }
+        subsystem->profileDepth = depth + 1;
+    }
+
+    ~ProfileZone() {
+        subsystem->profileDepth = subsystem->profileDepth - 1;
+    }
+
+private:
+    ProfileZone(const ProfileZone &other) = delete;
+
+    ThreadedSubsystem *subsystem;
+};
+
+extern ProfilerClass Profiler;
+
+#else
+
+class ProfileZone {
+public:
+    ProfileZone(ThreadedSubsystem */*subsystem*/, const char */*zone*/) {}
+
+private:
+    ProfileZone(const ProfileZone &other) = delete;
+};
+
+#endif
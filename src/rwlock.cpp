@@ -12,7 +12,13 @@ ReadWriteLock::~ReadWriteLock()
 
 void ReadWriteLock::RLock()
 {
+#ifdef SUBSYSTEM_STATS
+    const auto t0 = micros();
     xSemaphoreTake(sem, portMAX_DELAY);
+    readWaitMicros.record(micros() - t0);
+#else
+    xSemaphoreTake(sem, portMAX_DELAY);
+#endif
 }
 
 void ReadWriteLock::RUnlock()
@@ -24,11 +30,17 @@ void ReadWriteLock::Lock()
 {
     uint_fast8_t count;
 
+#ifdef SUBSYSTEM_STATS
+    const auto t0 = micros();
+#endif
     xSemaphoreTake(mutex, portMAX_DELAY);
     for (count = 0; count < MAX_READERS; count++)
     {
         xSemaphoreTake(sem, portMAX_DELAY);
     }
+#ifdef SUBSYSTEM_STATS
+    writeWaitMicros.record(micros() - t0);
+#endif
 }
 
 void ReadWriteLock::UnLock()
@@ -2,6 +2,9 @@
 
 #include <Arduino.h>
 #include <stdint.h>
+#ifdef SUBSYSTEM_STATS
+#include "histogram.h"
+#endif
 
 /**
  * @brief Reader/Writer lock
@@ -44,10 +47,36 @@ public:
      */
     void UnLock();
 
+#ifdef SUBSYSTEM_STATS
+    /**
+     * @brief histogram of time spent waiting for locks, in microseconds
+     *
+     */
+    typedef LatencyHistogram<2, 16> WaitHistogram;
+
+    /**
+     * @brief time readers waited in RLock()
+     *
+     * @return const WaitHistogram&
+     */
+    const WaitHistogram &readWaits() const { return readWaitMicros; }
+
+    /**
+     * @brief time writers waited in Lock()
+     *
+     * @return const WaitHistogram&
+     */
+    const WaitHistogram &writeWaits() const { return writeWaitMicros; }
+#endif
+
 private:
     constexpr static auto MAX_READERS = 8;
     StaticSemaphore_t semaphoreBuffer;
     SemaphoreHandle_t sem;
     StaticSemaphore_t mutexBuffer;
     SemaphoreHandle_t mutex;
+#ifdef SUBSYSTEM_STATS
+    WaitHistogram readWaitMicros;
+    WaitHistogram writeWaitMicros;
+#endif
 };
@@ -0,0 +1,182 @@
+#include "shmbridge.h"
+
+#ifdef SHM_BRIDGE
+
+#include <fcntl.h>
+#include <sched.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static_assert(sizeof(ShmBridgeEntry) == 32, "descriptor layout is shared with other processes");
+static_assert(ATOMIC_INT_LOCK_FREE == 2, "sequence must be lock free to be shared");
+
+ShmBridge::ShmBridge(const char *name) : name(name), base(nullptr), size(0), numEntries(0) {}
+
+ShmBridge::~ShmBridge() {
+    if (base) {
+        munmap(base, size);
+    }
+}
+
+ShmBridge::Entry *ShmBridge::add(const char *name, size_t size, uint8_t direction, void *thing, ApplyFn *apply) {
+    if (base != nullptr || numEntries == MAX_ENTRIES || size > MAX_SIZE ||
+        strlen(name) >= sizeof(ShmBridgeEntry::name)) {
+        return nullptr;
+    }
+    auto &entry = entries[numEntries++];
+    entry.bridge = this;
+    entry.name = name;
+    entry.size = size;
+    entry.direction = direction;
+    entry.thing = thing;
+    entry.apply = apply;
+    entry.offset = 0;
+    entry.lastSequence = 0;
+    return &entry;
+}
+
+bool ShmBridge::open() {
+    if (base != nullptr) {
+        return true;
+    }
+    auto offset = sizeof(ShmBridgeHeader) + numEntries * sizeof(ShmBridgeEntry);
+    for (auto i = 0; i < numEntries; i++) {
+        offset = (offset + SLOT_ALIGN - 1) / SLOT_ALIGN * SLOT_ALIGN;
+        entries[i].offset = offset;
+        offset += SLOT_HEADER + entries[i].size;
+    }
+    const auto total = offset;
+
+    const auto fd = shm_open(name, O_RDWR | O_CREAT, 0600);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return false;
+    }
+    // never shrink a segment the simulator may have mapped, it would fault on the lost pages
+    const auto mapped = static_cast<size_t>(st.st_size) > total ? static_cast<size_t>(st.st_size) : total;
+    if (static_cast<size_t>(st.st_size) < total && ftruncate(fd, total) != 0) {
+        close(fd);
+        return false;
+    }
+    const auto mem = mmap(nullptr, mapped, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mem == MAP_FAILED) {
+        return false;
+    }
+    base = static_cast<uint8_t*>(mem);
+    size = mapped;
+
+    // a segment with our layout, e.g. from a restart with the simulator still running, is
+    // kept as is: imports it holds are published by the first poll()
+    if (!hasLayout(total)) {
+        writeLayout(total);
+    }
+    return true;
+}
+
+bool ShmBridge::hasLayout(size_t total) const {
+    const auto header = reinterpret_cast<const ShmBridgeHeader*>(base);
+    const auto descriptor = reinterpret_cast<const ShmBridgeEntry*>(header + 1);
+    if (reinterpret_cast<const std::atomic<uint32_t>*>(&header->magic)->load(std::memory_order_acquire) != ShmBridgeHeader::MAGIC ||
+        header->headerSize != sizeof(ShmBridgeHeader) || header->numEntries != numEntries ||
+        header->size != total || header->entrySize != sizeof(ShmBridgeEntry)) {
+        return false;
+    }
+    for (auto i = 0; i < numEntries; i++) {
+        if (strncmp(descriptor[i].name, entries[i].name, sizeof(descriptor[i].name)) != 0 ||
+            descriptor[i].direction != entries[i].direction ||
+            descriptor[i].offset != entries[i].offset || descriptor[i].size != entries[i].size) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void ShmBridge::writeLayout(size_t total) {
+    // magic first and last, so a reader never sees a partial layout as valid
+    const auto header = reinterpret_cast<ShmBridgeHeader*>(base);
+    const auto magic = reinterpret_cast<std::atomic<uint32_t>*>(&header->magic);
+    magic->store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    memset(base + sizeof(header->magic), 0, total - sizeof(header->magic));
+
+    const auto descriptor = reinterpret_cast<ShmBridgeEntry*>(header + 1);
+    for (auto i = 0; i < numEntries; i++) {
+        strncpy(descriptor[i].name, entries[i].name, sizeof(descriptor[i].name));
+        descriptor[i].direction = entries[i].direction;
+        descriptor[i].offset = entries[i].offset;
+        descriptor[i].size = entries[i].size;
+    }
+    header->headerSize = sizeof(ShmBridgeHeader);
+    header->numEntries = numEntries;
+    header->size = total;
+    header->entrySize = sizeof(ShmBridgeEntry);
+    magic->store(ShmBridgeHeader::MAGIC, std::memory_order_release);
+}
+
+std::atomic<uint32_t> &ShmBridge::sequenceOf(const Entry &entry) const {
+    return *reinterpret_cast<std::atomic<uint32_t>*>(base + entry.offset);
+}
+
+void ShmBridge::write(const Entry &entry, const void *value) {
+    if (base == nullptr) {
+        return;
+    }
+    auto &sequence = sequenceOf(entry);
+    // callbacks of concurrent publishers take turns: only the one making the sequence odd writes
+    auto s = sequence.load(std::memory_order_relaxed);
+    while ((s & 1) || !sequence.compare_exchange_weak(s, s + 1, std::memory_order_acquire, std::memory_order_relaxed)) {
+        if (s & 1) {
+            sched_yield();
+            s = sequence.load(std::memory_order_relaxed);
+        }
+    }
+    std::atomic_thread_fence(std::memory_order_release);
+    memcpy(base + entry.offset + SLOT_HEADER, value, entry.size);
+    sequence.store(s + 2, std::memory_order_release);
+}
+
+bool ShmBridge::read(Entry &entry, void *value) {
+    auto &sequence = sequenceOf(entry);
+    // a simulator that died mid write leaves the sequence odd, don't spin on it forever
+    for (auto tries = 0; tries < MAX_READ_TRIES; tries++) {
+        const auto before = sequence.load(std::memory_order_acquire);
+        if (before == entry.lastSequence) {
+            return false;
+        }
+        if (before & 1) {
+            continue;
+        }
+        memcpy(value, base + entry.offset + SLOT_HEADER, entry.size);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (sequence.load(std::memory_order_relaxed) == before) {
+            entry.lastSequence = before;
+            return true;
+        }
+    }
+    return false;
+}
+
+int ShmBridge::poll() {
+    if (base == nullptr) {
+        return 0;
+    }
+    uint8_t value[MAX_SIZE];
+    auto published = 0;
+    for (auto i = 0; i < numEntries; i++) {
+        auto &entry = entries[i];
+        if (entry.direction == ShmBridgeEntry::IMPORT && read(entry, value)) {
+            entry.apply(entry.thing, value);
+            published++;
+        }
+    }
+    return published;
+}
+
+#endif
@@ -0,0 +1,167 @@
+#pragma once
+
+// only for software in the loop runs on a POSIX host
+#if !defined(ESP_PLATFORM) && (defined(__unix__) || defined(__APPLE__))
+#define SHM_BRIDGE 1
+
+#include <Arduino.h>
+#include <atomic>
+#include <type_traits>
+#include "subsystem.h"
+
+/*
+ * Shared memory segment layout, all little endian, for the process on the other side:
+ *
+ * ShmBridgeHeader
+ * ShmBridgeEntry[numEntries]       the layout descriptor
+ * per entry at its offset, 64 byte aligned:
+ *    uint32_t sequence             seqlock: odd while being written, bumped by 2 per update
+ *    uint32_t reserved
+ *    uint8_t data[size]            the raw DataThing value
+ *
+ * Readers copy the data between two reads of an even, unchanged sequence. Writers turn the
+ * sequence odd with a compare and swap, so concurrent writers of a slot take turns. The magic
+ * is 0 while the layout is being written.
+ *
+ * test/host builds it against the Arduino shim there.
+ */
+
+struct ShmBridgeHeader {
+    static const uint32_t MAGIC = 0x314d4853; ///< "SHM1"
+
+    uint32_t magic;
+    uint16_t headerSize;    ///< sizeof(ShmBridgeHeader)
+    uint16_t numEntries;
+    uint32_t size;          ///< of the whole segment
+    uint32_t entrySize;     ///< sizeof(ShmBridgeEntry)
+};
+
+struct ShmBridgeEntry {
+    enum Direction : uint8_t {
+        EXPORT,     ///< written by us, read by the simulator, e.g. actuators
+        IMPORT      ///< written by the simulator, read by us, e.g. sensors
+    };
+
+    char name[23];  ///< null terminated
+    uint8_t direction;
+    uint32_t offset;
+    uint32_t size;
+};
+
+/**
+ * @brief ShmBridge maps DataThings into a shared memory segment for an external simulator
+ *
+ * static ShmBridge bridge("/ldrc-sil");
+ * bridge.exportThing("servo", servoThing);
+ * bridge.importThing("imu", imuThing);
+ * bridge.open();
+ * ...
+ * bridge.poll();   // in the simulation loop, publishes updated imports
+ *
+ * Exported things are copied into the segment from their callbacks on every update;
+ * imports are published with accessData() by poll() when the simulator has written them.
+ */
+class ShmBridge {
+public:
+    /**
+     * @brief Construct a new Shm Bridge object
+     *
+     * @param name shm_open() name, e.g. "/ldrc-sil"
+     */
+    ShmBridge(const char *name);
+    ~ShmBridge();
+
+    /**
+     * @brief mirror a DataThing into the segment, before open()
+     *
+     * @param name for the layout descriptor
+     * @param thing
+     * @return false if full, the name is too long or open() was called
+     */
+    template<class T, class Placement>
+    bool exportThing(const char *name, DataThing<T, Placement> &thing) {
+        static_assert(std::is_trivially_copyable<T>::value, "shared things must be trivially copyable");
+        auto entry = add(name, sizeof(T), ShmBridgeEntry::EXPORT, &thing, nullptr);
+        if (entry == nullptr) {
+            return false;
+        }
+        thing.registerCallback([](const T &/*value*/, void *args) {
+            // callbacks get the value unlocked, copy it read locked so a concurrent publish can't tear it
+            const auto entry = static_cast<Entry*>(args);
+            static_cast<DataThing<T, Placement>*>(entry->thing)->readData([](const T &value, void *args) {
+                const auto entry = static_cast<Entry*>(args);
+                entry->bridge->write(*entry, &value);
+            }, entry);
+        }, entry);
+        return true;
+    }
+
+    /**
+     * @brief publish a DataThing from the segment, before open()
+     *
+     * @param name for the layout descriptor
+     * @param thing
+     * @return false if full, the name is too long or open() was called
+     */
+    template<class T, class Placement>
+    bool importThing(const char *name, DataThing<T, Placement> &thing) {
+        static_assert(std::is_trivially_copyable<T>::value, "shared things must be trivially copyable");
+        return add(name, sizeof(T), ShmBridgeEntry::IMPORT, &thing, [](void *thing, const void *value) {
+            static_cast<DataThing<T, Placement>*>(thing)->accessData([](T &data, void *args) {
+                memcpy(&data, args, sizeof(T));
+            }, const_cast<void*>(value));
+        }) != nullptr;
+    }
+
+    /**
+     * @brief create or map the segment and write the layout descriptor
+     *
+     * A segment that already holds the same layout is kept as is, values included, so a
+     * restarted process picks up where the last one left off. Any other content is replaced.
+     *
+     * @return false on error, see errno
+     */
+    bool open();
+
+    /**
+     * @brief publish imports the simulator has updated since the last poll
+     *
+     * @return int number published
+     */
+    int poll();
+
+private:
+    static const auto MAX_ENTRIES = 32;
+    static const auto MAX_SIZE = 1024;  ///< largest thing, for the poll() copy
+    static const auto SLOT_ALIGN = 64;  ///< a cache line, so slots never share one
+    static const auto SLOT_HEADER = 8;
+    static const auto MAX_READ_TRIES = 100;
+
+    typedef void(ApplyFn)(void *thing, const void *value);
+
+    struct Entry {
+        ShmBridge *bridge;
+        const char *name;
+        size_t size;
+        uint8_t direction;
+        void *thing;
+        ApplyFn *apply;
+        uint32_t offset;
+        uint32_t lastSequence;
+    };
+
+    Entry *add(const char *name, size_t size, uint8_t direction, void *thing, ApplyFn *apply);
+    bool hasLayout(size_t total) const;
+    void writeLayout(size_t total);
+    std::atomic<uint32_t> &sequenceOf(const Entry &entry) const;
+    void write(const Entry &entry, const void *value);
+    bool read(Entry &entry, void *value);
+
+    const char *name;
+    uint8_t *base;
+    size_t size;
+    Entry entries[MAX_ENTRIES];
+    uint16_t numEntries;
+};
+
+#endif
@@ -0,0 +1,103 @@
+#include "snapshot.h"
+#include "crc.h"
+#include "warmboot.h"
+
+void snapshotBeforeWrite(SnapshotEntry *entry) {
+    // called by the writer with the thing's lock held, so capture() can't copy concurrently
+    // and can wait for writes that read the epoch before it started
+    const auto active = Snapshot.activeEpoch.load(std::memory_order_acquire);
+    if (active != 0 && entry->savedEpoch != active) {
+        memcpy(entry->copy, entry->data, entry->size);
+        entry->savedEpoch = active;
+    }
+}
+
+SnapshotClass::SnapshotClass() : entries(nullptr), poolUsed(0), epoch(0), activeEpoch(0), startMicros(0) {
+    mutex = xSemaphoreCreateMutexStatic(&mutexBuffer);
+}
+
+SnapshotEntry *SnapshotClass::reserve(const char *name, size_t size) {
+    const auto align = alignof(SnapshotEntry);
+    const auto need = (sizeof(SnapshotEntry) + size + align - 1) / align * align;
+    xSemaphoreTake(mutex, portMAX_DELAY);
+    if (poolUsed + need > SNAPSHOT_POOL_SIZE) {
+        xSemaphoreGive(mutex);
+        return nullptr;
+    }
+    auto entry = reinterpret_cast<SnapshotEntry*>(pool + poolUsed);
+    poolUsed += need;
+    xSemaphoreGive(mutex);
+    entry->name = name;
+    entry->key = WarmBootClass::keyOf(name);
+    entry->size = size;
+    entry->copy = reinterpret_cast<uint8_t*>(entry + 1);
+    entry->savedEpoch = 0;
+    entry->next = nullptr;
+    return entry;
+}
+
+void SnapshotClass::publish(SnapshotEntry *entry) {
+    xSemaphoreTake(mutex, portMAX_DELAY);
+    entry->next = entries;
+    entries = entry;
+    xSemaphoreGive(mutex);
+}
+
+uint32_t SnapshotClass::capture() {
+    xSemaphoreTake(mutex, portMAX_DELAY);
+    const auto e = ++epoch == 0 ? ++epoch : epoch;
+    startMicros = micros();
+    // from here on writers save what they overwrite
+    activeEpoch.store(e, std::memory_order_release);
+    // writers check the epoch with their lock held: once we had each lock, any write that
+    // missed the epoch is done
+    for (auto entry = entries; entry != nullptr; entry = entry->next) {
+        entry->lock->Lock();
+        entry->lock->UnLock();
+    }
+    for (auto entry = entries; entry != nullptr; entry = entry->next) {
+        entry->lock->RLock();
+        if (entry->savedEpoch != e) {
+            memcpy(entry->copy, entry->data, entry->size);
+            entry->savedEpoch = e;
+        }
+        entry->lock->RUnlock();
+    }
+    activeEpoch.store(0, std::memory_order_release);
+    xSemaphoreGive(mutex);
+    return e;
+}
+
+size_t SnapshotClass::dump(Print &out) {
+    xSemaphoreTake(mutex, portMAX_DELAY);
+    uint8_t buf[14];
+    auto put = [&buf](int at, uint32_t v, int n) {
+        for (auto i = 0; i < n; i++) {
+            buf[at + i] = v >> (8 * i);
+        }
+    };
+    uint16_t count = 0;
+    for (auto entry = entries; entry != nullptr; entry = entry->next) {
+        count++;
+    }
+    put(0, MAGIC, 4);
+    put(4, epoch, 4);
+    put(8, startMicros, 4);
+    put(12, count, 2);
+    auto crc = crc32(buf, 14);
+    auto written = out.write(buf, 14);
+    for (auto entry = entries; entry != nullptr; entry = entry->next) {
+        put(0, entry->key, 4);
+        put(4, entry->size, 2);
+        crc = crc32(buf, 6, crc);
+        crc = crc32(entry->copy, entry->size, crc);
+        written += out.write(buf, 6);
+        written += out.write(entry->copy, entry->size);
+    }
+    put(0, crc, 4);
+    written += out.write(buf, 4);
+    xSemaphoreGive(mutex);
+    return written;
+}
+
+SnapshotClass Snapshot;
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <Arduino.h>
+#include <atomic>
+#include <type_traits>
+#include "subsystem.h"
+
+#ifndef SNAPSHOT_POOL_SIZE
+#define SNAPSHOT_POOL_SIZE 4096 ///< bytes for the snapshot copies of all registered things
+#endif
+
+/**
+ * @brief a DataThing registered for snapshots
+ *
+ */
+struct SnapshotEntry {
+    const char *name;
+    uint32_t key;                   ///< WarmBootClass::keyOf(name), identifies the thing in dumps
+    uint16_t size;
+    const void *data;               ///< the thing's data
+    ReadWriteLock *lock;            ///< the thing's lock
+    uint8_t *copy;                  ///< its value as of the last snapshot
+    volatile uint32_t savedEpoch;   ///< the snapshot copy holds the value of this epoch
+    SnapshotEntry *next;
+};
+
+/**
+ * @brief SnapshotClass captures the values of all registered DataThings as of one instant
+ *
+ * capture() starts a new epoch. From then on, the first write to each registered thing
+ * saves the value it overwrites. capture() then takes each thing's lock once, to wait out
+ * writes that began before the epoch, and saves the value of every thing not written since,
+ * so each copy holds the value its thing had when the epoch started. Writers are never
+ * stopped for longer than one copy of their own thing.
+ *
+ * The exception is a write in progress when the epoch starts: its result is captured, and if
+ * it was computed from other registered things read after the epoch started, the snapshot
+ * pairs it with their older values. Things written independently, e.g. each by its own
+ * sensor subsystem, always form a consistent cut.
+ *
+ * Snapshot.add(gps, "gps");
+ * ...
+ * Snapshot.capture();
+ * Snapshot.dump(logFile);
+ */
+class SnapshotClass {
+public:
+    static const uint32_t MAGIC = 0x31504e53; ///< "SNP1"
+
+    /*
+     * dump() format, little endian:
+     *    uint32_t MAGIC
+     *    uint32_t epoch
+     *    uint32_t micros       when the epoch started
+     *    uint16_t count
+     *    per thing: uint32_t key, uint16_t size, uint8_t value[size]
+     *    uint32_t crc32()      of everything before
+     */
+
+    SnapshotClass();
+
+    /**
+     * @brief register a DataThing, e.g. in setup()
+     *
+     * @param thing
+     * @param name
+     * @return false if SNAPSHOT_POOL_SIZE is used up
+     */
+    template<class T, class Placement>
+    bool add(DataThing<T, Placement> &thing, const char *name) {
+        static_assert(std::is_trivially_copyable<T>::value, "snapshot things must be trivially copyable");
+        auto entry = reserve(name, sizeof(T));
+        if (entry == nullptr) {
+            return false;
+        }
+        entry->data = &thing.data;
+        entry->lock = &thing.lock;
+        thing.lock.Lock();
+        thing.snapshot = entry;
+        thing.lock.UnLock();
+        publish(entry);
+        return true;
+    }
+
+    /**
+     * @brief capture all registered things
+     *
+     * @return uint32_t the epoch of the snapshot
+     */
+    uint32_t capture();
+
+    /**
+     * @brief write the last snapshot
+     *
+     * @param out
+     * @return size_t bytes written
+     */
+    size_t dump(Print &out);
+
+    // to save values before they are overwritten
+    friend void snapshotBeforeWrite(SnapshotEntry *entry);
+
+private:
+    SnapshotEntry *reserve(const char *name, size_t size);
+    void publish(SnapshotEntry *entry);
+
+    SnapshotEntry *entries;
+    size_t poolUsed;
+    uint32_t epoch;
+    std::atomic<uint32_t> activeEpoch; ///< epoch being captured, 0 if none
+    uint32_t startMicros;
+    SemaphoreHandle_t mutex;
+    StaticSemaphore_t mutexBuffer;
+    alignas(SnapshotEntry) uint8_t pool[SNAPSHOT_POOL_SIZE];
+};
+
+extern SnapshotClass Snapshot;
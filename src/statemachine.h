@@ -0,0 +1,282 @@
+#pragma once
+
+#include <Arduino.h>
+#include <type_traits>
+#include "subsystem.h"
+
+/**
+ * @brief a transition of a StateMachine: in state from, on event, if guard, run action and go to state to
+ *
+ * @tparam Context what guards and actions work on, the inputs and outputs of the machine
+ * @tparam State an enum with a last COUNT enumerator
+ * @tparam Event an enum with a last COUNT enumerator
+ */
+template<class Context, class State, class Event>
+struct StateRule {
+    typedef bool(GuardFn)(const Context &context);
+    typedef void(ActionFn)(Context &context);
+
+    State from;
+    Event event;
+    State to;
+    GuardFn *guard;     ///< nullptr to always take the transition
+    ActionFn *action;   ///< nullptr for none
+};
+
+/**
+ * @brief transition rules compiled into a dense state x event table
+ *
+ * Build it at compile time from an array of rules with makeTransitionTable(). Rules for the
+ * same state and event are tried in the order given until a guard passes, so dispatching an
+ * event is a table lookup plus one guard call per competing rule.
+ */
+template<class Context, class State, class Event, size_t NUM_RULES>
+class TransitionTable {
+public:
+    typedef StateRule<Context, State, Event> Rule;
+
+    static const size_t NUM_STATES = static_cast<size_t>(State::COUNT);
+    static const size_t NUM_EVENTS = static_cast<size_t>(Event::COUNT);
+    static const uint8_t NONE = 0xff;
+
+    static_assert(NUM_RULES < NONE, "too many rules");
+    static_assert(NUM_STATES <= NONE && NUM_EVENTS <= NONE, "too many states or events");
+
+    constexpr TransitionTable(const Rule (&from)[NUM_RULES]) : rules{}, first{}, chain{} {
+        for (size_t s = 0; s < NUM_STATES; s++) {
+            for (size_t e = 0; e < NUM_EVENTS; e++) {
+                first[s][e] = NONE;
+            }
+        }
+        // walk backwards, prepending, so each cell chains its rules in declaration order
+        for (size_t i = NUM_RULES; i-- > 0;) {
+            rules[i] = from[i];
+            auto &cell = first[static_cast<size_t>(from[i].from)][static_cast<size_t>(from[i].event)];
+            chain[i] = cell;
+            cell = i;
+        }
+    }
+
+    /**
+     * @brief find the transition to take
+     *
+     * @param state
+     * @param event
+     * @param context passed to guards
+     * @return const Rule* nullptr if the event is ignored in this state
+     */
+    const Rule *find(State state, Event event, const Context &context) const {
+        if (static_cast<size_t>(state) >= NUM_STATES || static_cast<size_t>(event) >= NUM_EVENTS) {
+            return nullptr;
+        }
+        for (auto i = first[static_cast<size_t>(state)][static_cast<size_t>(event)]; i != NONE; i = chain[i]) {
+            if (rules[i].guard == nullptr || rules[i].guard(context)) {
+                return &rules[i];
+            }
+        }
+        return nullptr;
+    }
+
+private:
+    Rule rules[NUM_RULES];
+    uint8_t first[NUM_STATES][NUM_EVENTS];  ///< first rule of each cell, NONE if empty
+    uint8_t chain[NUM_RULES];               ///< next rule of the same cell
+};
+
+/**
+ * @brief compile rules into a TransitionTable
+ *
+ * static constexpr FlightMachine::Rule rules[] = {
+ *    {Phase::PAD, Input::LAUNCH, Phase::BOOST, armed, startTimers},
+ *    {Phase::BOOST, Input::BURNOUT, Phase::COAST, nullptr, nullptr},
+ *    ...
+ * };
+ * static constexpr auto table = makeTransitionTable(rules);
+ */
+template<class Context, class State, class Event, size_t NUM_RULES>
+constexpr TransitionTable<Context, State, Event, NUM_RULES> makeTransitionTable(const StateRule<Context, State, Event> (&rules)[NUM_RULES]) {
+    return TransitionTable<Context, State, Event, NUM_RULES>(rules);
+}
+
+/**
+ * @brief the published state of a StateMachine
+ *
+ */
+template<class State>
+struct MachineState {
+    State state;
+    uint32_t enteredMillis; ///< millis() when the state was entered
+    uint32_t transitions;   ///< number of transitions taken
+};
+
+/**
+ * @brief StateMachine runs a TransitionTable as a tickable subsystem and publishes its state
+ *
+ * Events are posted from any task, e.g. from DataThing callbacks set up with watch(), and
+ * dispatched in order from tick(), so guards and actions always run in the ticking task.
+ * Subscribe to the machine like to any DataThing to be called on each transition.
+ *
+ * @tparam Context see StateRule
+ * @tparam State see StateRule
+ * @tparam Event see StateRule
+ * @tparam NUM_RULES
+ */
+template<class Context, class State, class Event, size_t NUM_RULES>
+class StateMachine : public TickableSubsystem, public DataThing<MachineState<State>> {
+public:
+    typedef StateRule<Context, State, Event> Rule;
+    typedef TransitionTable<Context, State, Event, NUM_RULES> Table;
+
+    /**
+     * @brief Construct a new State Machine and add it to SubsystemManager
+     *
+     * @param name subsystem name
+     * @param table the transitions, usually a static constexpr
+     * @param initial state
+     * @param deps null terminated array of subsystems to set up first, or nullptr
+     */
+    StateMachine(const char *name, const Table &table, State initial, BaseSubsystem **deps = nullptr) :
+        DataThing<MachineState<State>>(rwLock), table(table), context{}, numWatches(0), spec(this, deps) {
+        this->name = name;
+        this->data.state = initial;
+        this->data.enteredMillis = 0;
+        this->data.transitions = 0;
+        queue = xQueueCreateStatic(QUEUE_LENGTH, sizeof(uint8_t), queueStorage, &queueBuffer);
+        SubsystemManager.addSubsystem(&spec);
+    }
+
+    Status setup() {
+        setStatus(READY);
+        return getStatus();
+    }
+
+    /**
+     * @brief dispatch all posted events
+     *
+     * @return Status
+     */
+    Status tick() {
+        uint8_t event;
+        while (xQueueReceive(queue, &event, 0) == pdTRUE) {
+            dispatch(static_cast<Event>(event));
+        }
+        return getStatus();
+    }
+
+    /**
+     * @brief queue an event for the next tick(). Never blocks
+     *
+     * @param event
+     * @return false if the queue is full and the event was dropped
+     */
+    bool post(Event event) {
+        const auto e = static_cast<uint8_t>(event);
+        return xQueueSend(queue, &e, 0) == pdTRUE;
+    }
+
+    /**
+     * @brief feed updates of a DataThing into the context and derive events from them
+     *
+     * fn runs in the updating task with the machine locked: copy what guards need into the
+     * context and return the event to post, Event::COUNT for none.
+     *
+     * @param source
+     * @param fn
+     * @return false if too many things are watched
+     */
+    template<class T, class Placement>
+    bool watch(DataThing<T, Placement> &source, Event(fn)(const T &value, Context &context)) {
+        if (numWatches == MAX_WATCHES) {
+            return false;
+        }
+        auto &w = watches[numWatches++];
+        w.machine = this;
+        w.fn = reinterpret_cast<void(*)()>(fn);
+        source.registerCallback([](const T &value, void *args) {
+            const auto w = static_cast<Watch*>(args);
+            const auto input = reinterpret_cast<Event(*)(const T&, Context&)>(w->fn);
+            w->machine->rwLock.Lock();
+            const auto event = input(value, w->machine->context);
+            w->machine->rwLock.UnLock();
+            if (event != Event::COUNT) {
+                w->machine->post(event);
+            }
+        }, &w);
+        return true;
+    }
+
+    /**
+     * @brief the current state
+     *
+     * @return State
+     */
+    State state() const {
+        rwLock.RLock();
+        const auto s = this->data.state;
+        rwLock.RUnlock();
+        return s;
+    }
+
+#ifdef SUBSYSTEM_STATS
+    /**
+     * @brief time to dispatch an event including guards and actions, in microseconds
+     *
+     * @return const LatencyHistogram<>&
+     */
+    const LatencyHistogram<> &dispatchDurations() const { return dispatchMicros; }
+#endif
+
+protected:
+    /**
+     * @brief take the transition for an event, if any
+     *
+     * @param event
+     * @return true if a transition was taken
+     */
+    bool dispatch(Event event) {
+#ifdef SUBSYSTEM_STATS
+        const auto t0 = micros();
+#endif
+        rwLock.Lock();
+        const auto rule = table.find(this->data.state, event, context);
+        if (rule) {
+            this->willWrite();
+            if (rule->action) {
+                rule->action(context);
+            }
+            this->data.state = rule->to;
+            this->data.enteredMillis = millis();
+            this->data.transitions++;
+        }
+        rwLock.UnLock();
+#ifdef SUBSYSTEM_STATS
+        dispatchMicros.record(micros() - t0);
+#endif
+        if (rule) {
+            this->callCallbacks();
+        }
+        return rule != nullptr;
+    }
+
+private:
+    static const auto QUEUE_LENGTH = 16;
+    static const auto MAX_WATCHES = 8;
+
+    struct Watch {
+        StateMachine *machine;
+        void (*fn)();   ///< the input function, type erased
+    };
+
+    const Table &table;
+    Context context;
+    Watch watches[MAX_WATCHES];
+    uint8_t numWatches;
+    StaticQueue_t queueBuffer;
+    uint8_t queueStorage[QUEUE_LENGTH];
+    QueueHandle_t queue;
+#ifdef SUBSYSTEM_STATS
+    LatencyHistogram<> dispatchMicros;
+#endif
+
+    SubsystemManagerClass::Spec spec;
+};
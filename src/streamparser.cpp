@@ -0,0 +1,153 @@
+#include "streamparser.h"
+
+NmeaParser::NmeaParser(SentenceFn *fn, void *args) :
+    fn(fn), args(args), state(IDLE), sum(0), expected(0), length(0) {}
+
+int NmeaParser::hexValue(uint8_t c) {
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    return -1;
+}
+
+void NmeaParser::consume(const uint8_t *data, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        const auto c = data[i];
+        if (c == '$') {
+            // always resynchronize on a start character
+            if (state != IDLE) {
+                errorCount++;
+            }
+            state = BODY;
+            sum = 0;
+            length = 0;
+            continue;
+        }
+        switch (state) {
+        case IDLE:
+            break;
+        case BODY:
+            if (c == '*') {
+                state = CHECKSUM_HIGH;
+            } else if (c == '\r' || c == '\n' || length == MAX_SENTENCE) {
+                errorCount++;
+                state = IDLE;
+            } else {
+                sentence[length++] = c;
+                sum ^= c;
+            }
+            break;
+        case CHECKSUM_HIGH: {
+            const auto v = hexValue(c);
+            if (v < 0) {
+                errorCount++;
+                state = IDLE;
+                break;
+            }
+            expected = v << 4;
+            state = CHECKSUM_LOW;
+            break;
+        }
+        case CHECKSUM_LOW: {
+            const auto v = hexValue(c);
+            state = IDLE;
+            if (v < 0 || (expected | v) != sum) {
+                errorCount++;
+                break;
+            }
+            sentence[length] = '\0';
+            if (fn) {
+                fn(sentence, length, args);
+            }
+            break;
+        }
+        }
+    }
+}
+
+UbxParser::UbxParser(MessageFn *fn, void *args) :
+    fn(fn), args(args), state(SYNC1), msgClass(0), msgId(0), ckA(0), ckB(0), length(0), received(0) {}
+
+void UbxParser::consume(const uint8_t *data, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        const auto b = data[i];
+        switch (state) {
+        case SYNC1:
+            if (b == 0xb5) {
+                state = SYNC2;
+            }
+            break;
+        case SYNC2:
+            state = b == 0x62 ? CLASS : (b == 0xb5 ? SYNC2 : SYNC1);
+            ckA = ckB = 0;
+            break;
+        case CLASS:
+            msgClass = b;
+            checksum(b);
+            state = ID;
+            break;
+        case ID:
+            msgId = b;
+            checksum(b);
+            state = LENGTH_LOW;
+            break;
+        case LENGTH_LOW:
+            length = b;
+            checksum(b);
+            state = LENGTH_HIGH;
+            break;
+        case LENGTH_HIGH:
+            length |= static_cast<size_t>(b) << 8;
+            checksum(b);
+            received = 0;
+            if (length > UBX_MAX_PAYLOAD) {
+                errorCount++;
+                state = SYNC1;
+            } else {
+                state = length ? PAYLOAD : CHECKSUM_A;
+            }
+            break;
+        case PAYLOAD: {
+            // take as much of the span as belongs to the payload in one go
+            auto n = length - received;
+            if (n > len - i) {
+                n = len - i;
+            }
+            memcpy(payload + received, data + i, n);
+            for (size_t j = 0; j < n; j++) {
+                checksum(data[i + j]);
+            }
+            received += n;
+            i += n - 1;
+            if (received == length) {
+                state = CHECKSUM_A;
+            }
+            break;
+        }
+        case CHECKSUM_A:
+            if (b != ckA) {
+                errorCount++;
+                state = b == 0xb5 ? SYNC2 : SYNC1;
+                break;
+            }
+            state = CHECKSUM_B;
+            break;
+        case CHECKSUM_B:
+            state = SYNC1;
+            if (b != ckB) {
+                errorCount++;
+                break;
+            }
+            if (fn) {
+                fn(msgClass, msgId, payload, length, args);
+            }
+            break;
+        }
+    }
+}
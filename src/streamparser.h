@@ -0,0 +1,131 @@
+#pragma once
+
+#include <Arduino.h>
+
+#ifndef UBX_MAX_PAYLOAD
+#define UBX_MAX_PAYLOAD 256 ///< larger UBX messages are dropped
+#endif
+
+/**
+ * @brief StreamParser is the interface of incremental parsers fed from a byte stream
+ *
+ */
+class StreamParser {
+public:
+    virtual ~StreamParser() {}
+
+    /**
+     * @brief parse the next bytes of the stream. Frames may span any number of calls
+     *
+     * @param data
+     * @param len
+     */
+    virtual void consume(const uint8_t *data, size_t len) = 0;
+
+    /**
+     * @brief number of frames dropped for bad checksums or overlong content
+     *
+     * @return uint32_t
+     */
+    uint32_t errors() const { return errorCount; }
+
+protected:
+    StreamParser() : errorCount(0) {}
+
+    uint32_t errorCount;
+};
+
+/**
+ * @brief parses NMEA 0183 sentences, e.g. "$GPGGA,...*47\r\n"
+ *
+ */
+class NmeaParser : public StreamParser {
+public:
+    /**
+     * @brief called with a valid sentence, without '$' and checksum, NUL terminated
+     *
+     */
+    typedef void(SentenceFn)(const char *sentence, size_t len, void *args);
+
+    /**
+     * @brief Construct a new Nmea Parser
+     *
+     * @param fn called for each sentence with a valid checksum
+     * @param args additional arguments to call fn with
+     */
+    NmeaParser(SentenceFn *fn, void *args);
+
+    void consume(const uint8_t *data, size_t len);
+
+private:
+    static const size_t MAX_SENTENCE = 82;
+
+    enum State {
+        IDLE,
+        BODY,
+        CHECKSUM_HIGH,
+        CHECKSUM_LOW
+    };
+
+    static int hexValue(uint8_t c);
+
+    SentenceFn *fn;
+    void *args;
+    State state;
+    uint8_t sum;
+    uint8_t expected;
+    size_t length;
+    char sentence[MAX_SENTENCE + 1];
+};
+
+/**
+ * @brief parses u-blox UBX binary messages
+ *
+ */
+class UbxParser : public StreamParser {
+public:
+    /**
+     * @brief called with the payload of a message with a valid checksum
+     *
+     */
+    typedef void(MessageFn)(uint8_t msgClass, uint8_t msgId, const uint8_t *payload, size_t len, void *args);
+
+    /**
+     * @brief Construct a new Ubx Parser
+     *
+     * @param fn called for each message with a valid checksum
+     * @param args additional arguments to call fn with
+     */
+    UbxParser(MessageFn *fn, void *args);
+
+    void consume(const uint8_t *data, size_t len);
+
+private:
+    enum State {
+        SYNC1,
+        SYNC2,
+        CLASS,
+        ID,
+        LENGTH_LOW,
+        LENGTH_HIGH,
+        PAYLOAD,
+        CHECKSUM_A,
+        CHECKSUM_B
+    };
+
+    void checksum(uint8_t b) {
+        ckA += b;
+        ckB += ckA;
+    }
+
+    MessageFn *fn;
+    void *args;
+    State state;
+    uint8_t msgClass;
+    uint8_t msgId;
+    uint8_t ckA;
+    uint8_t ckB;
+    size_t length;
+    size_t received;
+    uint8_t payload[UBX_MAX_PAYLOAD];
+};
@@ -1,8 +1,13 @@
 #include "subsystem.h"
 #include <Arduino.h>
+#include "warmboot.h"
+#include "metrics.h"
+#ifdef MANAGER_DEBUG
+#include "logger.h"
+#endif
 
 
-BaseSubsystem::BaseSubsystem() : status(BaseSubsystem::INIT), name("UNSET") {
+BaseSubsystem::BaseSubsystem() : status(BaseSubsystem::INIT), name("UNSET"), decimation(1), id(NO_ID) {
 }
 
 BaseSubsystem::~BaseSubsystem() {}
@@ -20,6 +25,39 @@ void BaseSubsystem::setStatus(BaseSubsystem::Status newStatus) {
     rwLock.UnLock();
 }
 
+size_t BaseSubsystem::warmStateSize() const {
+    return 0;
+}
+
+uint16_t BaseSubsystem::warmStateVersion() const {
+    return 0;
+}
+
+void BaseSubsystem::saveWarmState(void */*buf*/) const {
+}
+
+BaseSubsystem::Status BaseSubsystem::restoreWarmState(const void */*buf*/) {
+    return INIT;
+}
+
+uint8_t BaseSubsystem::getDecimation() const {
+    return decimation;
+}
+
+uint8_t BaseSubsystem::getId() const {
+    return id;
+}
+
+void BaseSubsystem::setDecimation(uint8_t n) {
+    decimation = n;
+}
+
+TickableSubsystem *TickableSubsystem::tickables = nullptr;
+
+TickableSubsystem::TickableSubsystem() : nextTickable(tickables), tickCount(0) {
+    tickables = this;
+}
+
 TickableSubsystem::~TickableSubsystem() {}
 
 // Not meaningful in tickable subsystem
@@ -28,7 +66,26 @@ BaseSubsystem::Status TickableSubsystem::start() {
     return getStatus();
 }
 
-ThreadedSubsystem::ThreadedSubsystem() : taskHandle(0) {
+bool TickableSubsystem::due() {
+    const auto n = decimation;
+    if (n == 0 || ++tickCount < n) {
+        return false;
+    }
+    tickCount = 0;
+    return true;
+}
+
+ThreadedSubsystem *ThreadedSubsystem::threadedSubsystems = nullptr;
+
+ThreadedSubsystem::ThreadedSubsystem() : taskHandle(0), nextThreaded(threadedSubsystems),
+    nominalWakeTick(0), pendingWakeTick(0), sleeping(false) {
+    threadedSubsystems = this;
+#ifdef SUBSYSTEM_PROFILER
+    profileDepth = 0;
+#endif
+#ifdef SUBSYSTEM_STATS
+    lastWakeMicros = 0;
+#endif
 }
 
 ThreadedSubsystem::~ThreadedSubsystem() {}
@@ -46,13 +103,14 @@ BaseSubsystem::Status ThreadedSubsystem::start() {
         self->taskFunction(param);
     };
     if (getStatus() != FAULT) {
+        memset(taskStack, STACK_CANARY_PATTERN, STACK_CANARY_SIZE);
         taskHandle = xTaskCreateStaticPinnedToCore(
             taskFn,
             name,
-            STACK_SIZE,
+            STACK_SIZE - STACK_CANARY_SIZE,
             this,
             taskPriority(),
-            taskStack,
+            taskStack + STACK_CANARY_SIZE,
             &taskBuffer,
             0);
     }
@@ -72,10 +130,176 @@ void * const ThreadedSubsystem::taskParameter() {
     return nullptr;
 }
 
+static Counter wakeups("subsystem.wakeups");
+static Counter sharedWakeups("subsystem.wakeups.shared");
+
+TickType_t ThreadedSubsystem::wakeSlack() const {
+    return 0;
+}
+
+TickType_t ThreadedSubsystem::coalesce(TickType_t tick, TickType_t slack) {
+    if (slack == 0) {
+        return tick;
+    }
+    // join the earliest wakeup already scheduled within our slack
+    auto found = false;
+    TickType_t best = 0;
+    for (auto s = threadedSubsystems; s != nullptr; s = s->nextThreaded) {
+        if (!s->sleeping) {
+            continue;
+        }
+        const auto late = static_cast<int32_t>(s->pendingWakeTick - tick);
+        if (late >= 0 && static_cast<TickType_t>(late) <= slack && (!found || s->pendingWakeTick - tick < best - tick)) {
+            best = s->pendingWakeTick;
+            found = true;
+        }
+    }
+    if (found) {
+        sharedWakeups.add();
+        return best;
+    }
+    // otherwise wake on the slot grid, where later subsystems can join
+    const auto aligned = tick + (WAKE_SLOT_TICKS - tick % WAKE_SLOT_TICKS) % WAKE_SLOT_TICKS;
+    return aligned - tick <= slack ? aligned : tick;
+}
+
+TickType_t ThreadedSubsystem::nextWakeTick() {
+    const auto now = xTaskGetTickCount();
+    TickType_t next = portMAX_DELAY;
+    for (auto s = threadedSubsystems; s != nullptr; s = s->nextThreaded) {
+        const auto wake = s->pendingWakeTick;
+        if (s->sleeping && static_cast<int32_t>(wake - now) >= 0 && wake - now < next) {
+            next = wake - now;
+        }
+    }
+    return next;
+}
+
+void ThreadedSubsystem::setDecimation(uint8_t n) {
+    const auto stopped = decimation == 0;
+    BaseSubsystem::setDecimation(n);
+    if (stopped && n != 0 && taskHandle != nullptr) {
+#if SUBSYSTEM_NOTIFY_INDEX > 0
+        xTaskNotifyGiveIndexed(taskHandle, SUBSYSTEM_NOTIFY_INDEX);
+#else
+        xTaskNotifyGive(taskHandle);
+#endif
+    }
+}
+
+void ThreadedSubsystem::waitForNextCycle(TickType_t period) {
+    while (decimation == 0) {
+        // stopped by the current mode until setDecimation() wakes us, then restart the schedule
+#if SUBSYSTEM_NOTIFY_INDEX > 0
+        ulTaskNotifyTakeIndexed(SUBSYSTEM_NOTIFY_INDEX, pdTRUE, portMAX_DELAY);
+#else
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+#endif
+        nominalWakeTick = 0;
+#ifdef SUBSYSTEM_STATS
+        lastWakeMicros = 0;
+#endif
+    }
+    period *= decimation;
+    const auto now = xTaskGetTickCount();
+    if (nominalWakeTick == 0) {
+        nominalWakeTick = now;
+    }
+    nominalWakeTick += period;
+    if (static_cast<int32_t>(now - nominalWakeTick) > static_cast<int32_t>(period)) {
+        // more than a cycle behind, don't try to catch up with a burst
+        nominalWakeTick = now;
+    }
+    // the nominal schedule is kept, so slack only adds jitter, not drift
+    const auto wake = coalesce(nominalWakeTick, wakeSlack());
+    const auto delay = static_cast<int32_t>(wake - now);
+    if (delay > 0) {
+        pendingWakeTick = wake;
+        sleeping = true;
+        vTaskDelay(delay);
+        sleeping = false;
+        wakeups.add();
+    }
+#ifdef SUBSYSTEM_STATS
+    const auto nowMicros = micros();
+    if (lastWakeMicros != 0) {
+        const int32_t deviation = (nowMicros - lastWakeMicros) - period * portTICK_PERIOD_MS * 1000;
+        jitterMicros.record(deviation < 0 ? -deviation : deviation);
+    }
+    lastWakeMicros = nowMicros;
+#endif
+}
+
+bool ThreadedSubsystem::stackCanaryIntact() const {
+    for (auto i = 0; i < STACK_CANARY_SIZE; i++) {
+        if (taskStack[i] != STACK_CANARY_PATTERN) {
+            return false;
+        }
+    }
+    return true;
+}
+
+uint32_t ThreadedSubsystem::stackHighWaterMark() const {
+    if (taskHandle == nullptr) {
+        return 0;
+    }
+    // ESP-IDF reports the high water mark in bytes, not words
+    return uxTaskGetStackHighWaterMark(taskHandle);
+}
+
+uint32_t ThreadedSubsystem::recommendedStackSize() const {
+    const uint32_t usable = STACK_SIZE - STACK_CANARY_SIZE;
+    if (taskHandle == nullptr) {
+        return usable;
+    }
+    const auto used = usable - stackHighWaterMark();
+    const auto wanted = used + (used * STACK_MARGIN_PERCENT) / 100 + STACK_CANARY_SIZE;
+    return ((wanted + STACK_GRANULARITY - 1) / STACK_GRANULARITY) * STACK_GRANULARITY;
+}
+
+bool ThreadedSubsystem::checkStacks() {
+    auto ok = true;
+    for (auto s = threadedSubsystems; s != nullptr; s = s->nextThreaded) {
+        if (s->taskHandle == nullptr || s->stackCanaryIntact()) {
+            continue;
+        }
+        ok = false;
+        if (s->getStatus() != FAULT) {
+            // whatever the task does next can only make matters worse
+            vTaskSuspend(s->taskHandle);
+            s->setStatus(FAULT);
+        }
+    }
+    return ok;
+}
+
+void ThreadedSubsystem::printStackReport(Print &out) {
+    // the canary is carved out of the stack, the task only gets the rest
+    const uint32_t usable = STACK_SIZE - STACK_CANARY_SIZE;
+    uint32_t total = 0, recommended = 0;
+    for (auto s = threadedSubsystems; s != nullptr; s = s->nextThreaded) {
+        const auto free = s->stackHighWaterMark();
+        const auto rec = s->recommendedStackSize();
+        out.printf("'%s': stack %u, min free %u, canary %s, recommend %u\n",
+            s->name,
+            (unsigned)usable,
+            (unsigned)free,
+            s->stackCanaryIntact() ? "ok" : "BROKEN",
+            (unsigned)rec);
+        total += STACK_SIZE;
+        recommended += rec;
+    }
+    out.printf("total stack %u, recommended %u\n", (unsigned)total, (unsigned)recommended);
+}
+
 SubsystemManagerClass::SubsystemManagerClass() {}
 SubsystemManagerClass::~SubsystemManagerClass() {}
 
-SubsystemManagerClass::Spec::Spec(BaseSubsystem *subsys, BaseSubsystem** deps) : subsystem(subsys), deps(deps), next(NULL) {}
+SubsystemManagerClass::Spec::Spec(BaseSubsystem *subsys, BaseSubsystem** deps) : subsystem(subsys), deps(deps), next(NULL) {
+    memset(modeDecimation, 1, sizeof(modeDecimation));
+}
+
+SubsystemManagerClass::Mode::Mode(const char *name, const Rate *rates) : name(name), rates(rates), index(0), next(NULL) {}
 
 
 void SubsystemManagerClass::addSubsystem(Spec *spec) {
@@ -94,6 +318,29 @@ void SubsystemManagerClass::addSubsystem(Spec *spec) {
         spec->next = NULL;
     }
     specs = spec;
+    if (spec->subsystem->id == BaseSubsystem::NO_ID && numAssigned < MAX_IDS) {
+        ids[numAssigned] = spec->subsystem;
+        spec->subsystem->id = numAssigned++;
+    }
+}
+
+uint8_t SubsystemManagerClass::numIds() const {
+    return numAssigned;
+}
+
+BaseSubsystem *SubsystemManagerClass::byId(uint8_t id) const {
+    return id < numAssigned ? ids[id] : nullptr;
+}
+
+const char *SubsystemManagerClass::nameOf(uint8_t id) const {
+    const auto subsystem = byId(id);
+    return subsystem ? subsystem->name : "UNKNOWN";
+}
+
+void SubsystemManagerClass::printNames(Print &out) const {
+    for (uint8_t id = 0; id < numAssigned; id++) {
+        out.printf("%u %s\n", (unsigned)id, ids[id]->name);
+    }
 }
 
 
@@ -101,30 +348,127 @@ BaseSubsystem::Status SubsystemManagerClass::setup() {
     auto spec = specs;
 
     #ifdef MANAGER_DEBUG
-    Serial.println("in setup, specs dump:");
+    Logger.log("in setup, specs dump:\n");
     while (spec != NULL && spec->subsystem != NULL) {
-        Serial.printf("'%s' depends on (", spec->subsystem->name);
+        Logger.log("%u '%s' depends on (", spec->subsystem->id, spec->subsystem->name);
         for (auto i = 0; spec && spec->deps && spec->deps[i]; i++) {
             auto s = spec->deps[i];
             if (s && s->name) {
-                Serial.printf("'%s', ", s->name);
+                Logger.log("'%s', ", s->name);
             }
         }
-        Serial.println(")");
+        Logger.log(")\n");
+        // the logger task isn't running yet, don't let the rings overflow
+        Logger.flush();
         spec = spec->next;
     }
     spec = specs;
-    Serial.println();
+    Logger.log("\n");
+    Logger.flush();
     #endif
 
     while (spec != NULL && spec->subsystem != NULL) {
         descendAndStartOrSetup(spec, READY);
         spec = spec->next;
     }
+    resolveModes();
+    saveWarmBootState();
     setStatus(READY);
     return getStatus();
 }
 
+// warm boot entries are keyed by name, unnamed subsystems would share one
+static bool hasWarmBootKey(const char *name) {
+    return name && *name && strcmp(name, "UNSET") != 0;
+}
+
+bool SubsystemManagerClass::restoreFromWarmBoot(BaseSubsystem *subsystem) {
+    const auto size = subsystem->warmStateSize();
+    if (size == 0 || !hasWarmBootKey(subsystem->name)) {
+        return false;
+    }
+    const auto state = WarmBoot.find(WarmBootClass::keyOf(subsystem->name), subsystem->warmStateVersion(), size);
+    if (state == NULL) {
+        return false;
+    }
+    return subsystem->restoreWarmState(state) == READY;
+}
+
+void SubsystemManagerClass::saveWarmBootState() {
+    WarmBoot.clear();
+    for (auto spec = specs; spec != NULL && spec->subsystem != NULL; spec = spec->next) {
+        const auto subsystem = spec->subsystem;
+        const auto size = subsystem->warmStateSize();
+        const auto status = subsystem->getStatus();
+        if (size == 0 || !hasWarmBootKey(subsystem->name) || (status != READY && status != RUNNING)) {
+            continue;
+        }
+        auto buf = WarmBoot.reserve(WarmBootClass::keyOf(subsystem->name), subsystem->warmStateVersion(), size);
+        if (buf) {
+            subsystem->saveWarmState(buf);
+        }
+    }
+    WarmBoot.commit();
+}
+
+bool SubsystemManagerClass::addMode(Mode *mode) {
+    if (mode == NULL || numModes == MAX_MODES) {
+        return false;
+    }
+    mode->index = numModes++;
+    mode->next = modes;
+    modes = mode;
+    return true;
+}
+
+void SubsystemManagerClass::resolveModes() {
+    for (auto m = modes; m != NULL; m = m->next) {
+        for (auto r = m->rates; r && r->subsystem; r++) {
+            const auto spec = findSpecBySubsystem(r->subsystem);
+            if (spec) {
+                spec->modeDecimation[m->index] = r->decimation;
+            }
+        }
+    }
+}
+
+bool SubsystemManagerClass::setMode(Mode *newMode) {
+    const auto status = getStatus();
+    if (status != READY && status != RUNNING) {
+        return false;
+    }
+    auto m = modes;
+    while (m != NULL && m != newMode) {
+        m = m->next;
+    }
+    if (m == NULL) {
+        return false;
+    }
+    rwLock.Lock();
+    const auto index = newMode->index;
+    for (auto spec = specs; spec != NULL && spec->subsystem != NULL; spec = spec->next) {
+        spec->subsystem->setDecimation(spec->modeDecimation[index]);
+    }
+    mode = newMode;
+    rwLock.UnLock();
+    #ifdef MANAGER_DEBUG
+    Logger.log("mode '%s'\n", newMode->name);
+    #endif
+    return true;
+}
+
+SubsystemManagerClass::Mode *SubsystemManagerClass::currentMode() const {
+    return mode;
+}
+
+void SubsystemManagerClass::tick() {
+    for (auto t = TickableSubsystem::tickables; t != nullptr; t = t->nextTickable) {
+        if (t->getStatus() == RUNNING && t->due()) {
+            t->tick();
+        }
+    }
+}
+
 BaseSubsystem::Status SubsystemManagerClass::start() {
     auto spec = specs;
     while (spec != NULL && spec->subsystem != NULL) {
@@ -152,7 +496,6 @@ void SubsystemManagerClass::descendAndStartOrSetup(Spec *spec, BaseSubsystem::St
         return;
     }
     const auto subsystem = spec->subsystem;
-    const auto name = subsystem->name;
 
     auto deps = spec->deps;
     for (auto i = 0; deps && deps[i] && depth < 8; i++) {
@@ -164,19 +507,28 @@ void SubsystemManagerClass::descendAndStartOrSetup(Spec *spec, BaseSubsystem::St
         return;
     }
     if (desiredState == READY && status == INIT) {
+        if (restoreFromWarmBoot(subsystem)) {
+            #ifdef MANAGER_DEBUG
+            Logger.log("restored subsystem '%s' from warm boot state\n", subsystem->name);
+            Logger.flush();
+            #endif
+            return;
+        }
         #ifdef MANAGER_DEBUG
-        Serial.printf("setup subsystem '%s' (status: %d) -> ", subsystem->name, status);
+        Logger.log("setup subsystem '%s' (status: %d) -> ", subsystem->name, status);
         auto newstatus = subsystem->setup();
-        Serial.printf(" (status: %d)\n", newstatus);
+        Logger.log(" (status: %d)\n", newstatus);
+        Logger.flush();
         #else
         subsystem->setup();
         #endif
     }
     if (desiredState == RUNNING && status == READY) {
         #ifdef MANAGER_DEBUG
-        Serial.printf("start subsystem '%s' (status: %d) -> ", subsystem->name, status);
+        Logger.log("start subsystem '%s' (status: %d) -> ", subsystem->name, status);
         auto newstatus = subsystem->start();
-        Serial.printf(" (status: %d)\n", newstatus);
+        Logger.log(" (status: %d)\n", newstatus);
+        Logger.flush();
         #else
         subsystem->start();
         #endif
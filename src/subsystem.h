@@ -2,6 +2,15 @@
 
 #include <Arduino.h>
 #include "rwlock.h"
+#include "placement.h"
+
+#ifndef SUBSYSTEM_NOTIFY_INDEX
+#if defined(configTASK_NOTIFICATION_ARRAY_ENTRIES) && configTASK_NOTIFICATION_ARRAY_ENTRIES > 1
+#define SUBSYSTEM_NOTIFY_INDEX (configTASK_NOTIFICATION_ARRAY_ENTRIES - 1) ///< task notification resuming waitForNextCycle()
+#else
+#define SUBSYSTEM_NOTIFY_INDEX 0
+#endif
+#endif
 
 /**
  * @brief BaseSubsystem is the base class of all subsystems. It is not to be directly used.
@@ -38,8 +47,58 @@ class BaseSubsystem {
      */
     Status getStatus() const;
 
+    /**
+     * @brief override to support warm boot: the size of the setup() results that can be saved
+     *
+     * @note defaults to 0, no warm boot. State is saved under the subsystem's name, so only
+     * subsystems with a name set, unique among them, are warm booted
+     *
+     * @return size_t
+     */
+    virtual size_t warmStateSize() const;
+
+    /**
+     * @brief override to bump when the layout of the saved state changes. Defaults to 0
+     *
+     * @return uint16_t
+     */
+    virtual uint16_t warmStateVersion() const;
+
+    /**
+     * @brief override to save setup() results after setup, e.g. calibration
+     *
+     * @param buf warmStateSize() bytes to fill
+     */
+    virtual void saveWarmState(void *buf) const;
+
+    /**
+     * @brief override to restore state saved by saveWarmState() after an unintended reset, instead of setup()
+     *
+     * @param buf warmStateSize() bytes as saved
+     * @return Status READY, set with setStatus(), if restored; anything else runs setup() instead
+     */
+    virtual Status restoreWarmState(const void *buf);
+
+    /**
+     * @brief how many cycles or ticks the current mode runs this subsystem in
+     *
+     * @return uint8_t 1 for every one, n for every nth, 0 if the mode stops it
+     */
+    uint8_t getDecimation() const;
+
+    static const uint8_t NO_ID = 0xff;
+
+    /**
+     * @brief the dense id SubsystemManager assigned when the subsystem was added, for compact
+     * references in logs and telemetry. See SubsystemManagerClass::nameOf()
+     *
+     * @return uint8_t ids count up from 0 in order of addition, NO_ID if not added
+     */
+    uint8_t getId() const;
+
     // to get access to name
     friend class SubsystemManagerClass;
+    friend class ProfilerClass;
 
  protected:
     BaseSubsystem();
@@ -52,6 +111,13 @@ class BaseSubsystem {
      */
     void setStatus(Status newStatus);
 
+    /**
+     * @brief called by SubsystemManager on mode transitions
+     *
+     * @param n see getDecimation()
+     */
+    virtual void setDecimation(uint8_t n);
+
     /**
      * @brief Inner status attribute. Do not set/get directly, use setter/getter
      *
@@ -69,14 +135,28 @@ class BaseSubsystem {
      *
      */
     mutable ReadWriteLock rwLock;
+
+    /**
+     * @brief set by the current mode, see getDecimation()
+     *
+     */
+    volatile uint8_t decimation;
+
+    /**
+     * @brief see getId()
+     *
+     */
+    uint8_t id;
 };
 
 /**
  * @brief Inherit from this class if your subsystem needs to be periodically called
  *
+ * Either call tick() yourself, or have SubsystemManager.tick() call it at the rate of the current mode.
  */
 class TickableSubsystem : public BaseSubsystem {
  public:
+    TickableSubsystem();
     virtual ~TickableSubsystem();
 
     /**
@@ -87,6 +167,16 @@ class TickableSubsystem : public BaseSubsystem {
     virtual Status tick() = 0;
 
     virtual Status start();
+
+ private:
+    // to tick all tickable subsystems
+    friend class SubsystemManagerClass;
+
+    bool due();
+
+    static TickableSubsystem *tickables;
+    TickableSubsystem *nextTickable;
+    uint8_t tickCount;
 };
 
 /**
@@ -105,6 +195,67 @@ class ThreadedSubsystem : public BaseSubsystem {
      */
     Status start();
 
+    /**
+     * @brief check the guard region below the task stack
+     *
+     * @note always true unless built with SUBSYSTEM_STACK_CANARY
+     *
+     * @return true if the canary is untouched
+     */
+    bool stackCanaryIntact() const;
+
+    /**
+     * @brief the least amount of free stack the task has had, in bytes. 0 if not started
+     *
+     * @return uint32_t
+     */
+    uint32_t stackHighWaterMark() const;
+
+    /**
+     * @brief a stack size that covers the peak usage seen so far plus a safety margin
+     *
+     * @note only meaningful after the subsystem has been through its worst case path
+     *
+     * @return uint32_t bytes
+     */
+    uint32_t recommendedStackSize() const;
+
+    /**
+     * @brief check the canaries of all threaded subsystems. Call periodically, e.g. from loop()
+     *
+     * Subsystems with a damaged canary are suspended and set to FAULT.
+     *
+     * @return true if all canaries are intact
+     */
+    static bool checkStacks();
+
+    /**
+     * @brief print stack usage and sizing recommendation of every threaded subsystem
+     *
+     * @param out where to print to, e.g. Serial
+     */
+    static void printStackReport(Print &out);
+
+    /**
+     * @brief the earliest tick a threaded subsystem sleeping in waitForNextCycle() will wake at
+     *
+     * @note for idle hooks and diagnostics. Tickless idle doesn't use it: ESP-IDF takes the
+     * expected idle time from the kernel's delayed task list, where waitForNextCycle() already
+     * puts the coalesced wakeup, and that also covers tasks that aren't subsystems
+     *
+     * @return TickType_t ticks from now, portMAX_DELAY if none is sleeping
+     */
+    static TickType_t nextWakeTick();
+
+#ifdef SUBSYSTEM_STATS
+    /**
+     * @brief deviation of the cycle period from the one asked for in waitForNextCycle(), in microseconds
+     *
+     * @return const LatencyHistogram<>&
+     */
+    const LatencyHistogram<> &cycleJitter() const { return jitterMicros; }
+#endif
+
  protected:
     /**
      * @brief override to return the task priority of your choosing. Defaults to tskIDLE_PRIORITY
@@ -129,6 +280,33 @@ class ThreadedSubsystem : public BaseSubsystem {
      */
     virtual void taskFunction(void *parameter) = 0;
 
+    /**
+     * @brief block until the next cycle of a periodic taskFunction() loop
+     *
+     * Unlike vTaskDelay() the period does not drift with the time spent in the loop body.
+     * Within wakeSlack(), the wakeup is moved to coincide with that of another subsystem or
+     * onto a shared slot grid, so the CPU wakes less often and tickless idle sleeps longer.
+     *
+     * The period is multiplied by getDecimation(). While the current mode stops the subsystem,
+     * this blocks until a mode runs it again, woken by task notification SUBSYSTEM_NOTIFY_INDEX.
+     * With a single notification per task, the ESP-IDF default, that is index 0, shared with
+     * taskFunction(): a resume given before the task got here stays pending and ends its next
+     * ulTaskNotifyTake() early. Set CONFIG_FREERTOS_TASK_NOTIFICATION_ARRAY_ENTRIES to 2 or
+     * more to give it its own.
+     *
+     * @param period cycle period in ticks
+     */
+    void waitForNextCycle(TickType_t period);
+
+    /**
+     * @brief override to let waitForNextCycle() wake up to this many ticks late to share wakeups. Defaults to 0
+     *
+     * @return TickType_t
+     */
+    virtual TickType_t wakeSlack() const;
+
+    void setDecimation(uint8_t n);
+
     /**
      * @brief TaskHandle for the thread of this subsystem
      *
@@ -138,17 +316,94 @@ class ThreadedSubsystem : public BaseSubsystem {
 
  private:
     static const auto STACK_SIZE = 4096; // 4K ought to be enough for anyone, right?
+#ifdef SUBSYSTEM_STACK_CANARY
+    static const auto STACK_CANARY_SIZE = 32;
+#else
+    static const auto STACK_CANARY_SIZE = 0;
+#endif
+    static const uint8_t STACK_CANARY_PATTERN = 0x5a;
+    static const auto STACK_MARGIN_PERCENT = 25;
+    static const auto STACK_GRANULARITY = 256;
+
+    // all threaded subsystems, for stack checking and reporting
+    static ThreadedSubsystem *threadedSubsystems;
+    ThreadedSubsystem *nextThreaded;
+
+#ifdef SUBSYSTEM_PROFILER
+    // labels pushed by ProfileZone, read by the profiler's tick hook on the same core
+    friend class ProfilerClass;
+    friend class ProfileZone;
+    static const auto PROFILE_DEPTH = 4;
+    const char *volatile profileZones[PROFILE_DEPTH];
+    volatile uint8_t profileDepth;
+#endif
+
+    static const TickType_t WAKE_SLOT_TICKS = 10;
+    static TickType_t coalesce(TickType_t tick, TickType_t slack);
+
+    TickType_t nominalWakeTick;
+    volatile TickType_t pendingWakeTick;
+    volatile bool sleeping;
+#ifdef SUBSYSTEM_STATS
+    uint32_t lastWakeMicros;
+    LatencyHistogram<> jitterMicros;
+#endif
+
     StaticTask_t taskBuffer;
+    // stacks grow down, so the canary sits at the start, between the stack and taskBuffer
     StackType_t taskStack[STACK_SIZE];
 };
 
+struct SnapshotEntry;
+
 /**
- * @brief DataThing is designed to provide subsribe read primitives
+ * @brief keep the value about to be overwritten if a snapshot is being taken, see SnapshotClass
+ *
+ * @param entry
+ */
+void snapshotBeforeWrite(SnapshotEntry *entry);
+
+/**
+ * @brief where a DataThing keeps its data, see placement.h
  *
  * @tparam T
+ * @tparam Placement
  */
+template<class T, class Placement>
+class DataStorage {
+   protected:
+      DataStorage() : data(*storage.get()) {}
+
+   private:
+      // before data, so it is constructed first
+      typename Placement::template Storage<T, 1> storage;
+
+   protected:
+      /**
+       * @brief The actual data itself
+       *
+       */
+      T &data;
+};
+
 template<class T>
-class DataThing {
+class DataStorage<T, InlinePlacement> {
+   protected:
+      /**
+       * @brief The actual data itself
+       *
+       */
+      T data;
+};
+
+/**
+ * @brief DataThing is designed to provide subsribe read primitives
+ *
+ * @tparam T
+ * @tparam Placement where data is kept, see placement.h
+ */
+template<class T, class Placement = InlinePlacement>
+class DataThing : public DataStorage<T, Placement> {
    public:
       typedef void(DataFn)(const T &, void *args);
 
@@ -159,17 +414,26 @@ class DataThing {
        *
        * @param locker a ReadWriteLocker to lock
        */
-      DataThing(ReadWriteLock &locker) : lock(locker), numCallbacks(0) {}
+      DataThing(ReadWriteLock &locker) : lock(locker), numCallbacks(0), snapshot(nullptr) {}
 
       virtual ~DataThing() {}
 
+#ifdef SUBSYSTEM_STATS
+      /**
+       * @brief time each registered callback took, in microseconds
+       *
+       * @return const LatencyHistogram<>&
+       */
+      const LatencyHistogram<> &callbackDurations() const { return callbackMicros; }
+#endif
+
       /**
        * @brief register a callback to be called when Data changes
        *
        * @param fn a function to be called with const reference to data
        * @param args additional arguments to be call function with
        */
-      void registerCallback(DataThing<T>::DataFn fn, void *args) {
+      void registerCallback(DataFn fn, void *args) {
          lock.Lock();
          if (numCallbacks == MAX_CALLBACKS) {
             //Log.errorln("Tried to add beyond %d callbacks", MAX_CALLBACKS);
@@ -193,9 +457,9 @@ class DataThing {
        * @param fn a function to be called with const reference to data
        * @param args additional arguments to be call function with
        */
-      void readData(DataThing<T>::DataFn fn, void *args) const {
+      void readData(DataFn fn, void *args) const {
          lock.RLock();
-         fn(data, args);
+         fn(this->data, args);
          lock.RUnlock();
       }
 
@@ -207,7 +471,8 @@ class DataThing {
        */
       void accessData(void(fn)(T &data, void *args), void *args) {
          lock.Lock();
-         fn(data, args);
+         willWrite();
+         fn(this->data, args);
          lock.UnLock();
          callCallbacks();
       }
@@ -227,7 +492,13 @@ class DataThing {
             lock.RLock();
             callback cb = callbacks[i];
             lock.RUnlock();
-            cb.fn(data, cb.args);
+#ifdef SUBSYSTEM_STATS
+            const auto t0 = micros();
+            cb.fn(this->data, cb.args);
+            callbackMicros.record(micros() - t0);
+#else
+            cb.fn(this->data, cb.args);
+#endif
          }
       }
 
@@ -238,12 +509,19 @@ class DataThing {
       virtual void onUpdate() {}
 
       /**
-       * @brief The actual data itself
+       * @brief call with the lock held before writing data other than through accessData()
        *
        */
-      T data;
+      void willWrite() {
+         if (snapshot) {
+            snapshotBeforeWrite(snapshot);
+         }
+      }
 
    private:
+      // to register things
+      friend class SnapshotClass;
+
       static constexpr size_t MAX_CALLBACKS = 8;
 
       DataThing() = delete;
@@ -257,6 +535,10 @@ class DataThing {
          void (*fn)(const T&, void*);
       };
       callback callbacks[MAX_CALLBACKS];
+      SnapshotEntry *snapshot;
+#ifdef SUBSYSTEM_STATS
+      LatencyHistogram<> callbackMicros;
+#endif
 };
 
 /**
@@ -265,6 +547,9 @@ class DataThing {
  */
 class SubsystemManagerClass : public BaseSubsystem {
 public:
+   static const uint8_t MAX_MODES = 8;
+   static const uint8_t MAX_IDS = 64;
+
    /**
     * @brief Specification for dependencies of a threaded subsystem
     *
@@ -283,6 +568,38 @@ public:
        */
       BaseSubsystem **deps;
       Spec *next;
+
+      /**
+       * @brief decimation of the subsystem in each mode, filled in by setup()
+       *
+       */
+      uint8_t modeDecimation[MAX_MODES];
+   };
+
+   /**
+    * @brief an operating mode, e.g. a flight phase, and the rates subsystems run at in it
+    *
+    */
+   struct Mode {
+      /**
+       * @brief decimation of one subsystem in a mode
+       *
+       */
+      struct Rate {
+         BaseSubsystem *subsystem;
+         uint8_t decimation;  ///< run every nth cycle or tick, 0 to stop
+      };
+
+      Mode(const char *name, const Rate *rates);
+      const char *name;
+
+      /**
+       * @brief array terminated by a null subsystem. Subsystems not listed run at full rate
+       *
+       */
+      const Rate *rates;
+      uint8_t index;
+      Mode *next;
    };
 
    SubsystemManagerClass();
@@ -302,12 +619,113 @@ public:
     * SubsystemManager.addSubsystem(&spec);
     */
    void addSubsystem(Spec *spec);
+
+   /**
+    * @brief setup all subsystems
+    *
+    * After a watchdog, panic or brown-out reset, subsystems supporting warm boot are restored
+    * from state saved in RTC memory instead. The state of all subsystems is saved at the end.
+    *
+    * @return Status
+    */
    Status setup();
    Status start();
 
+   /**
+    * @brief save the warm boot state of all ready subsystems, e.g. after recalibrating one
+    *
+    */
+   void saveWarmBootState();
+
+   /**
+    * @brief add an operating mode, before setup()
+    *
+    * static const SubsystemManagerClass::Mode::Rate coastRates[] = {
+    *    {&Pyro, 1}, {&Imu, 2}, {&Gps, 10}, {&Heater, 0}, {NULL, 0}
+    * };
+    * static SubsystemManagerClass::Mode coast("coast", coastRates);
+    * SubsystemManager.addMode(&coast);
+    *
+    * @param mode
+    * @return false if MAX_MODES are already added
+    */
+   bool addMode(Mode *mode);
+
+   /**
+    * @brief switch all subsystems to the rates of a mode, after setup()
+    *
+    * The rates of each mode are resolved by setup(), so a transition is a single pass over
+    * the subsystems without lookups. Concurrent transitions are serialized; each subsystem
+    * picks up its new rate at its next cycle or tick. Threaded subsystems only follow modes
+    * if they pace themselves with waitForNextCycle().
+    *
+    * @param mode
+    * @return false if the mode was not added or setup() has not run
+    */
+   bool setMode(Mode *mode);
+
+   /**
+    * @brief the mode last switched to
+    *
+    * @return Mode* nullptr if none yet, all subsystems at full rate
+    */
+   Mode *currentMode() const;
+
+   /**
+    * @brief tick all running tickable subsystems due in the current mode. Call at the base rate, e.g. from loop()
+    *
+    */
+   void tick();
+
+   /**
+    * @brief number of ids assigned
+    *
+    * @return uint8_t ids are 0 to numIds() - 1
+    */
+   uint8_t numIds() const;
+
+   /**
+    * @brief the subsystem with an id
+    *
+    * @param id see BaseSubsystem::getId()
+    * @return BaseSubsystem* nullptr if none
+    */
+   BaseSubsystem *byId(uint8_t id) const;
+
+   /**
+    * @brief the name of the subsystem with an id
+    *
+    * @param id see BaseSubsystem::getId()
+    * @return const char* "UNKNOWN" if none
+    */
+   const char *nameOf(uint8_t id) const;
+
+   /**
+    * @brief print the name table, "id name" per line, for tools decoding ids
+    *
+    * Ids depend on the order subsystems are constructed in, so keep the table with every
+    * recording that uses them.
+    *
+    * @param out
+    */
+   void printNames(Print &out) const;
+
 private:
    Spec* specs;
 
+   // zero before any constructor runs, like modes
+   BaseSubsystem *ids[MAX_IDS];
+   uint8_t numAssigned;
+
+   // zero before any constructor runs, so modes can be added during static construction
+   Mode *modes;
+   uint8_t numModes;
+   Mode *volatile mode;
+
+   void resolveModes();
+
+   bool restoreFromWarmBoot(BaseSubsystem *subsystem);
+
    Spec* findSpecBySubsystem(BaseSubsystem *needle);
    void descendAndStartOrSetup(Spec *spec, BaseSubsystem::Status desiredState, int depth=0);
 };
@@ -0,0 +1,47 @@
+#include "uartingest.h"
+
+UartIngest::UartIngest(const char *name, HardwareSerial &serial, StreamParser **parsers, int priority) :
+    serial(serial), parsers(parsers), priority(priority), byteCount(0), spec(this, nullptr) {
+    this->name = name;
+    SubsystemManager.addSubsystem(&spec);
+}
+
+UartIngest::~UartIngest() {}
+
+BaseSubsystem::Status UartIngest::setup() {
+    serial.onReceive([this]() {
+        if (taskHandle) {
+            xTaskNotifyGive(taskHandle);
+        }
+    });
+    setStatus(READY);
+    return getStatus();
+}
+
+uint32_t UartIngest::bytesReceived() const {
+    rwLock.RLock();
+    const auto rc = byteCount;
+    rwLock.RUnlock();
+    return rc;
+}
+
+int UartIngest::taskPriority() const {
+    return priority;
+}
+
+void UartIngest::taskFunction(void */*parameter*/) {
+    for (;;) {
+        const auto available = serial.available();
+        if (available <= 0) {
+            ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(IDLE_WAIT_MS));
+            continue;
+        }
+        const auto n = serial.read(block, available < BLOCK_SIZE ? available : BLOCK_SIZE);
+        for (auto i = 0; parsers && parsers[i]; i++) {
+            parsers[i]->consume(block, n);
+        }
+        rwLock.Lock();
+        byteCount += n;
+        rwLock.UnLock();
+    }
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <Arduino.h>
+#include "subsystem.h"
+#include "streamparser.h"
+
+/**
+ * @brief UartIngest reads a UART in blocks and feeds them to stream parsers
+ *
+ * The task sleeps until the UART driver signals received data, then takes everything
+ * available in blocks and hands each block to every parser. Parsers decode frames and
+ * publish them, typically into a DataThing, from their callbacks, which run in this task.
+ *
+ * Received bytes are copied twice after the driver's ISR moves them into its ring buffer:
+ * read() copies them into this subsystem's block, and parsers copy frame contents into their
+ * own buffers, e.g. UbxParser assembles each payload, so frames may span blocks. Both copies
+ * are bulk memcpy()s of at most a block, cheap next to the checksums computed per byte.
+ *
+ * On the host, HardwareSerial::open() feeds a UART from a file or pty, see test/host.
+ */
+class UartIngest : public ThreadedSubsystem {
+public:
+    /**
+     * @brief Construct a new Uart Ingest object and add it to SubsystemManager
+     *
+     * @param name subsystem name
+     * @param serial the UART, which must already be begun
+     * @param parsers null terminated array of parsers each fed all bytes, e.g. {&nmea, &ubx, NULL}
+     * @param priority task priority
+     */
+    UartIngest(const char *name, HardwareSerial &serial, StreamParser **parsers, int priority = tskIDLE_PRIORITY + 1);
+    virtual ~UartIngest();
+
+    Status setup();
+
+    /**
+     * @brief total number of bytes read from the UART
+     *
+     * @return uint32_t
+     */
+    uint32_t bytesReceived() const;
+
+protected:
+    int taskPriority() const;
+    void taskFunction(void *parameter);
+
+private:
+    static const auto BLOCK_SIZE = 256;
+    static const auto IDLE_WAIT_MS = 10; // in case a receive notification is missed
+
+    HardwareSerial &serial;
+    StreamParser **parsers;
+    const int priority;
+    uint32_t byteCount;
+    uint8_t block[BLOCK_SIZE];
+
+    SubsystemManagerClass::Spec spec;
+};
@@ -0,0 +1,168 @@
+#pragma once
+
+#include <Arduino.h>
+#include <math.h>
+#include <algorithm>
+#include <type_traits>
+#include "subsystem.h"
+
+/**
+ * @brief how Voter reaches the fields of a value. Specialize for your structs:
+ *
+ * template<> struct VoterTraits<Baro> {
+ *    static const size_t FIELDS = 2;
+ *    static float get(const Baro &b, size_t i) { return i ? b.temperature : b.pressure; }
+ *    static void set(Baro &b, size_t i, float v) { (i ? b.temperature : b.pressure) = v; }
+ * };
+ *
+ * Arithmetic types work as is.
+ */
+template<class T, class Enable = void>
+struct VoterTraits;
+
+template<class T>
+struct VoterTraits<T, typename std::enable_if<std::is_arithmetic<T>::value>::type> {
+    static const size_t FIELDS = 1;
+    static float get(const T &v, size_t) { return static_cast<float>(v); }
+    static void set(T &v, size_t, float f) { v = static_cast<T>(f); }
+};
+
+/**
+ * @brief the published result of a Voter
+ *
+ */
+template<class T>
+struct Voted {
+    T value;                ///< per field median of the fresh sources
+    uint8_t fresh;          ///< bit i set if source i updated within the maximum age
+    uint8_t disagreeing;    ///< bit i set if fresh source i is off the vote by more than the tolerance
+    uint8_t sources;        ///< number of fresh sources voted over, 0 if value is stale
+    uint32_t timestamp;     ///< micros() of the vote
+};
+
+/**
+ * @brief Voter merges N redundant sources of the same kind into one, e.g. 3 barometers
+ *
+ * On every update of any source the latest value of each is kept with its timestamp and
+ * each field is voted as the median of the fresh sources, which with three sources is mid
+ * value select: any single faulty one is outvoted. Stale sources are left out and flagged,
+ * as are sources too far off the vote. Consumers subscribe to the voter only.
+ *
+ * @tparam T
+ * @tparam N number of sources, at most 8
+ */
+template<class T, size_t N>
+class Voter : public DataThing<Voted<T>> {
+public:
+    static_assert(N > 0 && N <= 8, "1 to 8 sources");
+    typedef VoterTraits<T> Traits;
+
+    /**
+     * @brief Construct a new Voter object
+     *
+     * @param maxAgeMicros sources not updated for longer are stale
+     * @param tolerance fields further off the vote mark a source as disagreeing
+     */
+    Voter(uint32_t maxAgeMicros, float tolerance) :
+        DataThing<Voted<T>>(lock), maxAge(maxAgeMicros), tolerance(tolerance), stamps(), updated(0), numSources(0) {
+        this->data = Voted<T>();
+    }
+
+    /**
+     * @brief add a source
+     *
+     * @note call after the source is constructed, e.g. from setup()
+     *
+     * @param source
+     * @return false if N sources are already attached
+     */
+    template<class Placement>
+    bool attach(DataThing<T, Placement> &source) {
+        if (numSources == N) {
+            return false;
+        }
+        auto &input = inputs[numSources];
+        input.voter = this;
+        input.index = numSources++;
+        source.registerCallback([](const T &value, void *args) {
+            const auto input = static_cast<Input*>(args);
+            input->voter->update(input->index, value);
+        }, &input);
+        return true;
+    }
+
+private:
+    struct Input {
+        Voter *voter;
+        uint8_t index;
+    };
+
+    void update(uint8_t index, const T &value) {
+        const auto now = micros();
+        lock.Lock();
+        this->willWrite();
+        latest[index] = value;
+        stamps[index] = now;
+        updated |= 1 << index;
+        vote(now);
+        lock.UnLock();
+        this->callCallbacks();
+    }
+
+    // called with lock held
+    void vote(uint32_t now) {
+        auto &out = this->data;
+        uint8_t fresh = 0, count = 0;
+        for (size_t i = 0; i < N; i++) {
+            if ((updated & (1 << i)) && now - stamps[i] <= maxAge) {
+                fresh |= 1 << i;
+                count++;
+            }
+        }
+        out.fresh = fresh;
+        out.sources = count;
+        out.disagreeing = 0;
+        out.timestamp = now;
+        if (count == 0) {
+            return;
+        }
+        // fields not voted on come from the first fresh source
+        for (size_t i = 0; i < N; i++) {
+            if (fresh & (1 << i)) {
+                out.value = latest[i];
+                break;
+            }
+        }
+        for (size_t f = 0; f < Traits::FIELDS; f++) {
+            float values[N];
+            size_t n = 0;
+            for (size_t i = 0; i < N; i++) {
+                if (fresh & (1 << i)) {
+                    values[n++] = Traits::get(latest[i], f);
+                }
+            }
+            const auto mid = values + n / 2;
+            std::nth_element(values, mid, values + n);
+            auto median = *mid;
+            if (n % 2 == 0) {
+                // the mean of the two middle values; the lower one is the largest below mid
+                median = (median + *std::max_element(values, mid)) / 2;
+            }
+            Traits::set(out.value, f, median);
+            for (size_t i = 0; i < N; i++) {
+                if ((fresh & (1 << i)) && fabsf(Traits::get(latest[i], f) - median) > tolerance) {
+                    out.disagreeing |= 1 << i;
+                }
+            }
+        }
+    }
+
+    ReadWriteLock lock;
+    const uint32_t maxAge;
+    const float tolerance;
+    T latest[N];
+    uint32_t stamps[N];
+    uint8_t updated;    ///< bit i set once source i has a value, any stamp is valid
+    Input inputs[N];
+    uint8_t numSources;
+};
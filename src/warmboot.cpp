@@ -0,0 +1,113 @@
+#include "warmboot.h"
+#include <esp_system.h>
+#include "crc.h"
+
+// not cleared on reset, only lost on power on
+RTC_NOINIT_ATTR static uint32_t pool[WARMBOOT_POOL_SIZE / sizeof(uint32_t)];
+
+WarmBootClass::WarmBootClass() : state(UNKNOWN) {}
+
+bool WarmBootClass::warmReset() {
+    switch (esp_reset_reason()) {
+    case ESP_RST_PANIC:
+    case ESP_RST_INT_WDT:
+    case ESP_RST_TASK_WDT:
+    case ESP_RST_WDT:
+    case ESP_RST_BROWNOUT:
+        return true;
+    default:
+        // power on, deliberate restarts and wake from deep sleep get a full setup
+        return false;
+    }
+}
+
+WarmBootClass::Header &WarmBootClass::header() {
+    return *reinterpret_cast<Header*>(pool);
+}
+
+uint8_t *WarmBootClass::entries() {
+    return reinterpret_cast<uint8_t*>(pool) + sizeof(Header);
+}
+
+bool WarmBootClass::isWarm() const {
+    if (state == UNKNOWN) {
+        auto &h = header();
+        const auto valid = h.magic == MAGIC &&
+            h.used <= sizeof(pool) - sizeof(Header) &&
+            h.crc == crc32(entries(), h.used);
+        if (warmReset() && valid && h.restores < WARMBOOT_MAX_RESTORES) {
+            h.restores++;
+            state = WARM;
+        } else {
+            // including a boot loop: a full setup replaces whatever state keeps crashing
+            h.restores = 0;
+            state = COLD;
+        }
+    }
+    return state == WARM;
+}
+
+uint32_t WarmBootClass::restores() const {
+    isWarm();
+    return header().restores;
+}
+
+void WarmBootClass::markHealthy() {
+    isWarm();
+    header().restores = 0;
+}
+
+const void *WarmBootClass::find(uint32_t key, uint16_t version, size_t size) const {
+    if (!isWarm()) {
+        return nullptr;
+    }
+    const auto used = header().used;
+    for (uint32_t pos = 0; pos + sizeof(Entry) <= used;) {
+        const auto entry = reinterpret_cast<const Entry*>(entries() + pos);
+        const auto data = entries() + pos + sizeof(Entry);
+        if (entry->key == key) {
+            return entry->version == version && entry->size >= size ? data : nullptr;
+        }
+        pos += sizeof(Entry) + entry->size;
+    }
+    return nullptr;
+}
+
+void WarmBootClass::clear() {
+    // settle the restore count before the pool is rewritten
+    isWarm();
+    state = COLD;
+    header().magic = 0;
+    header().used = 0;
+}
+
+void *WarmBootClass::reserve(uint32_t key, uint16_t version, size_t size) {
+    const auto padded = (size + 3) & ~static_cast<size_t>(3);
+    auto &h = header();
+    if (h.used + sizeof(Entry) + padded > sizeof(pool) - sizeof(Header) || padded > UINT16_MAX) {
+        return nullptr;
+    }
+    auto entry = reinterpret_cast<Entry*>(entries() + h.used);
+    entry->key = key;
+    entry->version = version;
+    entry->size = padded;
+    h.used += sizeof(Entry) + padded;
+    return entries() + h.used - padded;
+}
+
+void WarmBootClass::commit() {
+    auto &h = header();
+    h.crc = crc32(entries(), h.used);
+    h.magic = MAGIC;
+}
+
+uint32_t WarmBootClass::keyOf(const char *name) {
+    // FNV-1a
+    uint32_t hash = 2166136261u;
+    while (name && *name) {
+        hash = (hash ^ static_cast<uint8_t>(*name++)) * 16777619u;
+    }
+    return hash;
+}
+
+WarmBootClass WarmBoot;
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <Arduino.h>
+
+#ifndef WARMBOOT_POOL_SIZE
+#define WARMBOOT_POOL_SIZE 1024 ///< bytes of RTC memory kept for warm boot state
+#endif
+
+#ifndef WARMBOOT_MAX_RESTORES
+#define WARMBOOT_MAX_RESTORES 3 ///< consecutive warm boots before falling back to a full setup
+#endif
+
+/**
+ * @brief WarmBoot keeps subsystem setup results in RTC memory that survives resets other than power on
+ *
+ * After a watchdog, panic or brown-out reset, SubsystemManager restores subsystems from here
+ * instead of running their setup(). Entries are keyed by subsystem name and tagged with a
+ * layout version, and the whole pool is protected by a CRC, so stale or partial state is
+ * never restored.
+ *
+ * State that is valid but makes the system crash again would restore forever, so after
+ * WARMBOOT_MAX_RESTORES warm boots in a row the next one is treated as cold. The count is
+ * cleared by a cold boot or by markHealthy().
+ */
+class WarmBootClass {
+public:
+    WarmBootClass();
+
+    /**
+     * @brief whether this boot followed an unintended reset and a valid pool was found
+     *
+     * @return true
+     */
+    bool isWarm() const;
+
+    /**
+     * @brief warm boots in a row, including this one, since the last cold boot or markHealthy()
+     *
+     * @return uint32_t
+     */
+    uint32_t restores() const;
+
+    /**
+     * @brief call once the system has run well for a while, so a later reset may restore again
+     *
+     */
+    void markHealthy();
+
+    /**
+     * @brief find a saved entry
+     *
+     * @param key keyOf() the subsystem name
+     * @param version layout version the caller expects
+     * @param size size the caller expects
+     * @return const void* the saved bytes, nullptr if not warm or no matching entry
+     */
+    const void *find(uint32_t key, uint16_t version, size_t size) const;
+
+    /**
+     * @brief invalidate the pool and start filling it anew
+     *
+     */
+    void clear();
+
+    /**
+     * @brief reserve space for an entry after clear()
+     *
+     * @param key keyOf() the subsystem name
+     * @param version layout version
+     * @param size
+     * @return void* where to write the entry, nullptr if the pool is full
+     */
+    void *reserve(uint32_t key, uint16_t version, size_t size);
+
+    /**
+     * @brief validate the pool once all entries are written
+     *
+     */
+    void commit();
+
+    /**
+     * @brief key for a subsystem name
+     *
+     * @param name
+     * @return uint32_t
+     */
+    static uint32_t keyOf(const char *name);
+
+private:
+    static const uint32_t MAGIC = 0x544f4f42; // "BOOT"
+
+    struct Header {
+        uint32_t magic;
+        uint32_t used;  ///< bytes of entries following the header
+        uint32_t crc;   ///< crc32() of the entries
+        uint32_t restores; ///< warm boots in a row, kept by clear() and commit()
+    };
+
+    struct Entry {
+        uint32_t key;
+        uint16_t version;
+        uint16_t size;  ///< of the data following, padded to 4 bytes
+    };
+
+    enum State {
+        UNKNOWN,    ///< not checked yet; the reset reason isn't known during static construction
+        WARM,
+        COLD
+    };
+
+    static bool warmReset();
+    static Header &header();
+    static uint8_t *entries();
+
+    mutable State state;
+};
+
+extern WarmBootClass WarmBoot;
@@ -0,0 +1,60 @@
+#include <Arduino.h>
+#include <chrono>
+#include <vector>
+#include "crc.h"
+
+/*
+ * crc16(), crc32() and crc32c() MB/s over a link frame, a log block and a flash sector sized
+ * buffer, next to a bitwise CRC-32. examples/CrcBenchmark is the same on target.
+ */
+
+namespace {
+
+const size_t SIZES[] = {64, 1024, 4096};
+const size_t BYTES_PER_RUN = 64 << 20;
+
+volatile uint32_t sink;
+
+uint32_t bitwiseCrc32(const uint8_t *data, size_t len, uint32_t crc) {
+    crc = ~crc;
+    for (size_t i = 0; i < len; i++) {
+        crc ^= data[i];
+        for (auto k = 0; k < 8; k++) {
+            crc = (crc >> 1) ^ (0xedb88320 & -(crc & 1));
+        }
+    }
+    return ~crc;
+}
+
+template<class Fn>
+void bench(const char *name, const std::vector<uint8_t> &buf, uint32_t init, Fn fn, size_t bytesPerRun = BYTES_PER_RUN) {
+    printf("%-8s", name);
+    for (auto size : SIZES) {
+        const auto runs = bytesPerRun / size;
+        auto crc = init;
+        const auto started = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < runs; i++) {
+            crc = fn(buf.data(), size, crc);
+        }
+        const auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+        sink = crc;
+        printf(" %5zu bytes %8.1f MB/s", size, runs * size / seconds / 1e6);
+    }
+    printf("\n");
+}
+
+}
+
+int main() {
+    std::vector<uint8_t> buf(4096);
+    for (auto &b : buf) {
+        b = static_cast<uint8_t>(esp_random());
+    }
+    bench("crc16", buf, 0xffff, [](const uint8_t *data, size_t len, uint32_t crc) -> uint32_t {
+        return crc16(data, len, crc);
+    });
+    bench("crc32", buf, 0, [](const uint8_t *data, size_t len, uint32_t crc) { return crc32(data, len, crc); });
+    bench("crc32c", buf, 0, [](const uint8_t *data, size_t len, uint32_t crc) { return crc32c(data, len, crc); });
+    bench("bitwise", buf, 0, bitwiseCrc32, BYTES_PER_RUN / 32);
+    return 0;
+}
@@ -0,0 +1,147 @@
+#include <Arduino.h>
+#include <chrono>
+#include <initializer_list>
+#include <vector>
+#include "filter.h"
+
+/*
+ * ns per frame of FirFilter and BiquadCascade on 3 channel blocks, next to a per channel,
+ * per sample filter with a wrapping delay line, and of a FilterStage fed one frame at a time
+ * versus in batches of its block size
+ */
+
+namespace {
+
+const size_t CHANNELS = 3;
+const size_t TAPS = 32;
+const size_t FRAMES = 1 << 12;
+const size_t ROUNDS = 500;
+
+typedef Samples<CHANNELS> Frame;
+
+volatile float sink;
+
+// what FirFilter replaces: a ring per channel, indices wrap in the dot product
+class NaiveFir {
+public:
+    NaiveFir(const float *coefficients) : pos() {
+        memcpy(coeffs, coefficients, sizeof(coeffs));
+        memset(delay, 0, sizeof(delay));
+    }
+
+    float __attribute__((noinline)) step(size_t c, float x) {
+        delay[c][pos[c]] = x;
+        float acc = 0;
+        for (size_t t = 0; t < TAPS; t++) {
+            acc += coeffs[t] * delay[c][(pos[c] + TAPS - t) % TAPS];
+        }
+        pos[c] = (pos[c] + 1) % TAPS;
+        return acc;
+    }
+
+private:
+    float coeffs[TAPS];
+    float delay[CHANNELS][TAPS];
+    size_t pos[CHANNELS];
+};
+
+class NaiveBiquad {
+public:
+    NaiveBiquad(const BiquadCoefficients &k) : k(k) {
+        memset(s, 0, sizeof(s));
+    }
+
+    float __attribute__((noinline)) step(size_t c, float x) {
+        const auto y = k.b0 * x + s[c][0];
+        s[c][0] = k.b1 * x - k.a1 * y + s[c][1];
+        s[c][1] = k.b2 * x - k.a2 * y;
+        return y;
+    }
+
+private:
+    BiquadCoefficients k;
+    float s[CHANNELS][2];
+};
+
+double seconds(std::chrono::steady_clock::time_point started) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+}
+
+void report(const char *name, std::chrono::steady_clock::time_point started, size_t frames) {
+    printf("%-34s %7.2f ns/frame\n", name, seconds(started) * 1e9 / frames);
+}
+
+template<class Filter>
+void blocks(const char *name, Filter &filter, std::vector<Frame> &buf, size_t block) {
+    const auto started = std::chrono::steady_clock::now();
+    for (size_t r = 0; r < ROUNDS; r++) {
+        for (size_t f = 0; f < buf.size(); f += block) {
+            filter.process(buf.data() + f, buf.data() + f, block);
+        }
+    }
+    report(name, started, ROUNDS * buf.size());
+    sink = buf.back().ch[0];
+}
+
+template<class Naive>
+void perSample(const char *name, Naive *naive, size_t stages, std::vector<Frame> &buf) {
+    const auto started = std::chrono::steady_clock::now();
+    for (size_t r = 0; r < ROUNDS; r++) {
+        for (auto &frame : buf) {
+            for (size_t c = 0; c < CHANNELS; c++) {
+                for (size_t s = 0; s < stages; s++) {
+                    frame.ch[c] = naive[s].step(c, frame.ch[c]);
+                }
+            }
+        }
+    }
+    report(name, started, ROUNDS * buf.size());
+    sink = buf.back().ch[0];
+}
+
+ReadWriteLock lock;
+HistoryDataThing<Frame, 64> raw(lock);
+const BiquadCoefficients LOWPASS[2] = {
+    {0.0674553f, 0.1349105f, 0.0674553f, -1.1429805f, 0.4128016f},
+    {0.0674553f, 0.1349105f, 0.0674553f, -1.1429805f, 0.4128016f},
+};
+FilterStage<BiquadCascade<2, CHANNELS>, CHANNELS, 32> stage(raw, LOWPASS);
+
+}
+
+int main() {
+    std::vector<Frame> buf(FRAMES);
+    for (size_t f = 0; f < FRAMES; f++) {
+        for (size_t c = 0; c < CHANNELS; c++) {
+            buf[f].ch[c] = static_cast<float>((f * 7 + c * 13) % 31) / 31 - 0.5f;
+        }
+    }
+    float taps[TAPS];
+    for (size_t t = 0; t < TAPS; t++) {
+        taps[t] = 1.0f / TAPS;
+    }
+
+    FirFilter<TAPS, CHANNELS> fir(taps);
+    blocks("FirFilter<32, 3>, blocks of 32", fir, buf, 32);
+    NaiveFir naiveFir(taps);
+    perSample("per channel ring FIR", &naiveFir, 1, buf);
+
+    BiquadCascade<2, CHANNELS> biquads(LOWPASS);
+    blocks("BiquadCascade<2, 3>, blocks of 32", biquads, buf, 32);
+    NaiveBiquad naiveBiquads[2] = {NaiveBiquad(LOWPASS[0]), NaiveBiquad(LOWPASS[1])};
+    perSample("per channel biquads", naiveBiquads, 2, buf);
+
+    // publishing costs a lock and a round of callbacks per batch
+    for (const size_t batch : {1, 32}) {
+        const auto started = std::chrono::steady_clock::now();
+        for (size_t r = 0; r < ROUNDS / 10; r++) {
+            for (size_t f = 0; f < buf.size(); f += batch) {
+                raw.publish(buf.data() + f, batch);
+            }
+        }
+        char name[40];
+        snprintf(name, sizeof(name), "FilterStage, batches of %u", static_cast<unsigned>(batch));
+        report(name, started, ROUNDS / 10 * buf.size());
+    }
+    return 0;
+}
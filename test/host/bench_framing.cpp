@@ -0,0 +1,59 @@
+#include <Arduino.h>
+#include <chrono>
+#include <vector>
+#include "framing.h"
+
+/*
+ * Encodes and parses frames of telemetry sized payloads, reporting payload MB/s of each
+ */
+
+namespace {
+
+const size_t PAYLOAD = 64;
+const size_t FRAMES = 200000;
+
+size_t payloadBytes = 0;
+
+void onFrame(const uint8_t * /*payload*/, size_t len, void * /*args*/) {
+    payloadBytes += len;
+}
+
+template<class Encoder, class Parser>
+void bench(const char *name) {
+    std::vector<uint8_t> payload(PAYLOAD);
+    for (size_t i = 0; i < PAYLOAD; i++) {
+        payload[i] = static_cast<uint8_t>(i * 37);
+    }
+    std::vector<uint8_t> stream(FRAMES * (2 * (PAYLOAD + 2) + 2));
+    size_t len = 0;
+
+    auto started = std::chrono::steady_clock::now();
+    for (size_t f = 0; f < FRAMES; f++) {
+        payload[0] = static_cast<uint8_t>(f);
+        Encoder encoder(stream.data() + len, stream.size() - len);
+        encoder.write(payload.data(), payload.size());
+        len += encoder.end();
+    }
+    const auto encodeSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+
+    payloadBytes = 0;
+    Parser parser(onFrame, nullptr);
+    started = std::chrono::steady_clock::now();
+    // in UartIngest sized blocks
+    for (size_t i = 0; i < len; i += 256) {
+        parser.consume(stream.data() + i, std::min<size_t>(256, len - i));
+    }
+    const auto parseSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+
+    const auto total = static_cast<double>(FRAMES * PAYLOAD);
+    printf("%s: encode %.1f MB/s, parse %.1f MB/s, %zu of %zu payload bytes, %u errors\n", name,
+        total / encodeSeconds / 1e6, total / parseSeconds / 1e6, payloadBytes, FRAMES * PAYLOAD, parser.errors());
+}
+
+}
+
+int main() {
+    bench<CobsEncoder, CobsFrameParser>("cobs");
+    bench<SlipEncoder, SlipFrameParser>("slip");
+    return 0;
+}
@@ -0,0 +1,74 @@
+#include <Arduino.h>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include "histogram.h"
+
+/*
+ * Times LatencyHistogram::record() alone, from two threads sharing one histogram and from two
+ * threads with one each, then merged, reporting ns per record, and percentile() on the result
+ */
+
+namespace {
+
+const size_t RECORDS = 20000000;
+
+typedef LatencyHistogram<> Histogram;
+
+// log spread values, like latencies, so all bucket ranges are hit
+std::vector<uint32_t> values() {
+    std::vector<uint32_t> v(4096);
+    uint32_t x = 1;
+    for (auto &value : v) {
+        x = x * 1664525 + 1013904223;
+        value = (x >> 8) >> (x % 24);
+    }
+    return v;
+}
+
+void record(Histogram &h, const std::vector<uint32_t> &v, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        h.record(v[i & (v.size() - 1)]);
+    }
+}
+
+double seconds(std::chrono::steady_clock::time_point started) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+}
+
+}
+
+int main() {
+    const auto v = values();
+
+    Histogram single;
+    auto started = std::chrono::steady_clock::now();
+    record(single, v, RECORDS);
+    printf("record, one thread:          %.2f ns\n", seconds(started) * 1e9 / RECORDS);
+
+    // the cache line ping pong of concurrent callers, e.g. tasks on both cores
+    Histogram shared;
+    started = std::chrono::steady_clock::now();
+    std::thread other([&]() { record(shared, v, RECORDS / 2); });
+    record(shared, v, RECORDS / 2);
+    other.join();
+    printf("record, two threads, shared: %.2f ns\n", seconds(started) * 1e9 / RECORDS);
+
+    Histogram perThread[2];
+    started = std::chrono::steady_clock::now();
+    std::thread second([&]() { record(perThread[1], v, RECORDS / 2); });
+    record(perThread[0], v, RECORDS / 2);
+    second.join();
+    perThread[0].merge(perThread[1]);
+    printf("record, two threads, merged: %.2f ns\n", seconds(started) * 1e9 / RECORDS);
+
+    const auto rounds = 100000;
+    uint32_t sink = 0;
+    started = std::chrono::steady_clock::now();
+    for (auto i = 0; i < rounds; i++) {
+        sink += perThread[0].percentile(990 + i % 10);
+    }
+    printf("percentile:                  %.1f ns (%u buckets, p99 %u, max %u)\n", seconds(started) * 1e9 / rounds,
+        (unsigned)Histogram::NUM_BUCKETS, (unsigned)perThread[0].percentile(990), (unsigned)perThread[0].max());
+    return sink == 0;
+}
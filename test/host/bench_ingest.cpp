@@ -0,0 +1,75 @@
+#include <Arduino.h>
+#include <chrono>
+#include <string>
+#include <unistd.h>
+#include "uartingest.h"
+
+/*
+ * Reads a file of UBX messages through Serial1 and UartIngest as fast as the host allows,
+ * reporting MB/s. The UART ring is the ESP32 driver's size, so the reader thread and the
+ * ingest task hand over blocks like the driver's ISR and task do.
+ */
+
+namespace {
+
+const size_t PAYLOAD = 92; // NAV-PVT
+const size_t MESSAGES = 200000;
+
+uint32_t messages = 0;
+
+void onMessage(uint8_t /*msgClass*/, uint8_t /*msgId*/, const uint8_t * /*payload*/, size_t len, void * /*args*/) {
+    if (len == PAYLOAD) {
+        messages++;
+    }
+}
+
+UbxParser ubx(onMessage, nullptr);
+StreamParser *parsers[] = {&ubx, nullptr};
+UartIngest ingest("ingest", Serial1, parsers);
+
+std::string writeMessages() {
+    char path[] = "/tmp/bench_ingest_XXXXXX";
+    const auto fd = mkstemp(path);
+    auto f = fdopen(fd, "wb");
+    uint8_t msg[PAYLOAD + 8] = {0xb5, 0x62, 0x01, 0x07, PAYLOAD & 0xff, PAYLOAD >> 8};
+    for (size_t m = 0; m < MESSAGES; m++) {
+        for (size_t i = 0; i < PAYLOAD; i++) {
+            msg[6 + i] = static_cast<uint8_t>(m + i);
+        }
+        uint8_t a = 0, b = 0;
+        for (size_t i = 2; i < 6 + PAYLOAD; i++) {
+            a += msg[i];
+            b += a;
+        }
+        msg[6 + PAYLOAD] = a;
+        msg[7 + PAYLOAD] = b;
+        fwrite(msg, sizeof(msg), 1, f);
+    }
+    fclose(f);
+    return path;
+}
+
+}
+
+int main() {
+    const auto path = writeMessages();
+    const auto bytes = MESSAGES * (PAYLOAD + 8);
+
+    Serial1.setRxBufferSize(256);
+    SubsystemManager.setup();
+    SubsystemManager.start();
+    delay(200); // for the task's start delay
+    const auto started = std::chrono::steady_clock::now();
+    if (!Serial1.open(path.c_str())) {
+        return 1;
+    }
+    while (ingest.bytesReceived() < bytes) {
+        delay(1);
+    }
+    const auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    unlink(path.c_str());
+
+    printf("ingest: %zu bytes, %u of %zu messages, %u errors in %.3f s: %.1f MB/s\n",
+        bytes, messages, MESSAGES, ubx.errors(), seconds, bytes / seconds / 1e6);
+    return messages == MESSAGES ? 0 : 1;
+}
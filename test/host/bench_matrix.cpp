@@ -0,0 +1,83 @@
+#include <Arduino.h>
+#include <chrono>
+#include "matrix.h"
+
+/*
+ * The matrix.h kernels at state sizes typical of attitude and navigation filters, in ns per
+ * call, next to a plain dot product multiply. examples/MatrixBenchmark is the same on target.
+ */
+
+namespace {
+
+const uint32_t RUNS = 200000;
+
+volatile float sink;
+
+template<size_t N>
+void __attribute__((noinline)) naiveMultiply(const Matrix<N, N> &a, const Matrix<N, N> &b, Matrix<N, N> &out) {
+    for (size_t r = 0; r < N; r++) {
+        for (size_t c = 0; c < N; c++) {
+            float sum = 0;
+            for (size_t k = 0; k < N; k++) {
+                sum += a.m[r][k] * b.m[k][c];
+            }
+            out.m[r][c] = sum;
+        }
+    }
+}
+
+template<class Fn>
+void measure(const char *name, size_t n, Fn fn) {
+    const auto started = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < RUNS; i++) {
+        fn();
+    }
+    const auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    printf("%-10s %2u: %9.1f ns\n", name, static_cast<unsigned>(n), seconds * 1e9 / RUNS);
+}
+
+template<size_t N>
+void bench() {
+    // a well conditioned symmetric positive definite p, f close to identity as in a filter
+    static Matrix<N, N> a, b, out, p, f, q, scratch, l;
+    static Vector<N> rhs, x;
+    for (size_t r = 0; r < N; r++) {
+        for (size_t c = 0; c < N; c++) {
+            a.m[r][c] = static_cast<float>(esp_random() % 1000) / 1000;
+            b.m[r][c] = static_cast<float>(esp_random() % 1000) / 1000;
+            f.m[r][c] = r == c ? 1 : 0.01f * a.m[r][c];
+            q.m[r][c] = r == c ? 1e-4f : 0;
+            p.m[r][c] = r == c ? N : 1.0f / (1 + r + c);
+        }
+        rhs[r] = b.m[r][0];
+    }
+    const auto p0 = p;
+
+    measure("multiply", N, [&]() { multiply(a, b, out); });
+    sink = out.m[N - 1][N - 1];
+    measure("naive", N, [&]() { naiveMultiply(a, b, out); });
+    sink = out.m[N - 1][N - 1];
+    measure("covariance", N, [&]() {
+        p = p0;
+        propagateCovariance(p, f, q, scratch);
+    });
+    sink = p.m[N - 1][N - 1];
+    measure("cholesky", N, [&]() {
+        if (cholesky(p0, l)) {
+            choleskySolve(l, rhs, x);
+        }
+    });
+    sink = x[N - 1];
+    measure("invert", N, [&]() { invert(p0, out, scratch); });
+    sink = out.m[N - 1][N - 1];
+}
+
+}
+
+int main() {
+    bench<3>();
+    bench<6>();
+    bench<9>();
+    bench<15>();
+    return 0;
+}
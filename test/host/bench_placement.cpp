@@ -0,0 +1,220 @@
+#include <Arduino.h>
+#include <chrono>
+#include <vector>
+#include "history.h"
+#include "placement.h"
+
+/*
+ * Times a control cycle with its state and history in each combination of internal RAM and
+ * PSRAM, and simulates the ESP32 PSRAM cache the host doesn't have: a cycle publishes a batch
+ * of IMU samples, reads the state estimate a few times and every 10th cycle the logger copies
+ * what arrived since, or, when dumping, the whole history. Values count cache misses as they
+ * are copied, misses are charged at MISS_NS each and added to the host time
+ */
+
+namespace {
+
+// ESP32: PSRAM is reached through a 32 KiB data cache with 32 byte lines and no prefetch
+const size_t LINE = 32;
+const size_t CACHE_LINES = 32 * 1024 / LINE;
+// a line over quad SPI at 80 MHz: command, address and wait cycles, then 64 nibbles
+const double MISS_NS = 1000;
+
+const size_t CYCLES = 20000;
+const size_t BATCH = 8;
+const size_t HISTORY = 2048;
+const size_t STATE_READS = 4;
+const size_t LOG_EVERY = 10;
+
+// a direct mapped cache in front of the ranges mapped as PSRAM
+class SimulatedCache {
+public:
+    SimulatedCache() : enabled(false), misses(0), tags(CACHE_LINES, 0) {}
+
+    void map(const void *p, size_t size) {
+        const auto begin = reinterpret_cast<uintptr_t>(p);
+        ranges.push_back({begin, begin + size});
+    }
+
+    void unmap(const void *p) {
+        const auto begin = reinterpret_cast<uintptr_t>(p);
+        for (auto r = ranges.begin(); r != ranges.end(); r++) {
+            if (r->begin == begin) {
+                ranges.erase(r);
+                return;
+            }
+        }
+    }
+
+    void touch(const void *p, size_t size) {
+        if (!enabled) {
+            return;
+        }
+        const auto begin = reinterpret_cast<uintptr_t>(p);
+        bool mapped = false;
+        for (const auto &r : ranges) {
+            mapped |= begin >= r.begin && begin < r.end;
+        }
+        if (!mapped) {
+            return;
+        }
+        for (auto line = begin / LINE; line <= (begin + size - 1) / LINE; line++) {
+            // tags hold line + 1, 0 is empty
+            auto &tag = tags[line % CACHE_LINES];
+            if (tag != line + 1) {
+                tag = line + 1;
+                misses++;
+            }
+        }
+    }
+
+    void flush() {
+        std::fill(tags.begin(), tags.end(), 0);
+    }
+
+    bool enabled;
+    uint64_t misses;
+
+private:
+    struct Range {
+        uintptr_t begin;
+        uintptr_t end;
+    };
+
+    std::vector<uintptr_t> tags;
+    std::vector<Range> ranges;
+};
+
+SimulatedCache cache;
+
+// PsramPlacement, with its storage mapped behind the simulated cache
+struct SimulatedPsramPlacement {
+    template<class T, size_t N>
+    class Storage : public PsramPlacement::Storage<T, N> {
+    public:
+        Storage() {
+            cache.map(this->get(), sizeof(T) * N);
+        }
+
+        ~Storage() {
+            cache.unmap(this->get());
+        }
+    };
+};
+
+// a value that tells the cache whenever it is copied, to or from
+template<class T>
+struct Tracked {
+    Tracked() : value() {}
+
+    Tracked(const Tracked &other) : value(other.value) {
+        cache.touch(&other, sizeof(Tracked));
+    }
+
+    Tracked &operator=(const Tracked &other) {
+        cache.touch(&other, sizeof(Tracked));
+        cache.touch(this, sizeof(Tracked));
+        value = other.value;
+        return *this;
+    }
+
+    T value;
+};
+
+struct Imu {
+    float accel[3];
+    float gyro[3];
+    uint32_t micros;
+    uint32_t flags;
+};
+
+struct Estimate {
+    float attitude[4];
+    float rates[3];
+    float position[3];
+    float velocity[3];
+    float covariance[12];
+    uint32_t micros;
+};
+
+typedef Tracked<Imu> Sample;
+typedef Tracked<Estimate> State;
+
+double seconds(std::chrono::steady_clock::time_point started) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+}
+
+template<class StatePlacement, class HistoryPlacement>
+void run(const char *name) {
+    ReadWriteLock lock;
+    auto state = new DataThing<State, StatePlacement>(lock);
+    auto history = new HistoryDataThing<Sample, HISTORY, HistoryPlacement>(lock);
+    std::vector<Sample> batch(BATCH);
+    std::vector<Sample> logged(HISTORY);
+    float sink = 0;
+    bool dump = false;
+
+    auto cycles = [&](size_t n) {
+        for (size_t c = 0; c < n; c++) {
+            for (size_t i = 0; i < BATCH; i++) {
+                batch[i].value.micros = c * BATCH + i;
+            }
+            history->publish(batch.data(), BATCH);
+            // estimator, controller, mixer and telemetry each take a copy
+            for (size_t r = 0; r < STATE_READS; r++) {
+                state->readData([](const State &data, void *args) {
+                    const State copy = data;
+                    *static_cast<float*>(args) += copy.value.attitude[0];
+                }, &sink);
+            }
+            uint32_t now = c;
+            state->accessData([](State &data, void *args) {
+                State next = data;
+                next.value.micros = *static_cast<uint32_t*>(args);
+                data = next;
+            }, &now);
+            // what arrived since the logger last ran, or the whole history
+            if (c % LOG_EVERY == 0) {
+                history->readHistory(logged.data(), dump ? HISTORY : BATCH * LOG_EVERY);
+            }
+        }
+    };
+
+    // host ns and simulated misses per cycle
+    auto measure = [&](size_t n, double &hostNs, double &misses) {
+        auto started = std::chrono::steady_clock::now();
+        cycles(n);
+        hostNs = seconds(started) * 1e9 / n;
+        cache.misses = 0;
+        cache.enabled = true;
+        cycles(n);
+        cache.enabled = false;
+        misses = static_cast<double>(cache.misses) / n;
+    };
+
+    cycles(HISTORY);
+    double hostNs, misses, dumpHostNs, dumpMisses;
+    measure(CYCLES, hostNs, misses);
+    dump = true;
+    measure(CYCLES / 10, dumpHostNs, dumpMisses);
+
+    printf("%-26s %6.1f + %5.1f misses = %8.1f ns per cycle, dumping %7.1f + %5.1f misses = %8.1f ns\n", name,
+        hostNs, misses, hostNs + misses * MISS_NS, dumpHostNs, dumpMisses, dumpHostNs + dumpMisses * MISS_NS);
+    delete history;
+    delete state;
+    if (sink != 0) {
+        printf("unexpected state\n");
+    }
+}
+
+}
+
+int main() {
+    printf("state %u bytes, history %u x %u bytes, %.0f ns per miss\n", (unsigned)sizeof(State),
+        (unsigned)HISTORY, (unsigned)sizeof(Sample), MISS_NS);
+    run<InternalPlacement, InternalPlacement>("internal state and history");
+    run<InternalPlacement, SimulatedPsramPlacement>("internal state, PSRAM hist");
+    run<SimulatedPsramPlacement, InternalPlacement>("PSRAM state, internal hist");
+    run<SimulatedPsramPlacement, SimulatedPsramPlacement>("PSRAM state and history");
+    return 0;
+}
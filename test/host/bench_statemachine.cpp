@@ -0,0 +1,185 @@
+#include <Arduino.h>
+#include <chrono>
+#include <vector>
+#include "statemachine.h"
+
+/*
+ * Dispatches a random event stream through a flight TransitionTable, looked up directly and
+ * through StateMachine's queue and tick(), and through the hand-written switch it replaces,
+ * reporting ns per event. On the host the queue and lock of the shim, mutexes and condition
+ * variables, dominate post + tick; the lookups compare with the switch everywhere.
+ */
+
+namespace {
+
+enum class Phase { PAD, BOOST, COAST, DESCENT, LANDED, COUNT };
+enum class Input { LAUNCH, BURNOUT, APOGEE, TOUCHDOWN, COUNT };
+
+struct Flight {
+    bool armed;
+    float altitude;
+    float maxAltitude;
+    uint32_t deploys;
+};
+
+bool armed(const Flight &f) {
+    return f.armed;
+}
+
+bool descending(const Flight &f) {
+    return f.altitude < f.maxAltitude - 5.0f;
+}
+
+void deploy(Flight &f) {
+    f.deploys++;
+}
+
+typedef StateMachine<Flight, Phase, Input, 7> FlightMachine;
+
+// LANDED goes back to PAD, so the stream keeps cycling
+constexpr FlightMachine::Rule rules[] = {
+    {Phase::PAD, Input::LAUNCH, Phase::BOOST, armed, nullptr},
+    {Phase::BOOST, Input::BURNOUT, Phase::COAST, nullptr, nullptr},
+    {Phase::BOOST, Input::APOGEE, Phase::DESCENT, nullptr, deploy},
+    {Phase::COAST, Input::APOGEE, Phase::DESCENT, descending, deploy},
+    {Phase::COAST, Input::APOGEE, Phase::COAST, nullptr, nullptr},
+    {Phase::DESCENT, Input::TOUCHDOWN, Phase::LANDED, nullptr, nullptr},
+    {Phase::LANDED, Input::LAUNCH, Phase::PAD, nullptr, nullptr},
+};
+
+constexpr auto table = makeTransitionTable(rules);
+
+Phase __attribute__((noinline)) viaSwitch(Phase state, Input event, Flight &f) {
+    switch (state) {
+    case Phase::PAD:
+        if (event == Input::LAUNCH && armed(f)) {
+            return Phase::BOOST;
+        }
+        break;
+    case Phase::BOOST:
+        if (event == Input::BURNOUT) {
+            return Phase::COAST;
+        }
+        if (event == Input::APOGEE) {
+            deploy(f);
+            return Phase::DESCENT;
+        }
+        break;
+    case Phase::COAST:
+        if (event == Input::APOGEE) {
+            if (descending(f)) {
+                deploy(f);
+                return Phase::DESCENT;
+            }
+            return Phase::COAST;
+        }
+        break;
+    case Phase::DESCENT:
+        if (event == Input::TOUCHDOWN) {
+            return Phase::LANDED;
+        }
+        break;
+    case Phase::LANDED:
+        if (event == Input::LAUNCH) {
+            return Phase::PAD;
+        }
+        break;
+    default:
+        break;
+    }
+    return state;
+}
+
+Phase __attribute__((noinline)) viaTable(Phase state, Input event, Flight &f) {
+    const auto rule = table.find(state, event, f);
+    if (rule == nullptr) {
+        return state;
+    }
+    if (rule->action) {
+        rule->action(f);
+    }
+    return rule->to;
+}
+
+const size_t EVENTS = 1 << 16;
+const size_t ROUNDS = 200;
+
+std::vector<Input> events() {
+    std::vector<Input> v(EVENTS);
+    uint32_t x = 1;
+    for (auto &e : v) {
+        x = x * 1664525 + 1013904223;
+        e = static_cast<Input>((x >> 16) % static_cast<uint32_t>(Input::COUNT));
+    }
+    return v;
+}
+
+double seconds(std::chrono::steady_clock::time_point started) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+}
+
+template<class Step>
+uint32_t run(const char *name, const std::vector<Input> &v, Step step) {
+    Flight f = {true, 90.0f, 100.0f, 0};
+    auto state = Phase::PAD;
+    uint32_t transitions = 0;
+    const auto started = std::chrono::steady_clock::now();
+    for (size_t r = 0; r < ROUNDS; r++) {
+        for (auto e : v) {
+            const auto next = step(state, e, f);
+            transitions += next != state;
+            state = next;
+        }
+    }
+    printf("%-28s %6.2f ns/event (%u transitions, %u deploys)\n", name, seconds(started) * 1e9 / (ROUNDS * EVENTS),
+        static_cast<unsigned>(transitions), static_cast<unsigned>(f.deploys));
+    return transitions;
+}
+
+FlightMachine machine("flight", table, Phase::PAD);
+Flight initial = {true, 90.0f, 100.0f, 0};
+
+Input setContext(const Flight &value, Flight &f) {
+    f = value;
+    return Input::COUNT;
+}
+
+}
+
+int main() {
+    const auto v = events();
+    const auto bySwitch = run("switch", v, viaSwitch);
+    const auto byTable = run("TransitionTable::find", v, viaTable);
+    if (bySwitch != byTable) {
+        printf("the table and the switch disagree\n");
+        return 1;
+    }
+
+    ReadWriteLock lock;
+    DataThing<Flight> flight(lock);
+    machine.setup();
+    machine.watch(flight, setContext);
+    flight.accessData([](Flight &data, void */*args*/) {
+        data = initial;
+    }, nullptr);
+    machine.tick();
+
+    // posted in batches of the queue length, dispatched on tick()
+    const auto rounds = ROUNDS / 10;
+    const auto started = std::chrono::steady_clock::now();
+    for (size_t r = 0; r < rounds; r++) {
+        for (size_t i = 0; i < EVENTS; i += 16) {
+            for (size_t j = 0; j < 16; j++) {
+                machine.post(v[i + j]);
+            }
+            machine.tick();
+        }
+    }
+    MachineState<Phase> state;
+    machine.readData([](const MachineState<Phase> &data, void *args) {
+        *static_cast<MachineState<Phase>*>(args) = data;
+    }, &state);
+    printf("%-28s %6.2f ns/event (%u transitions)\n", "StateMachine post + tick", seconds(started) * 1e9 / (rounds * EVENTS),
+        static_cast<unsigned>(state.transitions));
+    return 0;
+}
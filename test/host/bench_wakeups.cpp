@@ -0,0 +1,132 @@
+#include <Arduino.h>
+#include <algorithm>
+#include <atomic>
+#include <initializer_list>
+#include <chrono>
+#include <thread>
+#include <time.h>
+#include "histogram.h"
+#include "metrics.h"
+#include "subsystem.h"
+
+/*
+ * The host counterpart of examples/IdleWakeups: three periodic subsystems run alternately
+ * without and with wakeSlack(), while a thread polling every 200 us stands in for the idle hook.
+ * Reports per phase the task wakeups/s, the distinct ticks the CPU would wake at, how many
+ * ticks tickless idle could sleep from each idle tick, and the CPU time the tasks used.
+ * Host thread wakeups cost far more than on the target, so only the ratios mean anything.
+ */
+
+namespace {
+
+const TickType_t SLACK = pdMS_TO_TICKS(5);
+const uint32_t PHASE_MS = 3000;
+
+volatile TickType_t slack = 0;
+
+class Periodic : public ThreadedSubsystem {
+public:
+    Periodic(const char *name, TickType_t period) : period(period) {
+        this->name = name;
+    }
+
+    Status setup() override {
+        setStatus(READY);
+        return READY;
+    }
+
+protected:
+    TickType_t wakeSlack() const override {
+        return slack;
+    }
+
+    void taskFunction(void */*parameter*/) override {
+        for (;;) {
+            // stand in for reading a sensor
+            delayMicroseconds(200);
+            waitForNextCycle(period);
+        }
+    }
+
+private:
+    const TickType_t period;
+};
+
+Periodic imu("imu", pdMS_TO_TICKS(20));
+Periodic baro("baro", pdMS_TO_TICKS(30));
+Periodic mag("mag", pdMS_TO_TICKS(50));
+
+std::atomic<bool> polling(true);
+std::atomic<uint32_t> cpuWakeups(0);
+std::atomic<uint64_t> pollerNanos(0);
+LatencyHistogram<> sleepable;
+
+uint64_t cpuNanos(clockid_t clock) {
+    timespec ts;
+    clock_gettime(clock, &ts);
+    return ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+// what the idle hook of the example does, once per tick
+void poll() {
+    TickType_t lastTick = 0;
+    TickType_t earliestWake = 0;
+    while (polling) {
+        std::this_thread::sleep_for(std::chrono::microseconds(200));
+        pollerNanos = cpuNanos(CLOCK_THREAD_CPUTIME_ID);
+        const auto now = xTaskGetTickCount();
+        if (now == lastTick) {
+            continue;
+        }
+        lastTick = now;
+        const auto next = ThreadedSubsystem::nextWakeTick();
+        if (next == portMAX_DELAY) {
+            continue;
+        }
+        sleepable.record(next);
+        const auto wake = now + next;
+        if (static_cast<int32_t>(wake - earliestWake) > 0) {
+            cpuWakeups++;
+        }
+        earliestWake = wake;
+    }
+}
+
+}
+
+int main() {
+    const auto wakeups = static_cast<Counter*>(Metrics.find("subsystem.wakeups"));
+    const auto sharedWakeups = static_cast<Counter*>(Metrics.find("subsystem.wakeups.shared"));
+    for (auto s : {static_cast<ThreadedSubsystem*>(&imu), static_cast<ThreadedSubsystem*>(&baro),
+            static_cast<ThreadedSubsystem*>(&mag)}) {
+        s->setup();
+        s->start();
+    }
+    std::thread poller(poll);
+    delay(200);
+
+    for (auto phase = 0; phase < 4; phase++) {
+        const auto startWakeups = wakeups->value();
+        const auto startShared = sharedWakeups->value();
+        const auto startCpuWakeups = cpuWakeups.load();
+        const auto startCpu = cpuNanos(CLOCK_PROCESS_CPUTIME_ID) - pollerNanos;
+        sleepable.reset();
+
+        delay(PHASE_MS);
+
+        const auto taskWakeups = wakeups->value() - startWakeups;
+        const auto cpu = cpuNanos(CLOCK_PROCESS_CPUTIME_ID) - pollerNanos - startCpu;
+        printf("slack %u: %5.1f task wakeups/s (%4.1f%% shared), %5.1f CPU wakeups/s, %4.2f%% CPU, "
+            "sleepable p50 %u p90 %u ticks\n",
+            static_cast<unsigned>(slack),
+            taskWakeups * 1000.0 / PHASE_MS,
+            100.0 * (sharedWakeups->value() - startShared) / std::max<uint32_t>(1, taskWakeups),
+            (cpuWakeups - startCpuWakeups) * 1000.0 / PHASE_MS,
+            100.0 * cpu / (PHASE_MS * 1e6),
+            static_cast<unsigned>(sleepable.percentile(500)), static_cast<unsigned>(sleepable.percentile(900)));
+        slack = slack ? 0 : SLACK;
+    }
+    polling = false;
+    poller.join();
+    return 0;
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/*
+ * CHECK(condition) and CHECK_EQ(a, b) report the failure and exit, so a test is a main()
+ * calling them
+ */
+
+#define CHECK(condition) do { \
+    if (!(condition)) { \
+        fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+        exit(1); \
+    } \
+} while (0)
+
+#define CHECK_EQ(a, b) do { \
+    const auto a_ = (a); \
+    const auto b_ = (b); \
+    if (!(a_ == b_)) { \
+        fprintf(stderr, "%s:%d: CHECK_EQ(%s, %s) failed: %lld != %lld\n", __FILE__, __LINE__, #a, #b, \
+            static_cast<long long>(a_), static_cast<long long>(b_)); \
+        exit(1); \
+    } \
+} while (0)
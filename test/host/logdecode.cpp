@@ -0,0 +1,42 @@
+#include <Arduino.h>
+#include <unistd.h>
+#include "logger.h"
+
+/*
+ * Decodes the BINARY output of LoggerClass to text:
+ *
+ *    build/logdecode [-t] [file]
+ *
+ * reads the file, a capture of the UART or a log file copied off flash, or stdin. -t prefixes
+ * every message with its micros() timestamp.
+ */
+
+int main(int argc, char **argv) {
+    auto timestamps = false;
+    int opt;
+    while ((opt = getopt(argc, argv, "t")) != -1) {
+        if (opt != 't') {
+            fprintf(stderr, "usage: %s [-t] [file]\n", argv[0]);
+            return 2;
+        }
+        timestamps = true;
+    }
+    auto in = stdin;
+    if (optind < argc) {
+        in = fopen(argv[optind], "rb");
+        if (in == nullptr) {
+            perror(argv[optind]);
+            return 1;
+        }
+    }
+    LogDecoder decoder(Serial, timestamps);
+    uint8_t buf[4096];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), in)) > 0) {
+        decoder.consume(buf, n);
+    }
+    if (decoder.errors()) {
+        fprintf(stderr, "%u bad frames\n", (unsigned)decoder.errors());
+    }
+    return 0;
+}
@@ -0,0 +1,229 @@
+#pragma once
+
+/*
+ * Host shim of the parts of Arduino-ESP32 and FreeRTOS the library uses, so it builds and
+ * runs on Linux and macOS for tests and benchmarks. Tasks are threads, semaphores, queues
+ * and notifications are built on std::mutex and std::condition_variable, and there is a
+ * single core. Host only additions are prefixed with host.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <math.h>
+#include <algorithm>
+#include <functional>
+
+typedef uint8_t StackType_t;
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned UBaseType_t;
+
+// the host objects are allocated separately, the static buffers are unused
+struct StaticTask_t { void *unused; };
+struct StaticSemaphore_t { void *unused; };
+struct StaticQueue_t { void *unused; };
+
+struct tskTaskControlBlock;
+typedef tskTaskControlBlock *TaskHandle_t;
+struct QueueDefinition;
+typedef QueueDefinition *SemaphoreHandle_t;
+typedef QueueDefinition *QueueHandle_t;
+
+#define portMAX_DELAY 0xffffffffUL
+#define configTICK_RATE_HZ 1000
+#define portTICK_PERIOD_MS 1
+#define pdMS_TO_TICKS(x) ((TickType_t)(x))
+#define pdTRUE 1
+#define pdFALSE 0
+#define pdPASS 1
+#define pdFAIL 0
+#define tskIDLE_PRIORITY 0
+#define portNUM_PROCESSORS 1
+#define configMAX_TASK_NAME_LEN 16
+#define configTASK_NOTIFICATION_ARRAY_ENTRIES 3
+#define tskNO_AFFINITY 0x7fffffff
+#define IRAM_ATTR
+#define RTC_NOINIT_ATTR
+
+SemaphoreHandle_t xSemaphoreCreateCountingStatic(UBaseType_t maxCount, UBaseType_t initialCount, StaticSemaphore_t *buffer);
+SemaphoreHandle_t xSemaphoreCreateMutexStatic(StaticSemaphore_t *buffer);
+SemaphoreHandle_t xSemaphoreCreateBinaryStatic(StaticSemaphore_t *buffer);
+BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t ticks);
+BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore);
+BaseType_t xSemaphoreGiveFromISR(SemaphoreHandle_t semaphore, BaseType_t *woken);
+
+QueueHandle_t xQueueCreateStatic(UBaseType_t length, UBaseType_t itemSize, uint8_t *storage, StaticQueue_t *buffer);
+BaseType_t xQueueSend(QueueHandle_t queue, const void *item, TickType_t ticks);
+BaseType_t xQueueSendToBack(QueueHandle_t queue, const void *item, TickType_t ticks);
+BaseType_t xQueueSendFromISR(QueueHandle_t queue, const void *item, BaseType_t *woken);
+BaseType_t xQueueReceive(QueueHandle_t queue, void *item, TickType_t ticks);
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue);
+
+TaskHandle_t xTaskCreateStaticPinnedToCore(void (*fn)(void*), const char *name, uint32_t stackDepth, void *parameter,
+    UBaseType_t priority, StackType_t *stack, StaticTask_t *buffer, BaseType_t core);
+void vTaskDelay(TickType_t ticks);
+BaseType_t xTaskDelayUntil(TickType_t *previous, TickType_t increment);
+void vTaskDelayUntil(TickType_t *previous, TickType_t increment);
+TickType_t xTaskGetTickCount();
+TickType_t xTaskGetTickCountFromISR();
+// task threads run on a painted stack of their depth plus host slack, not on the stack passed in,
+// so the high water mark follows what they use but stack canaries are never hit
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task);
+TaskHandle_t xTaskGetCurrentTaskHandle();
+TaskHandle_t xTaskGetCurrentTaskHandleForCPU(BaseType_t core);
+void vTaskSuspend(TaskHandle_t task);
+void vTaskResume(TaskHandle_t task);
+void vTaskSetThreadLocalStoragePointer(TaskHandle_t task, BaseType_t index, void *value);
+void *pvTaskGetThreadLocalStoragePointer(TaskHandle_t task, BaseType_t index);
+const char *pcTaskGetName(TaskHandle_t task);
+BaseType_t xTaskNotifyGive(TaskHandle_t task);
+BaseType_t xTaskNotifyGiveIndexed(TaskHandle_t task, UBaseType_t index);
+void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t *woken);
+uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t ticks);
+uint32_t ulTaskNotifyTakeIndexed(UBaseType_t index, BaseType_t clear, TickType_t ticks);
+#define portYIELD_FROM_ISR(...)
+BaseType_t xPortGetCoreID();
+BaseType_t xPortInIsrContext();
+
+typedef struct { int unused; } portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED {0}
+void portENTER_CRITICAL(portMUX_TYPE *mux);
+void portEXIT_CRITICAL(portMUX_TYPE *mux);
+#define portENTER_CRITICAL_ISR portENTER_CRITICAL
+#define portEXIT_CRITICAL_ISR portEXIT_CRITICAL
+
+uint32_t esp_random();
+// a nominal 1 GHz clock: cycle counts are nanoseconds and getCpuFrequencyMhz() is 1000
+uint32_t esp_cpu_get_cycle_count();
+uint32_t getCpuFrequencyMhz();
+unsigned long micros();
+unsigned long millis();
+void delay(uint32_t ms);
+void delayMicroseconds(uint32_t us);
+
+// as in Arduino-ESP32, min() and max() are the std templates, not macros
+using std::min;
+using std::max;
+
+#define LOW 0
+#define HIGH 1
+#define INPUT 0
+#define OUTPUT 1
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t value);
+
+/**
+ * @brief host only: the mode last set with pinMode(), -1 if never
+ *
+ * @param pin
+ */
+int hostPinMode(uint8_t pin);
+
+/**
+ * @brief host only: the level last written with digitalWrite(), -1 if never
+ *
+ * @param pin
+ */
+int hostPinLevel(uint8_t pin);
+
+/**
+ * @brief freeze micros() and millis() at a value until hostClockRun(), e.g. for tests
+ *
+ * @param micros
+ */
+void hostClockSet(uint32_t micros);
+
+/**
+ * @brief let micros() and millis() follow the monotonic clock again
+ *
+ */
+void hostClockRun();
+
+class Print {
+public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t c) = 0;
+    virtual size_t write(const uint8_t *buf, size_t len);
+    size_t write(const char *s) { return write(reinterpret_cast<const uint8_t*>(s), strlen(s)); }
+    size_t print(const char *s);
+    size_t print(char c);
+    size_t print(int n);
+    size_t print(unsigned n);
+    size_t print(long n);
+    size_t print(unsigned long n);
+    size_t print(double n, int digits = 2);
+    size_t println(const char *s);
+    size_t println();
+    size_t printf(const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+};
+
+class Stream : public Print {
+public:
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual int peek() = 0;
+    virtual void flush() {}
+    size_t readBytes(uint8_t *buf, size_t len);
+};
+
+/**
+ * @brief a UART. Writes go to a file descriptor, stdout for Serial. open() a pty, file or socket to
+ * receive: like the ESP32 driver, a thread moves its bytes into a ring of setRxBufferSize()
+ * and calls onReceive(), waiting while the ring is full
+ */
+class HardwareSerial : public Stream {
+public:
+    HardwareSerial(int fd = -1);
+    ~HardwareSerial();
+
+    void begin(unsigned long /*baud*/) {}
+    void end();
+
+    /**
+     * @brief host only: receive from a file, pty or fifo
+     *
+     * @param path
+     * @return false if it can't be opened
+     */
+    bool open(const char *path);
+
+    /**
+     * @brief host only: receive from and write to a file descriptor, e.g. one end of a socketpair()
+     *
+     * @param fd
+     * @return false if fd is invalid
+     */
+    bool open(int fd);
+
+    /**
+     * @brief host only: true once open()ed input is exhausted and all of it was read
+     *
+     */
+    bool drained();
+
+    size_t write(uint8_t c) override;
+    size_t write(const uint8_t *buf, size_t len) override;
+    using Print::write;
+    int available() override;
+    int read() override;
+    int peek() override;
+    size_t read(uint8_t *buf, size_t len);
+    int availableForWrite();
+    size_t setRxBufferSize(size_t size);
+    void onReceive(std::function<void(void)> fn, bool onlyOnTimeout = false);
+
+private:
+    struct Receiver;
+
+    int fd;
+    Receiver *receiver;
+    size_t rxBufferSize;
+};
+
+extern HardwareSerial Serial;
+extern HardwareSerial Serial1;
+extern HardwareSerial Serial2;
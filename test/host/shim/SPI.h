@@ -0,0 +1,29 @@
+#pragma once
+
+#include <Arduino.h>
+
+#define MSBFIRST 1
+#define SPI_MODE0 0
+
+struct SPISettings {
+    SPISettings() {}
+    SPISettings(uint32_t /*clock*/, uint8_t /*bitOrder*/, uint8_t /*mode*/) {}
+};
+
+/**
+ * @brief an SPI bus with no devices: reads return 0xff. Use MockBus to simulate devices
+ *
+ */
+class SPIClass {
+public:
+    void begin() {}
+    void beginTransaction(SPISettings /*settings*/) {}
+    void endTransaction() {}
+    void transferBytes(const uint8_t */*tx*/, uint8_t *rx, uint32_t len) {
+        if (rx) {
+            memset(rx, 0xff, len);
+        }
+    }
+};
+
+extern SPIClass SPI;
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <Arduino.h>
+
+/**
+ * @brief an I2C bus with no devices: every transmission is NACKed. Use MockBus to simulate devices
+ *
+ */
+class TwoWire : public Stream {
+public:
+    bool begin() { return true; }
+    void beginTransmission(uint8_t /*address*/) {}
+    uint8_t endTransmission(bool /*stop*/ = true) { return 2; }
+    size_t requestFrom(uint8_t /*address*/, size_t /*len*/, bool /*stop*/ = true) { return 0; }
+    size_t write(uint8_t /*c*/) override { return 1; }
+    size_t write(const uint8_t */*buf*/, size_t len) override { return len; }
+    int available() override { return 0; }
+    int read() override { return -1; }
+    int peek() override { return -1; }
+};
+
+extern TwoWire Wire;
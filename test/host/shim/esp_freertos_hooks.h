@@ -0,0 +1,25 @@
+#pragma once
+
+typedef int esp_err_t;
+#define ESP_OK 0
+#define ESP_FAIL -1
+
+typedef void (*esp_freertos_tick_cb_t)(void);
+typedef bool (*esp_freertos_idle_cb_t)(void);
+
+#include <stdint.h>
+
+// tick hooks run from SIGPROF, every ms of CPU time the process uses, on the thread using it
+esp_err_t esp_register_freertos_tick_hook_for_cpu(esp_freertos_tick_cb_t cb, int core);
+void esp_deregister_freertos_tick_hook_for_cpu(esp_freertos_tick_cb_t cb, int core);
+
+/**
+ * @brief host only: in a tick hook, the program counter the tick interrupted, 0 if unknown
+ *
+ * @return uintptr_t
+ */
+uintptr_t hostInterruptedPc();
+
+// there is no idle task to hook on the host, registering fails
+esp_err_t esp_register_freertos_idle_hook_for_cpu(esp_freertos_idle_cb_t cb, int core);
+void esp_deregister_freertos_idle_hook_for_cpu(esp_freertos_idle_cb_t cb, int core);
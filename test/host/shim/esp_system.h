@@ -0,0 +1,28 @@
+#pragma once
+
+typedef enum {
+    ESP_RST_UNKNOWN,
+    ESP_RST_POWERON,
+    ESP_RST_EXT,
+    ESP_RST_SW,
+    ESP_RST_PANIC,
+    ESP_RST_INT_WDT,
+    ESP_RST_TASK_WDT,
+    ESP_RST_WDT,
+    ESP_RST_DEEPSLEEP,
+    ESP_RST_BROWNOUT,
+    ESP_RST_SDIO
+} esp_reset_reason_t;
+
+/**
+ * @brief ESP_RST_POWERON unless set with hostSetResetReason()
+ *
+ */
+esp_reset_reason_t esp_reset_reason(void);
+
+/**
+ * @brief host only: the reason esp_reset_reason() reports, e.g. to test warm boot
+ *
+ * @param reason
+ */
+void hostSetResetReason(esp_reset_reason_t reason);
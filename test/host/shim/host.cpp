@@ -0,0 +1,836 @@
+#include <Arduino.h>
+#include <Preferences.h>
+#include <Wire.h>
+#include <SPI.h>
+#include <esp_system.h>
+#include <esp_freertos_hooks.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <sys/time.h>
+#include <ucontext.h>
+#include <unistd.h>
+
+// host objects are never destroyed: detached task threads may still use them at exit
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+const Clock::time_point started = Clock::now();
+std::atomic<bool> clockFrozen(false);
+std::atomic<uint32_t> frozenMicros(0);
+esp_reset_reason_t resetReason = ESP_RST_POWERON;
+
+uint64_t elapsedMicros() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - started).count();
+}
+
+// wait on cv until done() or the timeout in ticks expires
+template<class Done>
+bool waitTicks(std::unique_lock<std::mutex> &lock, std::condition_variable &cv, TickType_t ticks, Done done) {
+    if (ticks == portMAX_DELAY) {
+        cv.wait(lock, done);
+        return true;
+    }
+    return cv.wait_for(lock, std::chrono::milliseconds(ticks * portTICK_PERIOD_MS), done);
+}
+
+std::recursive_mutex &criticalSection() {
+    static auto mutex = new std::recursive_mutex();
+    return *mutex;
+}
+
+}
+
+// a semaphore is a queue of items of size 0, as in FreeRTOS
+struct QueueDefinition {
+    std::mutex mutex;
+    std::condition_variable changed;
+    size_t length;
+    size_t itemSize;
+    size_t count;
+    std::deque<uint8_t> items;
+};
+
+struct tskTaskControlBlock {
+    std::string name;
+    uint32_t stackDepth;
+    // painted host stack of the task thread, nullptr for threads not created by xTaskCreate
+    uint8_t *stack = nullptr;
+    size_t stackSize = 0;
+    // where the task function was entered, above it are the thread's TLS and descriptor
+    uint8_t *volatile stackEntry = nullptr;
+    std::mutex mutex;
+    std::condition_variable changed;
+    uint32_t notifications[configTASK_NOTIFICATION_ARRAY_ENTRIES] = {};
+    bool suspended = false;
+    void *localStorage[4] = {};
+};
+
+namespace {
+
+// host code needs more stack than the target, so task threads get this on top of their depth
+const size_t STACK_SLACK = 64 * 1024;
+const uint8_t STACK_PAINT = 0xa5;
+
+thread_local tskTaskControlBlock *currentTask = nullptr;
+
+tskTaskControlBlock *current() {
+    if (currentTask == nullptr) {
+        // threads not created by xTaskCreate, e.g. main(), act as the loop task
+        currentTask = new tskTaskControlBlock();
+        currentTask->name = "loopTask";
+        currentTask->stackDepth = 8192;
+    }
+    return currentTask;
+}
+
+void waitWhileSuspended(tskTaskControlBlock *task) {
+    std::unique_lock<std::mutex> lock(task->mutex);
+    task->changed.wait(lock, [task]() { return !task->suspended; });
+}
+
+QueueDefinition *createQueue(size_t length, size_t itemSize, size_t count) {
+    auto q = new QueueDefinition();
+    q->length = length;
+    q->itemSize = itemSize;
+    q->count = count;
+    return q;
+}
+
+BaseType_t send(QueueHandle_t q, const void *item, TickType_t ticks) {
+    std::unique_lock<std::mutex> lock(q->mutex);
+    if (!waitTicks(lock, q->changed, ticks, [q]() { return q->count < q->length; })) {
+        return pdFALSE;
+    }
+    auto bytes = static_cast<const uint8_t*>(item);
+    q->items.insert(q->items.end(), bytes, bytes + q->itemSize);
+    q->count++;
+    q->changed.notify_all();
+    return pdTRUE;
+}
+
+BaseType_t receive(QueueHandle_t q, void *item, TickType_t ticks) {
+    std::unique_lock<std::mutex> lock(q->mutex);
+    if (!waitTicks(lock, q->changed, ticks, [q]() { return q->count > 0; })) {
+        return pdFALSE;
+    }
+    auto bytes = static_cast<uint8_t*>(item);
+    for (size_t i = 0; i < q->itemSize; i++) {
+        bytes[i] = q->items.front();
+        q->items.pop_front();
+    }
+    q->count--;
+    q->changed.notify_all();
+    return pdTRUE;
+}
+
+}
+
+SemaphoreHandle_t xSemaphoreCreateCountingStatic(UBaseType_t maxCount, UBaseType_t initialCount, StaticSemaphore_t*) {
+    return createQueue(maxCount, 0, initialCount);
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutexStatic(StaticSemaphore_t*) {
+    return createQueue(1, 0, 1);
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinaryStatic(StaticSemaphore_t*) {
+    return createQueue(1, 0, 0);
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t ticks) {
+    return receive(semaphore, nullptr, ticks);
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore) {
+    return send(semaphore, nullptr, 0);
+}
+
+BaseType_t xSemaphoreGiveFromISR(SemaphoreHandle_t semaphore, BaseType_t*) {
+    return send(semaphore, nullptr, 0);
+}
+
+QueueHandle_t xQueueCreateStatic(UBaseType_t length, UBaseType_t itemSize, uint8_t*, StaticQueue_t*) {
+    return createQueue(length, itemSize, 0);
+}
+
+BaseType_t xQueueSend(QueueHandle_t queue, const void *item, TickType_t ticks) {
+    return send(queue, item, ticks);
+}
+
+BaseType_t xQueueSendToBack(QueueHandle_t queue, const void *item, TickType_t ticks) {
+    return send(queue, item, ticks);
+}
+
+BaseType_t xQueueSendFromISR(QueueHandle_t queue, const void *item, BaseType_t*) {
+    return send(queue, item, 0);
+}
+
+BaseType_t xQueueReceive(QueueHandle_t queue, void *item, TickType_t ticks) {
+    return receive(queue, item, ticks);
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue) {
+    std::lock_guard<std::mutex> lock(queue->mutex);
+    return queue->count;
+}
+
+TaskHandle_t xTaskCreateStaticPinnedToCore(void (*fn)(void*), const char *name, uint32_t stackDepth, void *parameter,
+    UBaseType_t, StackType_t*, StaticTask_t*, BaseType_t) {
+    struct Start {
+        tskTaskControlBlock *task;
+        void (*fn)(void*);
+        void *parameter;
+    };
+    auto task = new tskTaskControlBlock();
+    task->name = name ? name : "";
+    task->stackDepth = stackDepth;
+    // like FreeRTOS, paint the stack so the high water mark can be found, but run on a host sized one
+    const auto page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    task->stackSize = (stackDepth + STACK_SLACK + page - 1) / page * page;
+    if (posix_memalign(reinterpret_cast<void**>(&task->stack), page, task->stackSize) != 0) {
+        delete task;
+        return nullptr;
+    }
+    memset(task->stack, STACK_PAINT, task->stackSize);
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setstack(&attr, task->stack, task->stackSize);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    pthread_t thread;
+    auto start = new Start{task, fn, parameter};
+    const auto created = pthread_create(&thread, &attr, [](void *p) -> void* {
+        const auto start = *static_cast<Start*>(p);
+        delete static_cast<Start*>(p);
+        uint8_t here;
+        start.task->stackEntry = &here;
+        currentTask = start.task;
+        start.fn(start.parameter);
+        return nullptr;
+    }, start);
+    pthread_attr_destroy(&attr);
+    if (created != 0) {
+        delete start;
+        free(task->stack);
+        delete task;
+        return nullptr;
+    }
+    return task;
+}
+
+void vTaskDelay(TickType_t ticks) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(ticks * portTICK_PERIOD_MS));
+    waitWhileSuspended(current());
+}
+
+BaseType_t xTaskDelayUntil(TickType_t *previous, TickType_t increment) {
+    *previous += increment;
+    const auto wait = static_cast<int32_t>(*previous - xTaskGetTickCount());
+    if (wait <= 0) {
+        return pdFALSE;
+    }
+    vTaskDelay(wait);
+    return pdTRUE;
+}
+
+void vTaskDelayUntil(TickType_t *previous, TickType_t increment) {
+    xTaskDelayUntil(previous, increment);
+}
+
+TickType_t xTaskGetTickCount() {
+    return elapsedMicros() / (1000 * portTICK_PERIOD_MS);
+}
+
+TickType_t xTaskGetTickCountFromISR() {
+    return xTaskGetTickCount();
+}
+
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task) {
+    task = task ? task : current();
+    if (task->stack == nullptr || task->stackEntry == nullptr) {
+        return task->stackDepth;
+    }
+    // stacks grow down: the deepest point is the lowest byte that lost its paint
+    size_t untouched = 0;
+    while (untouched < task->stackSize && task->stack[untouched] == STACK_PAINT) {
+        untouched++;
+    }
+    const size_t used = task->stackEntry - (task->stack + untouched);
+    return used < task->stackDepth ? task->stackDepth - used : 0;
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle() {
+    return current();
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandleForCPU(BaseType_t) {
+    return current();
+}
+
+void vTaskSuspend(TaskHandle_t task) {
+    task = task ? task : current();
+    {
+        std::lock_guard<std::mutex> lock(task->mutex);
+        task->suspended = true;
+    }
+    // other tasks stop at their next delay or wait
+    if (task == current()) {
+        waitWhileSuspended(task);
+    }
+}
+
+void vTaskResume(TaskHandle_t task) {
+    std::lock_guard<std::mutex> lock(task->mutex);
+    task->suspended = false;
+    task->changed.notify_all();
+}
+
+void vTaskSetThreadLocalStoragePointer(TaskHandle_t task, BaseType_t index, void *value) {
+    (task ? task : current())->localStorage[index] = value;
+}
+
+void *pvTaskGetThreadLocalStoragePointer(TaskHandle_t task, BaseType_t index) {
+    return (task ? task : current())->localStorage[index];
+}
+
+const char *pcTaskGetName(TaskHandle_t task) {
+    return (task ? task : current())->name.c_str();
+}
+
+BaseType_t xTaskNotifyGiveIndexed(TaskHandle_t task, UBaseType_t index) {
+    std::lock_guard<std::mutex> lock(task->mutex);
+    task->notifications[index]++;
+    task->changed.notify_all();
+    return pdPASS;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task) {
+    return xTaskNotifyGiveIndexed(task, 0);
+}
+
+void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t*) {
+    xTaskNotifyGive(task);
+}
+
+uint32_t ulTaskNotifyTakeIndexed(UBaseType_t index, BaseType_t clear, TickType_t ticks) {
+    const auto task = current();
+    auto &notifications = task->notifications[index];
+    std::unique_lock<std::mutex> lock(task->mutex);
+    waitTicks(lock, task->changed, ticks, [task, &notifications]() { return notifications > 0 && !task->suspended; });
+    const auto value = notifications;
+    if (value) {
+        notifications = clear ? 0 : value - 1;
+    }
+    return value;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t ticks) {
+    return ulTaskNotifyTakeIndexed(0, clear, ticks);
+}
+
+BaseType_t xPortGetCoreID() {
+    return 0;
+}
+
+BaseType_t xPortInIsrContext() {
+    return pdFALSE;
+}
+
+void portENTER_CRITICAL(portMUX_TYPE*) {
+    criticalSection().lock();
+}
+
+void portEXIT_CRITICAL(portMUX_TYPE*) {
+    criticalSection().unlock();
+}
+
+uint32_t esp_random() {
+    // splitmix64, small enough to leave the task stack high water mark alone
+    static std::atomic<uint64_t> state(Clock::now().time_since_epoch().count());
+    auto z = state.fetch_add(0x9e3779b97f4a7c15ULL, std::memory_order_relaxed) + 0x9e3779b97f4a7c15ULL;
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return static_cast<uint32_t>((z ^ (z >> 31)) >> 32);
+}
+
+uint32_t esp_cpu_get_cycle_count() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - started).count();
+}
+
+uint32_t getCpuFrequencyMhz() {
+    return 1000;
+}
+
+unsigned long micros() {
+    if (clockFrozen.load(std::memory_order_acquire)) {
+        return frozenMicros.load(std::memory_order_relaxed);
+    }
+    return static_cast<uint32_t>(elapsedMicros());
+}
+
+unsigned long millis() {
+    if (clockFrozen.load(std::memory_order_acquire)) {
+        return frozenMicros.load(std::memory_order_relaxed) / 1000;
+    }
+    return static_cast<uint32_t>(elapsedMicros() / 1000);
+}
+
+void delay(uint32_t ms) {
+    vTaskDelay(ms / portTICK_PERIOD_MS);
+}
+
+void delayMicroseconds(uint32_t us) {
+    // busy wait, like the target
+    const auto until = Clock::now() + std::chrono::microseconds(us);
+    while (Clock::now() < until) {
+    }
+}
+
+namespace {
+
+std::atomic<int> pinModes[256];
+std::atomic<int> pinLevels[256];
+
+struct PinsInit {
+    PinsInit() {
+        for (size_t i = 0; i < 256; i++) {
+            pinModes[i] = -1;
+            pinLevels[i] = -1;
+        }
+    }
+} pinsInit;
+
+}
+
+void pinMode(uint8_t pin, uint8_t mode) {
+    pinModes[pin] = mode;
+}
+
+void digitalWrite(uint8_t pin, uint8_t value) {
+    pinLevels[pin] = value;
+}
+
+int hostPinMode(uint8_t pin) {
+    return pinModes[pin];
+}
+
+int hostPinLevel(uint8_t pin) {
+    return pinLevels[pin];
+}
+
+void hostClockSet(uint32_t micros) {
+    frozenMicros.store(micros, std::memory_order_relaxed);
+    clockFrozen.store(true, std::memory_order_release);
+}
+
+void hostClockRun() {
+    clockFrozen.store(false, std::memory_order_release);
+}
+
+esp_reset_reason_t esp_reset_reason(void) {
+    return resetReason;
+}
+
+void hostSetResetReason(esp_reset_reason_t reason) {
+    resetReason = reason;
+}
+
+namespace {
+
+// as many as ESP-IDF allows per core
+const size_t MAX_HOOKS = 8;
+std::atomic<esp_freertos_tick_cb_t> tickHooks[MAX_HOOKS];
+thread_local uintptr_t interruptedPc = 0;
+
+uintptr_t pcOf(void *context) {
+    auto uc = static_cast<ucontext_t*>(context);
+#if defined(__APPLE__) && defined(__x86_64__)
+    return uc->uc_mcontext->__ss.__rip;
+#elif defined(__APPLE__) && defined(__aarch64__)
+    return uc->uc_mcontext->__ss.__pc;
+#elif defined(__linux__) && defined(__x86_64__)
+    return uc->uc_mcontext.gregs[REG_RIP];
+#elif defined(__linux__) && defined(__aarch64__)
+    return uc->uc_mcontext.pc;
+#else
+    (void)uc;
+    return 0;
+#endif
+}
+
+void onProfilingTick(int, siginfo_t*, void *context) {
+    // only tasks, including the loop task, are ticked, so hooks see a valid current task
+    if (currentTask == nullptr) {
+        return;
+    }
+    const auto saved = errno;
+    interruptedPc = pcOf(context);
+    for (auto &hook : tickHooks) {
+        const auto fn = hook.load(std::memory_order_acquire);
+        if (fn) {
+            fn();
+        }
+    }
+    interruptedPc = 0;
+    errno = saved;
+}
+
+void setTickTimer(bool on) {
+    itimerval timer = {};
+    if (on) {
+        timer.it_interval.tv_usec = 1000000 / configTICK_RATE_HZ;
+        timer.it_value = timer.it_interval;
+    }
+    setitimer(ITIMER_PROF, &timer, nullptr);
+}
+
+}
+
+esp_err_t esp_register_freertos_tick_hook_for_cpu(esp_freertos_tick_cb_t cb, int core) {
+    if (core >= portNUM_PROCESSORS) {
+        return ESP_FAIL;
+    }
+    // the registering thread is the loop task from now on, if it wasn't one already
+    current();
+    static std::once_flag installed;
+    std::call_once(installed, []() {
+        struct sigaction action = {};
+        action.sa_sigaction = onProfilingTick;
+        action.sa_flags = SA_SIGINFO | SA_RESTART;
+        sigemptyset(&action.sa_mask);
+        sigaction(SIGPROF, &action, nullptr);
+    });
+    std::lock_guard<std::recursive_mutex> lock(criticalSection());
+    for (auto &hook : tickHooks) {
+        esp_freertos_tick_cb_t empty = nullptr;
+        if (hook.compare_exchange_strong(empty, cb)) {
+            setTickTimer(true);
+            return ESP_OK;
+        }
+    }
+    return ESP_FAIL;
+}
+
+void esp_deregister_freertos_tick_hook_for_cpu(esp_freertos_tick_cb_t cb, int) {
+    std::lock_guard<std::recursive_mutex> lock(criticalSection());
+    auto any = false;
+    for (auto &hook : tickHooks) {
+        esp_freertos_tick_cb_t registered = cb;
+        hook.compare_exchange_strong(registered, nullptr);
+        any |= hook.load() != nullptr;
+    }
+    if (!any) {
+        setTickTimer(false);
+    }
+}
+
+uintptr_t hostInterruptedPc() {
+    return interruptedPc;
+}
+
+esp_err_t esp_register_freertos_idle_hook_for_cpu(esp_freertos_idle_cb_t, int) {
+    return ESP_FAIL;
+}
+
+void esp_deregister_freertos_idle_hook_for_cpu(esp_freertos_idle_cb_t, int) {}
+
+size_t Print::write(const uint8_t *buf, size_t len) {
+    size_t n = 0;
+    for (size_t i = 0; i < len; i++) {
+        n += write(buf[i]);
+    }
+    return n;
+}
+
+size_t Print::print(const char *s) {
+    return write(s);
+}
+
+size_t Print::print(char c) {
+    return write(static_cast<uint8_t>(c));
+}
+
+size_t Print::print(int n) {
+    return printf("%d", n);
+}
+
+size_t Print::print(unsigned n) {
+    return printf("%u", n);
+}
+
+size_t Print::print(long n) {
+    return printf("%ld", n);
+}
+
+size_t Print::print(unsigned long n) {
+    return printf("%lu", n);
+}
+
+size_t Print::print(double n, int digits) {
+    return printf("%.*f", digits, n);
+}
+
+size_t Print::println(const char *s) {
+    return print(s) + println();
+}
+
+size_t Print::println() {
+    return write("\r\n");
+}
+
+size_t Print::printf(const char *fmt, ...) {
+    char buf[256];
+    va_list args;
+    va_start(args, fmt);
+    const auto len = vsnprintf(buf, sizeof(buf), fmt, args);
+    va_end(args);
+    if (len < 0) {
+        return 0;
+    }
+    if (static_cast<size_t>(len) < sizeof(buf)) {
+        return write(reinterpret_cast<const uint8_t*>(buf), len);
+    }
+    std::vector<char> big(len + 1);
+    va_start(args, fmt);
+    vsnprintf(big.data(), big.size(), fmt, args);
+    va_end(args);
+    return write(reinterpret_cast<const uint8_t*>(big.data()), len);
+}
+
+size_t Stream::readBytes(uint8_t *buf, size_t len) {
+    size_t n = 0;
+    while (n < len && available() > 0) {
+        buf[n++] = read();
+    }
+    return n;
+}
+
+struct HardwareSerial::Receiver {
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::vector<uint8_t> ring;
+    size_t head = 0;
+    size_t count = 0;
+    bool eof = false;
+    std::function<void(void)> onReceive;
+
+    void run(int fd) {
+        uint8_t buf[512];
+        for (;;) {
+            size_t space;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                changed.wait(lock, [this]() { return count < ring.size(); });
+                space = ring.size() - count;
+            }
+            const auto n = ::read(fd, buf, space < sizeof(buf) ? space : sizeof(buf));
+            if (n < 0 && (errno == EINTR || errno == EAGAIN)) {
+                continue;
+            }
+            std::function<void(void)> fn;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                for (ssize_t i = 0; i < n; i++) {
+                    ring[(head + count++) % ring.size()] = buf[i];
+                }
+                // a closed pty reports EIO
+                eof = n <= 0;
+                fn = onReceive;
+            }
+            if (fn) {
+                fn();
+            }
+            if (n <= 0) {
+                return;
+            }
+        }
+    }
+};
+
+HardwareSerial::HardwareSerial(int fd) : fd(fd), receiver(nullptr), rxBufferSize(256) {}
+
+HardwareSerial::~HardwareSerial() {}
+
+void HardwareSerial::end() {}
+
+bool HardwareSerial::open(const char *path) {
+    auto rx = ::open(path, O_RDWR | O_NOCTTY);
+    if (rx < 0) {
+        rx = ::open(path, O_RDONLY | O_NOCTTY);
+    }
+    return rx >= 0 && open(rx);
+}
+
+bool HardwareSerial::open(int rx) {
+    if (rx < 0) {
+        return false;
+    }
+    fd = rx;
+    if (receiver == nullptr) {
+        receiver = new Receiver();
+    }
+    receiver->ring.resize(rxBufferSize);
+    auto r = receiver;
+    std::thread([r, rx]() { r->run(rx); }).detach();
+    return true;
+}
+
+bool HardwareSerial::drained() {
+    if (receiver == nullptr) {
+        return true;
+    }
+    std::lock_guard<std::mutex> lock(receiver->mutex);
+    return receiver->eof && receiver->count == 0;
+}
+
+size_t HardwareSerial::write(uint8_t c) {
+    return write(&c, 1);
+}
+
+size_t HardwareSerial::write(const uint8_t *buf, size_t len) {
+    if (fd < 0) {
+        return len;
+    }
+    size_t done = 0;
+    while (done < len) {
+        const auto n = ::write(fd, buf + done, len - done);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            break;
+        }
+        done += n;
+    }
+    return done;
+}
+
+int HardwareSerial::available() {
+    if (receiver == nullptr) {
+        return 0;
+    }
+    std::lock_guard<std::mutex> lock(receiver->mutex);
+    return receiver->count;
+}
+
+int HardwareSerial::read() {
+    uint8_t c;
+    return read(&c, 1) ? c : -1;
+}
+
+int HardwareSerial::peek() {
+    if (receiver == nullptr) {
+        return -1;
+    }
+    std::lock_guard<std::mutex> lock(receiver->mutex);
+    return receiver->count ? receiver->ring[receiver->head] : -1;
+}
+
+size_t HardwareSerial::read(uint8_t *buf, size_t len) {
+    if (receiver == nullptr) {
+        return 0;
+    }
+    std::lock_guard<std::mutex> lock(receiver->mutex);
+    auto &r = *receiver;
+    size_t n = 0;
+    while (n < len && r.count) {
+        buf[n++] = r.ring[r.head];
+        r.head = (r.head + 1) % r.ring.size();
+        r.count--;
+    }
+    r.changed.notify_all();
+    return n;
+}
+
+int HardwareSerial::availableForWrite() {
+    return 128;
+}
+
+size_t HardwareSerial::setRxBufferSize(size_t size) {
+    if (receiver && !receiver->ring.empty()) {
+        return 0; // too late, as on the target once begun
+    }
+    rxBufferSize = size;
+    return size;
+}
+
+void HardwareSerial::onReceive(std::function<void(void)> fn, bool) {
+    if (receiver == nullptr) {
+        receiver = new Receiver();
+    }
+    std::lock_guard<std::mutex> lock(receiver->mutex);
+    receiver->onReceive = fn;
+}
+
+HardwareSerial Serial(1);
+HardwareSerial Serial1;
+HardwareSerial Serial2;
+
+namespace {
+
+std::map<std::string, std::vector<uint8_t>> &preferences() {
+    static auto store = new std::map<std::string, std::vector<uint8_t>>();
+    return *store;
+}
+
+std::string preferenceKey(const char *ns, const char *key) {
+    return std::string(ns ? ns : "") + "/" + key;
+}
+
+}
+
+bool Preferences::begin(const char *name, bool) {
+    ns = name;
+    return true;
+}
+
+void Preferences::end() {
+    ns = nullptr;
+}
+
+size_t Preferences::putBytes(const char *key, const void *value, size_t len) {
+    auto bytes = static_cast<const uint8_t*>(value);
+    preferences()[preferenceKey(ns, key)].assign(bytes, bytes + len);
+    return len;
+}
+
+size_t Preferences::getBytes(const char *key, void *buf, size_t maxLen) {
+    auto it = preferences().find(preferenceKey(ns, key));
+    if (it == preferences().end() || it->second.size() > maxLen) {
+        return 0;
+    }
+    memcpy(buf, it->second.data(), it->second.size());
+    return it->second.size();
+}
+
+size_t Preferences::getBytesLength(const char *key) {
+    auto it = preferences().find(preferenceKey(ns, key));
+    return it == preferences().end() ? 0 : it->second.size();
+}
+
+bool Preferences::remove(const char *key) {
+    return preferences().erase(preferenceKey(ns, key)) > 0;
+}
+
+bool Preferences::clear() {
+    const auto prefix = preferenceKey(ns, "");
+    for (auto it = preferences().begin(); it != preferences().end();) {
+        it = it->first.compare(0, prefix.size(), prefix) == 0 ? preferences().erase(it) : std::next(it);
+    }
+    return true;
+}
+
+TwoWire Wire;
+SPIClass SPI;
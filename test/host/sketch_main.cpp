@@ -0,0 +1,18 @@
+#include <Arduino.h>
+
+/*
+ * main() of an example sketch built against the shim: setup(), then loop() SKETCH_LOOPS times,
+ * 0 unless set in the environment
+ */
+
+void setup();
+void loop();
+
+int main() {
+    const auto loops = getenv("SKETCH_LOOPS");
+    setup();
+    for (auto n = loops ? atol(loops) : 0; n > 0; n--) {
+        loop();
+    }
+    return 0;
+}
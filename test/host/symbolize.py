@@ -0,0 +1,55 @@
+#!/usr/bin/env python3
+"""
+Replaces the program counters in Profiler.printFolded() output with function names:
+
+    symbolize.py firmware.elf [folded.txt] > symbolized.txt
+
+reads stdin if no file is given. Stacks that end up the same are merged. The toolchain's
+addr2line is used, xtensa-esp32-elf-addr2line unless --addr2line names another, e.g.
+riscv32-esp-elf-addr2line for the ESP32-C3 or plain addr2line for a host build.
+"""
+
+import argparse
+import collections
+import re
+import subprocess
+import sys
+
+PC = re.compile(r';(0x[0-9a-fA-F]+)$')
+
+
+def symbols(addr2line, elf, addresses):
+    if not addresses:
+        return {}
+    out = subprocess.run([addr2line, '-f', '-C', '-e', elf] + addresses,
+                         check=True, capture_output=True, text=True).stdout.splitlines()
+    # a function and a file:line per address
+    return {a: (f if f != '??' else a) for a, f in zip(addresses, out[0::2])}
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('elf')
+    parser.add_argument('folded', nargs='?', type=argparse.FileType('r'), default=sys.stdin)
+    parser.add_argument('--addr2line', default='xtensa-esp32-elf-addr2line')
+    args = parser.parse_args()
+
+    stacks = []
+    for line in args.folded:
+        stack, _, count = line.rstrip('\n').rpartition(' ')
+        if stack and count.isdigit():
+            stacks.append((stack, int(count)))
+
+    addresses = sorted({m.group(1) for s, _ in stacks for m in [PC.search(s)] if m})
+    names = symbols(args.addr2line, args.elf, addresses)
+
+    merged = collections.OrderedDict()
+    for stack, count in stacks:
+        stack = PC.sub(lambda m: ';' + names.get(m.group(1), m.group(1)), stack)
+        merged[stack] = merged.get(stack, 0) + count
+    for stack, count in merged.items():
+        print('%s %d' % (stack, count))
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,153 @@
+#include <Arduino.h>
+#include <atomic>
+#include "check.h"
+#include "bus.h"
+
+namespace {
+
+// a device with 16 registers, reads start at the register written first
+struct Device {
+    uint8_t registers[16];
+    std::atomic<uint32_t> reads;
+};
+
+bool answer(BusTransaction &txn, void *args) {
+    auto device = static_cast<Device*>(args);
+    if (txn.txLen != 1 || txn.tx[0] + txn.rxLen > sizeof(device->registers)) {
+        return false;
+    }
+    memcpy(txn.rx, device->registers + txn.tx[0], txn.rxLen);
+    device->reads++;
+    return true;
+}
+
+struct Counted {
+    std::atomic<uint32_t> done;
+    std::atomic<uint32_t> failed;
+};
+
+void countDone(BusTransaction &txn, void *args) {
+    auto counted = static_cast<Counted*>(args);
+    (txn.ok ? counted->done : counted->failed)++;
+}
+
+void waitFor(const std::atomic<uint32_t> &value, uint32_t wanted) {
+    for (auto i = 0; i < 5000 && value < wanted; i++) {
+        delay(1);
+    }
+    CHECK_EQ(value.load(), wanted);
+}
+
+Device device;
+MockBus mockBus(100, 10, answer, &device);
+BusManager manager("mockBus", mockBus);
+
+// transactions from several clients all run, in order per client, and decode into DataThings
+void testMockBus() {
+    for (uint8_t i = 0; i < sizeof(device.registers); i++) {
+        device.registers[i] = 0xa0 + i;
+    }
+    CHECK_EQ(manager.setup(), BaseSubsystem::READY);
+    CHECK_EQ(manager.start(), BaseSubsystem::RUNNING);
+    CHECK(!manager.submit(nullptr));
+
+    struct Sample {
+        uint8_t a, b;
+    };
+    ReadWriteLock lock;
+    DataThing<Sample> sample(lock);
+    const uint8_t reg4 = 4;
+    uint8_t rx[2];
+    PublishingTransaction<Sample> publishing(0x68, &reg4, 1, rx, sizeof(rx), sample,
+        [](const uint8_t *rx, size_t /*len*/, Sample &data) {
+            data.a = rx[0];
+            data.b = rx[1];
+        });
+
+    Counted counted = {};
+    const uint8_t regs[] = {0, 8, 15, 14};
+    uint8_t results[4][2] = {};
+    BusTransaction txns[4];
+    for (auto i = 0; i < 4; i++) {
+        // register 15 reads past the end and fails
+        txns[i] = BusTransaction{0x68, &regs[i], 1, results[i], sizeof(results[i]), countDone, &counted, false, 0};
+    }
+    CHECK(manager.submit(&publishing));
+    for (auto &txn : txns) {
+        CHECK(manager.submit(&txn));
+    }
+    waitFor(counted.done, 3);
+    waitFor(counted.failed, 1);
+    CHECK_EQ(results[0][0], 0xa0);
+    CHECK_EQ(results[1][1], 0xa9);
+    CHECK_EQ(results[2][0], 0);
+    CHECK_EQ(results[3][0], 0xae);
+    CHECK_EQ(results[3][1], 0xaf);
+    CHECK(!txns[2].ok);
+
+    Sample published = {};
+    sample.readData([](const Sample &data, void *args) {
+        *static_cast<Sample*>(args) = data;
+    }, &published);
+    CHECK_EQ(published.a, 0xa4);
+    CHECK_EQ(published.b, 0xa5);
+    CHECK_EQ(mockBus.transfers(), 5u);
+    CHECK_EQ(device.reads.load(), 4u);
+    CHECK_EQ(manager.failures(), 1u);
+    CHECK_EQ(manager.latency().count(), 5u);
+    // 100 us fixed plus 3 bytes at 10 us each
+    CHECK(manager.latency().percentile(0) >= 130);
+}
+
+// a full queue rejects without blocking; what was accepted still runs
+void testQueueFull() {
+    mockBus.setLatency(20000, 0);
+    Counted counted = {};
+    const uint8_t reg = 0;
+    uint8_t rx[1];
+    BusTransaction txns[24];
+    uint32_t accepted = 0;
+    for (auto &txn : txns) {
+        txn = BusTransaction{0x68, &reg, 1, rx, sizeof(rx), countDone, &counted, false, 0};
+        accepted += manager.submit(&txn);
+    }
+    CHECK(accepted < 24);
+    CHECK(accepted >= 16);
+    mockBus.setLatency(0, 0);
+    waitFor(counted.done, accepted);
+}
+
+// chip selects are deselected outputs before the first transaction, and after each
+void testSpiChipSelect() {
+    const uint8_t csPins[] = {5, 15};
+    SpiBus spiBus(SPI, SPISettings(1000000, MSBFIRST, SPI_MODE0), csPins, 2);
+    CHECK_EQ(hostPinMode(5), -1);
+    CHECK(spiBus.begin());
+    for (auto pin : csPins) {
+        CHECK_EQ(hostPinMode(pin), OUTPUT);
+        CHECK_EQ(hostPinLevel(pin), HIGH);
+    }
+
+    const uint8_t reg = 0x75;
+    uint8_t rx[2] = {};
+    BusTransaction txn{5, &reg, 1, rx, sizeof(rx), nullptr, nullptr, false, 0};
+    CHECK(spiBus.transfer(txn));
+    CHECK_EQ(rx[0], 0xff);
+    CHECK_EQ(hostPinLevel(5), HIGH);
+
+    // a pin not passed in is set up on first use
+    txn.address = 21;
+    CHECK(spiBus.transfer(txn));
+    CHECK_EQ(hostPinMode(21), OUTPUT);
+    CHECK_EQ(hostPinLevel(21), HIGH);
+}
+
+}
+
+int main() {
+    testMockBus();
+    testQueueFull();
+    testSpiChipSelect();
+    printf("bus: ok\n");
+    return 0;
+}
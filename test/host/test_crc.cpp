@@ -0,0 +1,76 @@
+#include <Arduino.h>
+#include <vector>
+#include "check.h"
+#include "crc.h"
+
+namespace {
+
+// the textbook bit at a time CRC, reflected or not
+uint32_t bitwise(const uint8_t *data, size_t len, unsigned width, uint32_t poly, uint32_t init, bool reflected, uint32_t xorOut) {
+    const uint32_t top = 1u << (width - 1);
+    const uint32_t mask = width == 32 ? 0xffffffff : (1u << width) - 1;
+    auto crc = init;
+    for (size_t i = 0; i < len; i++) {
+        if (reflected) {
+            crc ^= data[i];
+            for (auto k = 0; k < 8; k++) {
+                crc = (crc >> 1) ^ (poly & -(crc & 1));
+            }
+        } else {
+            crc ^= static_cast<uint32_t>(data[i]) << (width - 8);
+            for (auto k = 0; k < 8; k++) {
+                crc = ((crc << 1) ^ ((crc & top) ? poly : 0)) & mask;
+            }
+        }
+    }
+    return crc ^ xorOut;
+}
+
+uint32_t refCrc16(const std::vector<uint8_t> &d) { return bitwise(d.data(), d.size(), 16, 0x1021, 0xffff, false, 0); }
+uint32_t refCrc32(const std::vector<uint8_t> &d) { return bitwise(d.data(), d.size(), 32, 0xedb88320, 0xffffffff, true, 0xffffffff); }
+uint32_t refCrc32c(const std::vector<uint8_t> &d) { return bitwise(d.data(), d.size(), 32, 0x82f63b78, 0xffffffff, true, 0xffffffff); }
+
+// the catalogued check values of "123456789"
+void testCheckValues() {
+    const auto nine = reinterpret_cast<const uint8_t*>("123456789");
+    CHECK_EQ(crc16(nine, 9), 0x29b1);
+    CHECK_EQ(crc32(nine, 9), 0xcbf43926u);
+    CHECK_EQ(crc32c(nine, 9), 0xe3069283u);
+    const std::vector<uint8_t> v(nine, nine + 9);
+    CHECK_EQ(refCrc16(v), 0x29b1u);
+    CHECK_EQ(refCrc32(v), 0xcbf43926u);
+    CHECK_EQ(refCrc32c(v), 0xe3069283u);
+    CHECK_EQ(crc16(nullptr, 0), 0xffff);
+    CHECK_EQ(crc32(nullptr, 0), 0u);
+    CHECK_EQ(crc32c(nullptr, 0), 0u);
+}
+
+// every length and alignment the slicing loops and their tails see, whole and in two pieces
+void testAgainstBitwise() {
+    std::vector<uint8_t> buf(600);
+    for (auto &b : buf) {
+        b = static_cast<uint8_t>(esp_random());
+    }
+    for (size_t offset = 0; offset < 8; offset++) {
+        for (size_t len = 0; len + offset <= buf.size(); len += len < 40 ? 1 : 37) {
+            const std::vector<uint8_t> d(buf.begin() + offset, buf.begin() + offset + len);
+            const auto p = buf.data() + offset;
+            CHECK_EQ(crc16(p, len), refCrc16(d));
+            CHECK_EQ(crc32(p, len), refCrc32(d));
+            CHECK_EQ(crc32c(p, len), refCrc32c(d));
+            const auto split = len / 3;
+            CHECK_EQ(crc16(p + split, len - split, crc16(p, split)), refCrc16(d));
+            CHECK_EQ(crc32(p + split, len - split, crc32(p, split)), refCrc32(d));
+            CHECK_EQ(crc32c(p + split, len - split, crc32c(p, split)), refCrc32c(d));
+        }
+    }
+}
+
+}
+
+int main() {
+    testCheckValues();
+    testAgainstBitwise();
+    printf("crc: ok\n");
+    return 0;
+}
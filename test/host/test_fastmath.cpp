@@ -0,0 +1,166 @@
+#include <Arduino.h>
+#include <math.h>
+#include "check.h"
+#include "fastmath.h"
+
+/*
+ * Sweeps each approximation over its documented domain and checks the documented error
+ * bound against libm in double precision. Prints the largest error found, for tightening
+ * the bounds when the approximations change.
+ */
+
+namespace {
+
+const int STEPS = 1000000;
+
+struct MaxError {
+    const char *name;
+    double bound;
+    double worst = 0;
+    double at = 0;
+
+    MaxError(const char *name, double bound) : name(name), bound(bound) {}
+
+    void add(double error, double x) {
+        error = fabs(error);
+        if (!(error <= worst)) {
+            worst = error;
+            at = x;
+        }
+    }
+
+    void check() const {
+        printf("  %-22s %.3g at %.9g, bound %.3g\n", name, worst, at, bound);
+        CHECK(worst < bound);
+    }
+};
+
+double relative(double approx, double exact) {
+    return (approx - exact) / exact;
+}
+
+// logarithmically spaced over [lo, hi]
+double logSpaced(double lo, double hi, int i) {
+    return lo * pow(hi / lo, static_cast<double>(i) / STEPS);
+}
+
+double linSpaced(double lo, double hi, int i) {
+    return lo + (hi - lo) * i / STEPS;
+}
+
+void testSqrt() {
+    MaxError invSqrt("fastInvSqrt", 5e-6), sqrtError("fastSqrt", 5e-6);
+    for (int i = 0; i <= STEPS; i++) {
+        const auto x = static_cast<float>(logSpaced(1e-30, 1e30, i));
+        invSqrt.add(relative(fastInvSqrt(x), 1 / sqrt(static_cast<double>(x))), x);
+        sqrtError.add(relative(fastSqrt(x), sqrt(static_cast<double>(x))), x);
+    }
+    invSqrt.check();
+    sqrtError.check();
+    CHECK(fastSqrt(0) == 0);
+    CHECK(fastSqrt(-1) == 0);
+}
+
+void testAtan2() {
+    MaxError error("fastAtan2", 1.2e-5);
+    for (int i = 0; i <= STEPS; i++) {
+        const auto a = linSpaced(-M_PI, M_PI, i);
+        // radii from tiny to large
+        const auto r = logSpaced(1e-3, 1e3, static_cast<int>(i * 7919LL % STEPS));
+        const auto y = static_cast<float>(r * sin(a)), x = static_cast<float>(r * cos(a));
+        auto e = fastAtan2(y, x) - atan2(static_cast<double>(y), static_cast<double>(x));
+        // +pi and -pi are the same angle
+        if (e > M_PI) {
+            e -= 2 * M_PI;
+        } else if (e < -M_PI) {
+            e += 2 * M_PI;
+        }
+        error.add(e, a);
+    }
+    error.check();
+    CHECK(fastAtan2(0, 0) == 0);
+}
+
+void testSinCos() {
+    MaxError sinError("fastSin |x| < 16", 8e-5), cosError("fastCos |x| < 16", 8e-5);
+    MaxError farError("fastSin |x| < 1000", 8e-5 + 8e-8 * 1000);
+    for (int i = 0; i <= STEPS; i++) {
+        const auto x = static_cast<float>(linSpaced(-16, 16, i));
+        sinError.add(fastSin(x) - sin(static_cast<double>(x)), x);
+        cosError.add(fastCos(x) - cos(static_cast<double>(x)), x);
+        const auto far = static_cast<float>(linSpaced(-1000, 1000, i));
+        farError.add(fastSin(far) - sin(static_cast<double>(far)), far);
+    }
+    sinError.check();
+    cosError.check();
+    farError.check();
+}
+
+void testLogExp() {
+    MaxError log2Near("fastLog2 0.25..4", 2e-7), log2Any("fastLog2 normal", 4e-6);
+    MaxError exp2Error("fastExp2", 2e-7);
+    for (int i = 0; i <= STEPS; i++) {
+        const auto near = static_cast<float>(logSpaced(0.25, 4, i));
+        log2Near.add(fastLog2(near) - log2(static_cast<double>(near)), near);
+        const auto any = static_cast<float>(logSpaced(1.2e-38, 3.4e38, i));
+        log2Any.add(fastLog2(any) - log2(static_cast<double>(any)), any);
+        const auto e = static_cast<float>(linSpaced(-125.99, 127.99, i));
+        exp2Error.add(relative(fastExp2(e), exp2(static_cast<double>(e))), e);
+    }
+    log2Near.check();
+    log2Any.check();
+    exp2Error.check();
+}
+
+void testPow() {
+    // baroAltitude()'s exponent and some larger ones, which scale the error
+    const double exponents[] = {0.190295, 1.5, -2.0, 10.0};
+    for (const auto y : exponents) {
+        char name[32];
+        snprintf(name, sizeof(name), "fastPow y = %g", y);
+        MaxError error(name, 2e-7 + 3e-6 * fabs(y));
+        for (int i = 0; i <= STEPS / 10; i++) {
+            const auto x = static_cast<float>(logSpaced(1e-3, 1e3, i * 10));
+            error.add(relative(fastPow(x, static_cast<float>(y)), pow(static_cast<double>(x), static_cast<float>(y))), x);
+        }
+        error.check();
+    }
+}
+
+void testBaroAltitude() {
+    MaxError error("baroAltitude m", 0.01);
+    for (int i = 0; i <= STEPS; i++) {
+        const auto p = static_cast<float>(linSpaced(1000, 110000, i));
+        const auto exact = 44330.0 * (1 - pow(static_cast<double>(p) / 101325.0, 0.190295));
+        error.add(baroAltitude(p) - exact, p);
+    }
+    error.check();
+}
+
+void testFixed() {
+    typedef Fixed<16> Q16;
+    CHECK_EQ(Q16(1.5f).toRaw(), 3 << 15);
+    CHECK_EQ(Q16(-1.5f).toRaw(), -(3 << 15));
+    CHECK_EQ((Q16(1.5f) * Q16(-2.25f)).toFloat(), -3.375f);
+    CHECK_EQ((Q16(-3.375f) / Q16(1.5f)).toFloat(), -2.25f);
+    CHECK_EQ((Q16(100.0f) * Q16(300.0f)).toInt(), 30000);
+    typedef Fixed<12, int16_t> Q12;
+    CHECK_EQ((Q12(3.5f) * Q12(2.0f)).toFloat(), 7.0f);
+    CHECK_EQ((Q12(-7.0f) / Q12(2.0f)).toFloat(), -3.5f);
+    CHECK(Q12(1.0f) < Q12(1.25f));
+}
+
+}
+
+int main() {
+    printf("fastmath errors:\n");
+    testSqrt();
+    testAtan2();
+    testSinCos();
+    testLogExp();
+    testPow();
+    testBaroAltitude();
+    testFixed();
+    printf("fastmath: ok\n");
+    return 0;
+}
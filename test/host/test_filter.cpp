@@ -0,0 +1,198 @@
+#include <Arduino.h>
+#include <vector>
+#include "check.h"
+#include "filter.h"
+
+namespace {
+
+const size_t CHANNELS = 3;
+typedef Samples<CHANNELS> Frame;
+
+const float FIR[5] = {0.1f, 0.2f, 0.4f, 0.2f, 0.1f};
+
+// a 2nd order Butterworth low pass at fs / 10, then a notch at fs / 4
+const BiquadCoefficients BIQUADS[2] = {
+    {0.0674553f, 0.1349105f, 0.0674553f, -1.1429805f, 0.4128016f},
+    {0.9565432f, 0.0f, 0.9565432f, 0.0f, 0.9130864f},
+};
+
+// a different signal per channel: impulse, step and noise
+std::vector<Frame> signal(size_t frames) {
+    std::vector<Frame> v(frames);
+    uint32_t x = 7;
+    for (size_t f = 0; f < frames; f++) {
+        x = x * 1664525 + 1013904223;
+        v[f].ch[0] = f == 0 ? 1.0f : 0.0f;
+        v[f].ch[1] = 1.0f;
+        v[f].ch[2] = static_cast<float>(x >> 8) / (1 << 24) * 2 - 1;
+    }
+    return v;
+}
+
+// y[n] = sum h[k] x[n - k], straight from the definition
+std::vector<Frame> referenceFir(const std::vector<Frame> &in) {
+    std::vector<Frame> out(in.size());
+    for (size_t n = 0; n < in.size(); n++) {
+        for (size_t c = 0; c < CHANNELS; c++) {
+            double y = 0;
+            for (size_t k = 0; k < 5 && k <= n; k++) {
+                y += FIR[k] * in[n - k].ch[c];
+            }
+            out[n].ch[c] = y;
+        }
+    }
+    return out;
+}
+
+// each section in direct form I, in double
+std::vector<Frame> referenceBiquads(const std::vector<Frame> &in) {
+    std::vector<Frame> out(in);
+    for (const auto &k : BIQUADS) {
+        for (size_t c = 0; c < CHANNELS; c++) {
+            double x1 = 0, x2 = 0, y1 = 0, y2 = 0;
+            for (auto &frame : out) {
+                const double x = frame.ch[c];
+                const double y = k.b0 * x + k.b1 * x1 + k.b2 * x2 - k.a1 * y1 - k.a2 * y2;
+                x2 = x1;
+                x1 = x;
+                y2 = y1;
+                y1 = y;
+                frame.ch[c] = y;
+            }
+        }
+    }
+    return out;
+}
+
+float maxError(const std::vector<Frame> &a, const std::vector<Frame> &b) {
+    float e = 0;
+    for (size_t f = 0; f < a.size(); f++) {
+        for (size_t c = 0; c < CHANNELS; c++) {
+            e = fmaxf(e, fabsf(a[f].ch[c] - b[f].ch[c]));
+        }
+    }
+    return e;
+}
+
+// process a signal in blocks of varying size, the first in place
+template<class Filter>
+std::vector<Frame> run(Filter &filter, const std::vector<Frame> &in) {
+    std::vector<Frame> out(in);
+    const size_t blocks[] = {1, 7, 64, 3};
+    size_t f = 0;
+    for (size_t b = 0; f < in.size(); b++) {
+        const auto n = std::min(blocks[b % 4], in.size() - f);
+        if (b == 0) {
+            filter.process(out.data(), out.data(), n);
+        } else {
+            filter.process(in.data() + f, out.data() + f, n);
+        }
+        f += n;
+    }
+    return out;
+}
+
+// impulse gives the taps, step their running sum, noise the direct convolution
+void testFir() {
+    const auto in = signal(300);
+    FirFilter<5, CHANNELS> fir(FIR);
+    const auto out = run(fir, in);
+    float sum = 0;
+    for (size_t n = 0; n < 8; n++) {
+        const auto tap = n < 5 ? FIR[n] : 0.0f;
+        sum += tap;
+        CHECK(out[n].ch[0] == tap);
+        CHECK(fabsf(out[n].ch[1] - sum) < 1e-6f);
+    }
+    CHECK(maxError(out, referenceFir(in)) < 1e-6f);
+
+    // reset() forgets the past
+    fir.reset();
+    std::vector<Frame> zeros(5);
+    fir.process(zeros.data(), zeros.data(), zeros.size());
+    for (const auto &frame : zeros) {
+        CHECK(frame.ch[0] == 0 && frame.ch[1] == 0 && frame.ch[2] == 0);
+    }
+}
+
+// the transposed form matches direct form I, and the step settles at the DC gain
+void testBiquads() {
+    const auto in = signal(2000);
+    BiquadCascade<2, CHANNELS> biquads(BIQUADS);
+    const auto out = run(biquads, in);
+    CHECK(maxError(out, referenceBiquads(in)) < 1e-5f);
+    float dcGain = 1;
+    for (const auto &k : BIQUADS) {
+        dcGain *= (k.b0 + k.b1 + k.b2) / (1 + k.a1 + k.a2);
+    }
+    CHECK(fabsf(out.back().ch[1] - dcGain) < 1e-5f);
+    CHECK(fabsf(out.back().ch[0]) < 1e-6f);
+
+    biquads.reset();
+    std::vector<Frame> again(in.begin(), in.begin() + 100);
+    biquads.process(again.data(), again.data(), again.size());
+    CHECK(maxError(again, std::vector<Frame>(out.begin(), out.begin() + 100)) == 0);
+}
+
+struct Received {
+    std::vector<Frame> frames;
+    size_t batches;
+};
+
+void onFiltered(const Frame *samples, size_t count, void *args) {
+    auto received = static_cast<Received*>(args);
+    received->frames.insert(received->frames.end(), samples, samples + count);
+    received->batches++;
+}
+
+ReadWriteLock lock;
+HistoryDataThing<Frame, 16> raw(lock);
+FilterStage<FirFilter<5, CHANNELS>, CHANNELS, 8> filtered(raw, FIR);
+
+// batches are filtered a block at a time and published on, with history kept at each stage
+void testFilterStage() {
+    Received received = {{}, 0};
+    filtered.registerBatchCallback(onFiltered, &received);
+    uint32_t latest = 0;
+    filtered.registerCallback([](const Frame &/*data*/, void *args) {
+        (*static_cast<uint32_t*>(args))++;
+    }, &latest);
+
+    const auto in = signal(40);
+    raw.publish(in.data(), 0);
+    CHECK_EQ(received.batches, 0u);
+    raw.publish(in.data(), 20);
+    raw.publish(in.data() + 20, 20);
+    // 20 frames are blocks of 8, 8 and 4
+    CHECK_EQ(received.batches, 6u);
+    CHECK_EQ(latest, 6u);
+    CHECK_EQ(raw.sequence(), 40u);
+    CHECK_EQ(filtered.sequence(), 40u);
+    CHECK(maxError(received.frames, referenceFir(in)) < 1e-6f);
+
+    // the stage keeps the last N filtered frames, the source its last 16 raw ones
+    std::vector<Frame> history(16);
+    CHECK_EQ(filtered.readHistory(history.data(), 16), 8u);
+    history.resize(8);
+    CHECK(maxError(history, std::vector<Frame>(received.frames.end() - 8, received.frames.end())) == 0);
+    history.resize(16);
+    CHECK_EQ(raw.readHistory(history.data(), 16), 16u);
+    CHECK(maxError(history, std::vector<Frame>(in.end() - 16, in.end())) == 0);
+
+    // a batch larger than the source's history still reaches the stage whole
+    const auto big = signal(50);
+    received.frames.clear();
+    raw.publish(big.data(), big.size());
+    CHECK_EQ(received.frames.size(), big.size());
+    CHECK_EQ(raw.sequence(), 90u);
+}
+
+}
+
+int main() {
+    testFir();
+    testBiquads();
+    testFilterStage();
+    printf("filter: ok\n");
+    return 0;
+}
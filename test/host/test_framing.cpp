@@ -0,0 +1,134 @@
+#include <Arduino.h>
+#include <vector>
+#include "check.h"
+#include "framing.h"
+
+namespace {
+
+struct Received {
+    std::vector<std::vector<uint8_t>> frames;
+};
+
+void onFrame(const uint8_t *payload, size_t len, void *args) {
+    static_cast<Received*>(args)->frames.emplace_back(payload, payload + len);
+}
+
+template<class Encoder>
+size_t encode(const std::vector<uint8_t> &payload, uint8_t *out, size_t size) {
+    Encoder encoder(out, size);
+    // in two writes, as encodeFrame() callers may do
+    const auto half = payload.size() / 2;
+    encoder.write(payload.data(), half);
+    encoder.write(payload.data() + half, payload.size() - half);
+    return encoder.end();
+}
+
+// encode payloads of every length, feed the frames in chunks of every size, expect them back
+template<class Encoder, class Parser>
+void roundTrip(size_t maxLen) {
+    std::vector<std::vector<uint8_t>> payloads;
+    std::vector<uint8_t> stream;
+    for (size_t len = 0; len <= maxLen; len++) {
+        std::vector<uint8_t> payload(len);
+        for (size_t i = 0; i < len; i++) {
+            // plenty of delimiters and escapes
+            const uint8_t special[] = {0x00, SlipEncoder::END, SlipEncoder::ESC, 0xff};
+            payload[i] = i % 3 ? special[(i + len) % 4] : static_cast<uint8_t>(i * 7 + len);
+        }
+        uint8_t frame[FRAMING_MAX_FRAME];
+        const auto n = encode<Encoder>(payload, frame, sizeof(frame));
+        CHECK(n > 0);
+        stream.insert(stream.end(), frame, frame + n);
+        payloads.push_back(payload);
+    }
+    for (size_t chunk = 1; chunk <= 17; chunk++) {
+        Received received;
+        Parser parser(onFrame, &received);
+        for (size_t i = 0; i < stream.size(); i += chunk) {
+            parser.consume(stream.data() + i, std::min(chunk, stream.size() - i));
+        }
+        CHECK_EQ(parser.errors(), 0u);
+        CHECK(received.frames == payloads);
+    }
+}
+
+void testEmptyFrames() {
+    // the CRC of nothing is 0xffff
+    const uint8_t cobs[] = {0x03, 0xff, 0xff, 0x00};
+    Received received;
+    CobsFrameParser parser(onFrame, &received);
+    parser.consume(cobs, sizeof(cobs));
+    CHECK_EQ(parser.errors(), 0u);
+    CHECK_EQ(received.frames.size(), 1u);
+    CHECK(received.frames[0].empty());
+
+    uint8_t buf[] = {0x03, 0xff, 0xff};
+    CHECK_EQ(cobsDecode(buf, sizeof(buf)), 0);
+    uint8_t slip[] = {0xff, 0xff};
+    CHECK_EQ(slipDecode(slip, sizeof(slip)), 0);
+}
+
+void testErrors() {
+    uint8_t frame[16];
+    const auto n = encode<CobsEncoder>({1, 2, 3}, frame, sizeof(frame));
+    frame[2] ^= 0x10;
+    Received received;
+    CobsFrameParser parser(onFrame, &received);
+    parser.consume(frame, n);
+    CHECK_EQ(parser.errors(), 1u);
+    CHECK(received.frames.empty());
+
+    uint8_t truncated[] = {0x05, 0x01};
+    CHECK_EQ(cobsDecode(truncated, sizeof(truncated)), -1);
+    uint8_t escape[] = {0x01, SlipEncoder::ESC};
+    CHECK_EQ(slipDecode(escape, sizeof(escape)), -1);
+    uint8_t tooShort[] = {0x01};
+    CHECK_EQ(slipDecode(tooShort, sizeof(tooShort)), -1);
+
+    // an overlong frame is an error, the one after it isn't
+    std::vector<uint8_t> stream(FRAMING_MAX_FRAME + 10, 0x55);
+    stream.push_back(0);
+    stream.insert(stream.end(), {0x03, 0xff, 0xff, 0x00});
+    CobsFrameParser overflow(onFrame, &received);
+    overflow.consume(stream.data(), stream.size());
+    CHECK_EQ(overflow.errors(), 1u);
+    CHECK_EQ(received.frames.size(), 1u);
+}
+
+void testEncoderOverflow() {
+    uint8_t frame[8];
+    CHECK_EQ(encode<CobsEncoder>(std::vector<uint8_t>(8, 1), frame, sizeof(frame)), 0u);
+    CHECK_EQ(encode<SlipEncoder>(std::vector<uint8_t>(4, static_cast<uint8_t>(SlipEncoder::END)), frame, sizeof(frame)), 0u);
+}
+
+// buffers too small for any frame, down to none, fail without writing past their end
+template<class Encoder>
+void testTinyBuffers() {
+    for (size_t payloadLen : {0, 1, 3}) {
+        const std::vector<uint8_t> payload(payloadLen, 0x42);
+        for (size_t size = 0; size < 4; size++) {
+            uint8_t guarded[8];
+            memset(guarded, 0xee, sizeof(guarded));
+            CHECK_EQ(encode<Encoder>(payload, guarded + 1, size), 0u);
+            for (auto i = 1 + size; i < sizeof(guarded); i++) {
+                CHECK_EQ(guarded[i], 0xee);
+            }
+            CHECK_EQ(guarded[0], 0xee);
+        }
+    }
+}
+
+}
+
+int main() {
+    // 254 and above cross COBS's block size, the largest payloads fill FRAMING_MAX_FRAME
+    roundTrip<CobsEncoder, CobsFrameParser>(FRAMING_MAX_FRAME - 6);
+    roundTrip<SlipEncoder, SlipFrameParser>(FRAMING_MAX_FRAME / 2 - 4);
+    testEmptyFrames();
+    testErrors();
+    testEncoderOverflow();
+    testTinyBuffers<CobsEncoder>();
+    testTinyBuffers<SlipEncoder>();
+    printf("framing: ok\n");
+    return 0;
+}
@@ -0,0 +1,153 @@
+#include <Arduino.h>
+#include <string>
+#include "check.h"
+#include "logger.h"
+
+namespace {
+
+class Capture : public Print {
+public:
+    size_t write(uint8_t c) override {
+        data += static_cast<char>(c);
+        return 1;
+    }
+    size_t write(const uint8_t *buf, size_t len) override {
+        data.append(reinterpret_cast<const char*>(buf), len);
+        return len;
+    }
+    using Print::write;
+
+    std::string data;
+};
+
+LoggerClass logger;
+
+std::string decode(const std::string &binary) {
+    Capture text;
+    LogDecoder decoder(text);
+    decoder.consume(reinterpret_cast<const uint8_t*>(binary.data()), binary.size());
+    CHECK_EQ(decoder.errors(), 0u);
+    return text.data;
+}
+
+void logSome() {
+    logger.log("plain\n");
+    logger.log("%d %u %x %5.2f %c\n", -42, 42u, 0xbeef, 3.25f, 'z');
+    logger.log(&logger, "from %s at %p, %-8s|\n", "here", reinterpret_cast<void*>(0x1234), "pad");
+    logger.log("%s and %s, %d%%\n", "first", static_cast<const char*>(nullptr), 99);
+    logger.log("%lu %hd %s\n", static_cast<uint32_t>(7), static_cast<short>(-3), "end");
+}
+
+std::string run(LoggerClass::Format format) {
+    Capture out;
+    logger.setOutput(out, format);
+    logSome();
+    logger.flush();
+    return out.data;
+}
+
+// decoding BINARY output gives what TEXT output prints
+void testRoundTrip() {
+    const auto text = run(LoggerClass::TEXT);
+    CHECK(text.find("-42 42 beef  3.25 z\n") != std::string::npos);
+    CHECK(text.find("[Logger] from here at ") != std::string::npos);
+    CHECK(text.find("pad     |\n") != std::string::npos);
+    const auto binary = run(LoggerClass::BINARY);
+    CHECK(binary.find("-42") == std::string::npos);
+    CHECK(decode(binary) == text);
+}
+
+// formats and names are sent once per output
+void testDefinitionsOnce() {
+    Capture out;
+    logger.setOutput(out, LoggerClass::BINARY);
+    logSome();
+    logger.flush();
+    const auto first = out.data.size();
+    logSome();
+    logger.flush();
+    const auto second = out.data.size() - first;
+    CHECK(second < first);
+    CHECK(out.data.find("%5.2f", first) == std::string::npos);
+    CHECK(out.data.find("Logger", first) == std::string::npos);
+    const auto decoded = decode(out.data);
+    CHECK_EQ(decoded.size() % 2, 0u);
+    CHECK(decoded.substr(0, decoded.size() / 2) == decoded.substr(decoded.size() / 2));
+
+    // a decoder joining late shows ids for what it missed
+    const auto late = decode(out.data.substr(first));
+    CHECK(late.find("<format ") != std::string::npos);
+    CHECK(late.find("[#") != std::string::npos);
+}
+
+// more formats than ids: the table starts over and redefines
+void testManyFormats() {
+    const auto count = 3 * LOGGER_MAX_FORMATS;
+    static char formats[count][16];
+    for (auto i = 0; i < count; i++) {
+        snprintf(formats[i], sizeof(formats[i]), "fmt %d: %%d\n", i);
+    }
+    std::string texts[2];
+    for (auto format : {LoggerClass::TEXT, LoggerClass::BINARY}) {
+        Capture out;
+        logger.setOutput(out, format);
+        for (auto round = 0; round < 2; round++) {
+            for (auto i = 0; i < count; i++) {
+                logger.log(formats[(i * 7) % count], i);
+                if (i % 32 == 0) {
+                    logger.flush();
+                }
+            }
+            logger.flush();
+        }
+        texts[format] = out.data;
+    }
+    CHECK(decode(texts[LoggerClass::BINARY]) == texts[LoggerClass::TEXT]);
+}
+
+// long strings are cut to fit a frame, dropped messages are reported
+void testLimits() {
+    std::string longString(1000, 'x');
+    Capture out;
+    logger.setOutput(out, LoggerClass::BINARY);
+    logger.log("%s|%d\n", longString.c_str(), 5);
+    for (auto i = 0; i < LOGGER_RING_SIZE + 10; i++) {
+        logger.log("%d\n", i);
+    }
+    logger.flush();
+    const auto text = decode(out.data);
+    const auto bar = text.find('|');
+    CHECK(bar > 100 && bar < 256);
+    CHECK(text.compare(bar, 3, "|5\n") == 0);
+    CHECK(text.find("[logger dropped 11 messages]\n") != std::string::npos);
+}
+
+// a corrupted frame is counted and skipped
+void testCorruption() {
+    Capture out;
+    logger.setOutput(out, LoggerClass::BINARY);
+    logger.log("one %d\n", 1);
+    logger.log("two %d\n", 2);
+    logger.flush();
+    auto binary = out.data;
+    binary[binary.size() - 3] ^= 0x55;
+    Capture text;
+    LogDecoder decoder(text);
+    decoder.consume(reinterpret_cast<const uint8_t*>(binary.data()), binary.size());
+    CHECK_EQ(decoder.errors(), 1u);
+    CHECK(text.data == "one 1\n");
+}
+
+}
+
+int main() {
+    CHECK_EQ(logger.setup(), BaseSubsystem::READY);
+    CHECK(logger.getId() != BaseSubsystem::NO_ID);
+    testRoundTrip();
+    testDefinitionsOnce();
+    testManyFormats();
+    testLimits();
+    testCorruption();
+    printf("logger: ok\n");
+    return 0;
+}
@@ -0,0 +1,131 @@
+#include <Arduino.h>
+#include "check.h"
+#include "matrix.h"
+
+namespace {
+
+template<size_t R, size_t C>
+float maxError(const Matrix<R, C> &a, const Matrix<R, C> &b) {
+    float e = 0;
+    for (size_t r = 0; r < R; r++) {
+        for (size_t c = 0; c < C; c++) {
+            e = fmaxf(e, fabsf(a.m[r][c] - b.m[r][c]));
+        }
+    }
+    return e;
+}
+
+void testMultiply() {
+    const Matrix<2, 3> a = {{{1, 2, 3}, {4, 5, 6}}};
+    const Matrix<3, 2> b = {{{7, 8}, {9, 10}, {11, 12}}};
+    const Matrix<2, 2> ab = {{{58, 64}, {139, 154}}};
+    Matrix<2, 2> out;
+    multiply(a, b, out);
+    CHECK(maxError(out, ab) == 0);
+    CHECK(maxError(a * b, ab) == 0);
+
+    // a * transpose(b') with b' = transpose(b)
+    multiplyTransposed(a, b.transposed(), out);
+    CHECK(maxError(out, ab) == 0);
+
+    const auto i3 = Matrix<3, 3>::identity();
+    CHECK(maxError(a * i3, a) == 0);
+    CHECK(maxError(a * 2.0f, a + a) == 0);
+    CHECK(maxError(a - a, Matrix<2, 3>::zeros()) == 0);
+}
+
+void testInvert() {
+    // det 1, an integer inverse
+    const Matrix<3, 3> a = {{{1, 2, 3}, {0, 1, 4}, {5, 6, 0}}};
+    const Matrix<3, 3> expected = {{{-24, 18, 5}, {20, -15, -4}, {-5, 4, 1}}};
+    Matrix<3, 3> inv, scratch;
+    CHECK(invert(a, inv, scratch));
+    CHECK(maxError(inv, expected) < 1e-4f);
+    CHECK(maxError(a * inv, Matrix<3, 3>::identity()) < 1e-5f);
+
+    // needs a row swap: the first pivot is 0
+    const Matrix<2, 2> swap = {{{0, 2}, {4, 0}}};
+    const Matrix<2, 2> swapInv = {{{0, 0.25f}, {0.5f, 0}}};
+    Matrix<2, 2> inv2, scratch2;
+    CHECK(invert(swap, inv2, scratch2));
+    CHECK(maxError(inv2, swapInv) == 0);
+
+    // singular: the third row is the sum of the first two, also when scaled down
+    Matrix<3, 3> singular = {{{1, 2, 3}, {4, 5, 6}, {5, 7, 9}}};
+    CHECK(!invert(singular, inv, scratch));
+    singular *= 1e-20f;
+    CHECK(!invert(singular, inv, scratch));
+    CHECK(!invert(Matrix<3, 3>::zeros(), inv, scratch));
+}
+
+void testCholesky() {
+    const Matrix<3, 3> a = {{{4, 12, -16}, {12, 37, -43}, {-16, -43, 98}}};
+    const Matrix<3, 3> expected = {{{2, 0, 0}, {6, 1, 0}, {-8, 5, 3}}};
+    Matrix<3, 3> l;
+    CHECK(cholesky(a, l));
+    CHECK(maxError(l, expected) < 1e-5f);
+    CHECK(maxError(l * l.transposed(), a) < 1e-4f);
+
+    // a * x = b with x = (1, -2, 3)
+    const Vector<3> x = {{{1}, {-2}, {3}}};
+    const auto b = a * x;
+    Vector<3> solved;
+    choleskySolve(l, b, solved);
+    CHECK(maxError(solved, x) < 1e-4f);
+
+    // in place, and with the identity as right hand side it inverts
+    auto inPlace = b;
+    choleskySolve(l, inPlace, inPlace);
+    CHECK(maxError(inPlace, x) < 1e-4f);
+    Matrix<3, 3> inv;
+    choleskySolve(l, Matrix<3, 3>::identity(), inv);
+    CHECK(maxError(a * inv, Matrix<3, 3>::identity()) < 1e-4f);
+
+    // l may alias a
+    auto aliased = a;
+    CHECK(cholesky(aliased, aliased));
+    CHECK(maxError(aliased, expected) < 1e-5f);
+}
+
+// symmetric but not positive definite, or only semidefinite, fails
+void testNotPositiveDefinite() {
+    Matrix<3, 3> l;
+    const Matrix<3, 3> indefinite = {{{1, 2, 0}, {2, 1, 0}, {0, 0, 1}}};
+    CHECK(!cholesky(indefinite, l));
+    const Matrix<3, 3> semidefinite = {{{1, 1, 0}, {1, 1, 0}, {0, 0, 1}}};
+    CHECK(!cholesky(semidefinite, l));
+    auto negative = Matrix<3, 3>::identity();
+    negative.m[2][2] = -1;
+    CHECK(!cholesky(negative, l));
+    Matrix<3, 3> nan = Matrix<3, 3>::identity();
+    nan.m[0][0] = NAN;
+    CHECK(!cholesky(nan, l));
+}
+
+// the fast path agrees with the operators and keeps p exactly symmetric
+void testPropagateCovariance() {
+    Matrix<4, 4> p, f, q, scratch;
+    for (size_t r = 0; r < 4; r++) {
+        for (size_t c = 0; c < 4; c++) {
+            f.m[r][c] = r == c ? 1 : 0.1f * (r + 2 * c);
+            p.m[r][c] = r == c ? 4 : 1.0f / (1 + r + c);
+            q.m[r][c] = r == c ? 0.01f : 0;
+        }
+    }
+    const auto expected = f * p * f.transposed() + q;
+    propagateCovariance(p, f, q, scratch);
+    CHECK(maxError(p, expected) < 1e-4f);
+    CHECK(maxError(p, p.transposed()) == 0);
+}
+
+}
+
+int main() {
+    testMultiply();
+    testInvert();
+    testCholesky();
+    testNotPositiveDefinite();
+    testPropagateCovariance();
+    printf("matrix: ok\n");
+    return 0;
+}
@@ -0,0 +1,167 @@
+#include <Arduino.h>
+#include <atomic>
+#include <sys/socket.h>
+#include "check.h"
+#include "mirror.h"
+#include "uartingest.h"
+
+namespace {
+
+struct Gps {
+    int32_t lat;
+    int32_t lon;
+    float alt;
+    uint32_t fix;
+    uint8_t satellites[48];
+};
+
+// between the sender and its UART: drops whole frames while asked to, notes the smallest sent
+class LossyLink : public Print {
+public:
+    LossyLink(Print &out) : out(out), dropping(false), smallest(0) {}
+
+    size_t write(uint8_t c) override {
+        return write(&c, 1);
+    }
+
+    // MirrorSender writes each frame with one call
+    size_t write(const uint8_t *buf, size_t len) override {
+        if (dropping) {
+            return len;
+        }
+        if (smallest == 0 || len < smallest) {
+            smallest = len;
+        }
+        return out.write(buf, len);
+    }
+
+    Print &out;
+    std::atomic<bool> dropping;
+    std::atomic<size_t> smallest;
+};
+
+// the two ends of a serial link
+HardwareSerial uart0, uart1;
+LossyLink link(uart0);
+
+ReadWriteLock lock;
+DataThing<Gps> gps(lock);
+DataThing<float> baro(lock);
+DataThing<Gps> gpsReplica(lock);
+DataThing<float> baroReplica(lock);
+
+// a keyframe every 20 frames of 5 ms
+MirrorSender sender("mirrorTx", link, pdMS_TO_TICKS(5), 20);
+MirrorReceiver receiver;
+StreamParser *parsers[] = {&receiver, nullptr};
+UartIngest ingest("mirrorRx", uart1, parsers);
+
+template<class T>
+T read(const DataThing<T> &thing) {
+    T out;
+    thing.readData([](const T &data, void *args) {
+        *static_cast<T*>(args) = data;
+    }, &out);
+    return out;
+}
+
+template<class T>
+void write(DataThing<T> &thing, const T &value) {
+    thing.accessData([](T &data, void *args) {
+        data = *static_cast<const T*>(args);
+    }, const_cast<T*>(&value));
+}
+
+template<class T>
+bool same(const DataThing<T> &a, const DataThing<T> &b) {
+    const auto x = read(a);
+    const auto y = read(b);
+    return memcmp(&x, &y, sizeof(T)) == 0;
+}
+
+// the replica catches up within a second
+bool converges() {
+    for (auto i = 0; i < 1000; i++) {
+        if (same(gps, gpsReplica) && same(baro, baroReplica)) {
+            return true;
+        }
+        delay(1);
+    }
+    return false;
+}
+
+Gps fix(int32_t n) {
+    Gps g = {};
+    g.lat = 473977000 + n;
+    g.lon = 85456000 - n;
+    g.alt = 400.0f + n;
+    g.fix = 3;
+    for (size_t i = 0; i < sizeof(g.satellites); i++) {
+        g.satellites[i] = static_cast<uint8_t>(i * n);
+    }
+    return g;
+}
+
+void testSetup() {
+    int fds[2];
+    CHECK(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+    CHECK(uart0.open(fds[0]));
+    CHECK(uart1.open(fds[1]));
+    CHECK(sender.mirror(1, gps));
+    CHECK(sender.mirror(2, baro));
+    CHECK(receiver.mirror(1, gpsReplica));
+    CHECK(receiver.mirror(2, baroReplica));
+    CHECK_EQ(SubsystemManager.setup(), BaseSubsystem::READY);
+    CHECK_EQ(SubsystemManager.start(), BaseSubsystem::RUNNING);
+}
+
+// changes cross the link, a small change in a small frame
+void testMirror() {
+    write(gps, fix(1));
+    write(baro, 1013.25f);
+    CHECK(converges());
+    CHECK(receiver.framesReceived() > 0);
+    CHECK_EQ(receiver.framesLost(), 0u);
+
+    auto g = fix(1);
+    g.fix = 2;
+    link.smallest = 0;
+    write(gps, g);
+    CHECK(converges());
+    // header, one record and one 2 byte chunk, COBS encoded, far from the 64 byte thing
+    CHECK(link.smallest > 0 && link.smallest < 32);
+
+    for (auto n = 2; n < 50; n++) {
+        write(gps, fix(n));
+        write(baro, 1000.0f + n);
+        delay(1);
+    }
+    CHECK(converges());
+    CHECK(sender.bytesSent() > 0);
+    CHECK(receiver.staleness().count() > 0);
+}
+
+// lost frames are counted, and the next keyframe repairs the replica
+void testLoss() {
+    const auto lost = receiver.framesLost();
+    link.dropping = true;
+    write(gps, fix(100));
+    write(baro, 900.0f);
+    delay(20);
+    CHECK(!same(gps, gpsReplica));
+    link.dropping = false;
+    // nothing changes from here, only a keyframe brings the replica up to date
+    CHECK(converges());
+    delay(50);
+    CHECK(receiver.framesLost() > lost);
+}
+
+}
+
+int main() {
+    testSetup();
+    testMirror();
+    testLoss();
+    printf("mirror: ok\n");
+    return 0;
+}
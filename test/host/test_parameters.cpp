@@ -0,0 +1,143 @@
+#include <Arduino.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "check.h"
+#include "parameters.h"
+
+namespace {
+
+// every field holds the number of updates applied, so a torn read shows as a mismatch
+struct Gains {
+    uint32_t kp;
+    uint32_t ki;
+    uint32_t kd;
+    float limit;
+    uint32_t updates;
+};
+
+const Gains DEFAULTS = {0, 0, 0, 0.0f, 0};
+
+void increment(Gains &g, void */*args*/) {
+    g.updates++;
+    g.kp = g.updates;
+    g.ki = g.updates;
+    g.kd = g.updates;
+    g.limit = static_cast<float>(g.updates);
+}
+
+bool consistent(const Gains &g) {
+    return g.kp == g.updates && g.ki == g.updates && g.kd == g.updates && g.limit == static_cast<float>(g.updates);
+}
+
+// readers never see a torn block, versions only go up and match the updates applied
+void testConcurrentReadWrite() {
+    ParameterStore<Gains> store(DEFAULTS);
+    const auto WRITERS = 2;
+    const auto UPDATES = 20000;
+    std::atomic<bool> writing(true);
+    std::atomic<uint32_t> reads(0), failures(0);
+
+    std::vector<std::thread> readers;
+    for (auto r = 0; r < 3; r++) {
+        readers.emplace_back([&]() {
+            uint32_t last = 0;
+            while (writing) {
+                auto g = store.read();
+                if (!consistent(*g) || g.version() != g->updates || g.version() < last) {
+                    failures++;
+                }
+                last = g.version();
+                reads++;
+            }
+        });
+    }
+    std::vector<std::thread> writers;
+    for (auto w = 0; w < WRITERS; w++) {
+        writers.emplace_back([&]() {
+            for (auto i = 0; i < UPDATES; i++) {
+                store.update(increment, nullptr);
+            }
+        });
+    }
+    for (auto &t : writers) {
+        t.join();
+    }
+    writing = false;
+    for (auto &t : readers) {
+        t.join();
+    }
+    printf("  %u reads during %u updates\n", reads.load(), WRITERS * UPDATES);
+    CHECK_EQ(failures.load(), 0u);
+    CHECK_EQ(store.version(), static_cast<uint32_t>(WRITERS * UPDATES));
+    CHECK_EQ(store.read()->updates, static_cast<uint32_t>(WRITERS * UPDATES));
+}
+
+// a reader held across updates keeps its block, set() bumps the version
+void testHeldReader() {
+    ParameterStore<Gains> store(DEFAULTS);
+    CHECK_EQ(store.version(), 0u);
+    auto held = store.read();
+    for (auto i = 0; i < 10; i++) {
+        store.update(increment, nullptr);
+    }
+    CHECK_EQ(held.version(), 0u);
+    CHECK_EQ(held->updates, 0u);
+    CHECK_EQ(store.version(), 10u);
+
+    Gains g = {1, 2, 3, 4.0f, 5};
+    store.set(g);
+    CHECK_EQ(store.version(), 11u);
+    CHECK_EQ(store.read()->kd, 3u);
+    CHECK_EQ(held->kd, 0u);
+}
+
+// save() and load() round trip through NVS, and bad blobs leave the parameters alone
+void testPersistence() {
+    Preferences prefs;
+    CHECK(prefs.begin("params"));
+    prefs.clear();
+
+    ParameterStore<Gains> saved(DEFAULTS);
+    for (auto i = 0; i < 7; i++) {
+        saved.update(increment, nullptr);
+    }
+    CHECK(saved.save(prefs, "gains"));
+
+    ParameterStore<Gains> loaded(DEFAULTS);
+    CHECK(!loaded.load(prefs, "missing"));
+    CHECK(loaded.load(prefs, "gains"));
+    CHECK_EQ(loaded.version(), 7u);
+    CHECK(consistent(*loaded.read()));
+    CHECK_EQ(loaded.read()->updates, 7u);
+
+    // the image is the header followed by the struct
+    const auto size = prefs.getBytesLength("gains");
+    CHECK_EQ(size, sizeof(ParameterImageHeader) + sizeof(Gains));
+    std::vector<uint8_t> image(size);
+    CHECK_EQ(prefs.getBytes("gains", image.data(), size), size);
+    ParameterImageHeader header;
+    memcpy(&header, image.data(), sizeof(header));
+    CHECK_EQ(header.magic, ParameterImageHeader::MAGIC);
+    CHECK_EQ(header.version, 7u);
+
+    ParameterStore<Gains> untouched(DEFAULTS);
+    image[sizeof(header) + 1] ^= 1;
+    prefs.putBytes("corrupt", image.data(), image.size());
+    CHECK(!untouched.load(prefs, "corrupt"));
+    prefs.putBytes("short", image.data(), image.size() - 1);
+    CHECK(!untouched.load(prefs, "short"));
+    CHECK_EQ(untouched.version(), 0u);
+    CHECK_EQ(untouched.read()->updates, 0u);
+    prefs.end();
+}
+
+}
+
+int main() {
+    testConcurrentReadWrite();
+    testHeldReader();
+    testPersistence();
+    printf("parameters: ok\n");
+    return 0;
+}
@@ -0,0 +1,105 @@
+#include <Arduino.h>
+#include <vector>
+#include "check.h"
+#include "pipeline.h"
+
+namespace {
+
+void publish(DataThing<int> &thing, int value) {
+    thing.accessData([](int &data, void *args) {
+        data = *static_cast<int*>(args);
+    }, &value);
+}
+
+template<class T>
+void record(const T &value, void *args) {
+    static_cast<std::vector<T>*>(args)->push_back(value);
+}
+
+// oldest first, before and after the ring wraps
+void testWindow() {
+    PipeWindow<int, 3> w;
+    CHECK_EQ(w.size(), 0u);
+    CHECK_EQ(w.mean(), 0);
+    w.add(1);
+    w.add(2);
+    CHECK(!w.full());
+    CHECK_EQ(w[0], 1);
+    CHECK_EQ(w[1], 2);
+    CHECK_EQ(w.mean(), 1);
+    for (auto v : {3, 4, 5, 6, 7}) {
+        w.add(v);
+    }
+    CHECK(w.full());
+    CHECK_EQ(w[0], 5);
+    CHECK_EQ(w[1], 6);
+    CHECK_EQ(w[2], 7);
+    CHECK_EQ(w.mean(), 6);
+}
+
+ReadWriteLock lock;
+DataThing<int> raw(lock);
+DataThing<float> smoothed(lock);
+DataThing<int> alarms(lock);
+
+// raw -> drop negatives -> scale -> running sum -> mean of the last 3 -> every 2nd -> smoothed
+auto smoothing = makePipeline(smoothed,
+    pipeFilter([](const int &v) { return v >= 0; }),
+    pipeMap([](const int &v) { return 2 * v; }),
+    pipeScan(0, [](int acc, const int &v) { return acc + v; }),
+    pipeWindow<int, 3>(),
+    pipeMap([](const PipeWindow<int, 3> &w) { return static_cast<float>(w[0] + w[1] + w[2]) / 3; }),
+    pipeDecimate<2>());
+
+// a second stage fed by the first: count the smoothed values above a threshold
+auto alarming = makePipeline(alarms,
+    pipeFilter([](const float &v) { return v > 20; }),
+    pipeScan(0, [](int n, const float &/*v*/) { return n + 1; }));
+
+// values pass every operator in order and only what reaches a sink is published there
+void testChain() {
+    smoothing.attach(raw);
+    alarming.attach(smoothed);
+    std::vector<float> out;
+    smoothed.registerCallback(record<float>, &out);
+    std::vector<int> counted;
+    alarms.registerCallback(record<int>, &counted);
+
+    // reference: the same steps written out
+    std::vector<float> expected;
+    std::vector<int> sums;
+    int sum = 0, passed = 0;
+    for (auto v : {1, -5, 2, 3, -1, 4, 5, 6, 7, -2, 8}) {
+        publish(raw, v);
+        if (v < 0) {
+            continue;
+        }
+        sum += 2 * v;
+        sums.push_back(sum);
+        if (sums.size() >= 3 && ++passed % 2 == 0) {
+            const auto n = sums.size();
+            expected.push_back(static_cast<float>(sums[n - 3] + sums[n - 2] + sums[n - 1]) / 3);
+        }
+    }
+    CHECK_EQ(out.size(), expected.size());
+    CHECK_EQ(out.size(), 3u);
+    for (size_t i = 0; i < out.size(); i++) {
+        CHECK(out[i] == expected[i]);
+    }
+
+    int above = 0;
+    for (auto v : expected) {
+        above += v > 20;
+    }
+    CHECK_EQ(counted.size(), static_cast<size_t>(above));
+    CHECK_EQ(counted.back(), above);
+}
+
+}
+
+int main() {
+    testWindow();
+    testChain();
+    printf("pipeline: ok\n");
+    return 0;
+}
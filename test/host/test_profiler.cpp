@@ -0,0 +1,124 @@
+#include <Arduino.h>
+#include <string>
+#include "check.h"
+#include "profiler.h"
+
+#ifdef SUBSYSTEM_PROFILER
+
+namespace {
+
+class Capture : public Print {
+public:
+    size_t write(uint8_t c) override {
+        data += static_cast<char>(c);
+        return 1;
+    }
+    using Print::write;
+
+    std::string data;
+};
+
+volatile bool spinning = true;
+
+void __attribute__((noinline)) spin() {
+    while (spinning) {
+        for (volatile int i = 0; i < 1000; i++) {
+        }
+    }
+}
+
+// burns CPU in a labelled zone until told to stop
+class Spinner : public ThreadedSubsystem {
+public:
+    Spinner() {
+        name = "spinner";
+    }
+
+    Status setup() override {
+        setStatus(READY);
+        return READY;
+    }
+
+protected:
+    void taskFunction(void */*parameter*/) override {
+        {
+            ProfileZone zone(this, "spin");
+            spin();
+        }
+        for (;;) {
+            vTaskDelay(1000);
+        }
+    }
+};
+
+Spinner spinner;
+SubsystemManagerClass::Spec spec(&spinner, nullptr);
+
+// SIGPROF drives the tick hook: the busy task gets the samples, with its zone and PC
+void testSampling() {
+    CHECK(Profiler.start());
+    CHECK_EQ(spinner.start(), BaseSubsystem::RUNNING);
+    // main sleeps, so the CPU time is the spinner's
+    delay(600);
+    Profiler.stop();
+    spinning = false;
+
+    Capture out;
+    Profiler.printFolded(out);
+    uint32_t total = 0, inZone = 0, inSpin = 0;
+    size_t pos = 0;
+    while (pos < out.data.size()) {
+        const auto end = out.data.find('\n', pos);
+        const auto line = out.data.substr(pos, end - pos);
+        pos = end + 1;
+        const auto space = line.rfind(' ');
+        CHECK(space != std::string::npos);
+        const auto count = strtoul(line.c_str() + space + 1, nullptr, 10);
+        total += count;
+        if (line.compare(0, 18, "core0;spinner;spin") != 0) {
+            continue;
+        }
+        inZone += count;
+        const auto pc = line.find(";0x");
+        CHECK(pc != std::string::npos);
+        const auto address = strtoull(line.c_str() + pc + 1, nullptr, 16);
+        if (address - reinterpret_cast<uintptr_t>(&spin) < 256) {
+            inSpin += count;
+        }
+    }
+    printf("  %u samples, %u in the zone, %u of them in spin()\n", (unsigned)total, (unsigned)inZone, (unsigned)inSpin);
+    CHECK(total >= 50);
+    CHECK(inZone * 10 >= total * 9);
+    CHECK(inSpin * 10 >= inZone * 9);
+}
+
+// nothing is sampled once stopped
+void testStop() {
+    Profiler.reset();
+    spinning = true;
+    const auto until = millis() + 100;
+    while (millis() < until) {
+    }
+    spinning = false;
+    Capture out;
+    Profiler.printFolded(out);
+    CHECK(out.data.empty());
+}
+
+}
+
+int main() {
+    testSampling();
+    testStop();
+    printf("profiler: ok\n");
+    return 0;
+}
+
+#else
+
+int main() {
+    printf("profiler: skipped, needs SUBSYSTEM_PROFILER\n");
+    return 0;
+}
+
+#endif
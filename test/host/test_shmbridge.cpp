@@ -0,0 +1,235 @@
+#include <Arduino.h>
+#include <atomic>
+#include <thread>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include "check.h"
+#include "shmbridge.h"
+
+/*
+ * Plays the simulator through a second mapping of the segment
+ */
+
+namespace {
+
+struct Servo {
+    uint32_t words[256]; ///< all equal, so a torn value shows
+};
+
+struct Imu {
+    float accel[3];
+    uint32_t count;
+};
+
+class Simulator {
+public:
+    Simulator(const char *name) {
+        const auto fd = shm_open(name, O_RDWR, 0);
+        CHECK(fd >= 0);
+        size = lseek(fd, 0, SEEK_END);
+        base = static_cast<uint8_t*>(mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0));
+        close(fd);
+        CHECK(base != MAP_FAILED);
+    }
+
+    ~Simulator() {
+        munmap(base, size);
+    }
+
+    const ShmBridgeHeader &header() const {
+        return *reinterpret_cast<const ShmBridgeHeader*>(base);
+    }
+
+    const ShmBridgeEntry &entry(const char *name) const {
+        const auto entries = reinterpret_cast<const ShmBridgeEntry*>(&header() + 1);
+        for (auto i = 0; i < header().numEntries; i++) {
+            if (strcmp(entries[i].name, name) == 0) {
+                return entries[i];
+            }
+        }
+        CHECK(false);
+        return entries[0];
+    }
+
+    std::atomic<uint32_t> &sequence(const ShmBridgeEntry &e) {
+        return *reinterpret_cast<std::atomic<uint32_t>*>(base + e.offset);
+    }
+
+    // the seqlock read described in shmbridge.h
+    template<class T>
+    bool read(const char *name, T &value, uint32_t &seq) {
+        const auto &e = entry(name);
+        for (;;) {
+            const auto before = sequence(e).load(std::memory_order_acquire);
+            if (before & 1) {
+                continue;
+            }
+            memcpy(&value, base + e.offset + 8, sizeof(T));
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (sequence(e).load(std::memory_order_relaxed) == before) {
+                seq = before;
+                return before != 0;
+            }
+        }
+    }
+
+    template<class T>
+    void write(const char *name, const T &value) {
+        const auto &e = entry(name);
+        const auto s = sequence(e).load(std::memory_order_relaxed);
+        sequence(e).store(s + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        memcpy(base + e.offset + 8, &value, sizeof(T));
+        sequence(e).store(s + 2, std::memory_order_release);
+    }
+
+private:
+    uint8_t *base;
+    size_t size;
+};
+
+const char *const SEGMENT = "/ldrc-test-shmbridge";
+
+Servo servoOf(uint32_t v) {
+    Servo s;
+    for (auto &w : s.words) {
+        w = v;
+    }
+    return s;
+}
+
+void publish(DataThing<Servo> &thing, uint32_t v) {
+    thing.accessData([](Servo &data, void *args) {
+        data = servoOf(*static_cast<uint32_t*>(args));
+    }, &v);
+}
+
+Imu imported(const DataThing<Imu> &thing) {
+    Imu out;
+    thing.readData([](const Imu &data, void *args) {
+        *static_cast<Imu*>(args) = data;
+    }, &out);
+    return out;
+}
+
+void testRoundTrip() {
+    ReadWriteLock servoLock, imuLock;
+    DataThing<Servo> servo(servoLock);
+    DataThing<Imu> imu(imuLock);
+    ShmBridge bridge(SEGMENT);
+    CHECK(bridge.exportThing("servo", servo));
+    CHECK(bridge.importThing("imu", imu));
+    CHECK(bridge.open());
+    CHECK(!bridge.exportThing("late", servo));
+
+    Simulator sim(SEGMENT);
+    CHECK_EQ(sim.header().magic, ShmBridgeHeader::MAGIC);
+    CHECK_EQ(sim.header().numEntries, 2);
+    CHECK_EQ(sim.entry("servo").direction, ShmBridgeEntry::EXPORT);
+    CHECK_EQ(sim.entry("servo").size, sizeof(Servo));
+    CHECK_EQ(sim.entry("imu").direction, ShmBridgeEntry::IMPORT);
+    CHECK_EQ(sim.entry("servo").offset % 64, 0u);
+
+    Servo s;
+    uint32_t seq;
+    CHECK(!sim.read("servo", s, seq));
+    publish(servo, 42);
+    CHECK(sim.read("servo", s, seq));
+    CHECK_EQ(s.words[0], 42u);
+    CHECK_EQ(seq, 2u);
+
+    CHECK_EQ(bridge.poll(), 0);
+    sim.write("imu", Imu{{1, 2, 9.81f}, 7});
+    CHECK_EQ(bridge.poll(), 1);
+    CHECK_EQ(bridge.poll(), 0);
+    CHECK_EQ(imported(imu).count, 7u);
+    CHECK_EQ(imported(imu).accel[2], 9.81f);
+}
+
+// a bridge reopening the segment with the same layout keeps what the simulator wrote
+void testReopen() {
+    {
+        Simulator sim(SEGMENT);
+        sim.write("imu", Imu{{0, 0, 0}, 8});
+    }
+    ReadWriteLock servoLock, imuLock;
+    DataThing<Servo> servo(servoLock);
+    DataThing<Imu> imu(imuLock);
+    ShmBridge bridge(SEGMENT);
+    CHECK(bridge.exportThing("servo", servo));
+    CHECK(bridge.importThing("imu", imu));
+    CHECK(bridge.open());
+    CHECK_EQ(bridge.poll(), 1);
+    CHECK_EQ(imported(imu).count, 8u);
+
+    Simulator sim(SEGMENT);
+    Servo s;
+    uint32_t seq;
+    CHECK(sim.read("servo", s, seq));
+    CHECK_EQ(s.words[0], 42u);
+
+    // a different layout replaces it
+    ReadWriteLock otherLock;
+    DataThing<Imu> other(otherLock);
+    ShmBridge changed(SEGMENT);
+    CHECK(changed.importThing("other", other));
+    CHECK(changed.open());
+    CHECK_EQ(sim.header().numEntries, 1);
+    CHECK_EQ(changed.poll(), 0);
+}
+
+// publishers in several tasks export one thing at once, the simulator never sees a torn value
+void testConcurrentWriters() {
+    ReadWriteLock servoLock;
+    DataThing<Servo> servo(servoLock);
+    ShmBridge bridge(SEGMENT);
+    CHECK(bridge.exportThing("servo", servo));
+    CHECK(bridge.open());
+
+    const uint32_t WRITES = 20000;
+    std::atomic<int> running(4);
+    std::thread writers[4];
+    for (uint32_t w = 0; w < 4; w++) {
+        writers[w] = std::thread([&servo, &running, w]() {
+            for (uint32_t i = 0; i < WRITES; i++) {
+                publish(servo, w * WRITES + i);
+            }
+            running--;
+        });
+    }
+    Simulator sim(SEGMENT);
+    uint32_t reads = 0;
+    while (running > 0) {
+        Servo s;
+        uint32_t seq;
+        if (sim.read("servo", s, seq)) {
+            for (auto w : s.words) {
+                CHECK_EQ(w, s.words[0]);
+            }
+            reads++;
+        }
+    }
+    for (auto &w : writers) {
+        w.join();
+    }
+    Servo s;
+    uint32_t seq;
+    CHECK(sim.read("servo", s, seq));
+    // every write bumped the sequence by 2, none was lost to a race
+    CHECK_EQ(seq, 4 * WRITES * 2);
+    printf("  %u consistent reads during %u writes\n", reads, 4 * WRITES);
+}
+
+}
+
+int main() {
+    shm_unlink(SEGMENT);
+    testRoundTrip();
+    testReopen();
+    shm_unlink(SEGMENT);
+    testConcurrentWriters();
+    shm_unlink(SEGMENT);
+    printf("shmbridge: ok\n");
+    return 0;
+}
@@ -0,0 +1,77 @@
+#include <Arduino.h>
+#include "check.h"
+#include "subsystem.h"
+
+namespace {
+
+// touches depth bytes of its stack once, then idles
+class StackUser : public ThreadedSubsystem {
+public:
+    StackUser(const char *n, size_t depth) : depth(depth), done(false) {
+        name = n;
+    }
+
+    Status setup() override {
+        setStatus(READY);
+        return READY;
+    }
+
+    bool finished() const { return done; }
+
+protected:
+    void taskFunction(void */*parameter*/) override {
+        if (depth) {
+            use(depth);
+        }
+        done = true;
+        for (;;) {
+            vTaskDelay(1000);
+        }
+    }
+
+private:
+    static void __attribute__((noinline)) use(size_t depth) {
+        volatile uint8_t buf[3072];
+        for (size_t i = 0; i < depth && i < sizeof(buf); i++) {
+            buf[i] = i;
+        }
+    }
+
+    const size_t depth;
+    volatile bool done;
+};
+
+void waitFor(const StackUser &s) {
+    for (auto i = 0; i < 2000 && !s.finished(); i++) {
+        delay(1);
+    }
+    CHECK(s.finished());
+}
+
+// the painted host stack shows what the task used, and the sizing follows it
+void testHighWaterMark() {
+    StackUser idle("idle", 0), busy("busy", 3072);
+    CHECK_EQ(idle.stackHighWaterMark(), 0u);
+    CHECK_EQ(idle.start(), BaseSubsystem::RUNNING);
+    CHECK_EQ(busy.start(), BaseSubsystem::RUNNING);
+    waitFor(idle);
+    waitFor(busy);
+    const auto idleFree = idle.stackHighWaterMark();
+    const auto busyFree = busy.stackHighWaterMark();
+    CHECK(idleFree > busyFree);
+    // the buffer goes below whatever the idle path touched
+    CHECK(busyFree <= 4096 - 3072);
+    CHECK(idleFree - busyFree >= 2048);
+    CHECK(busy.recommendedStackSize() > idle.recommendedStackSize());
+    CHECK(idle.stackCanaryIntact());
+    CHECK(busy.stackCanaryIntact());
+    CHECK(ThreadedSubsystem::checkStacks());
+}
+
+}
+
+int main() {
+    testHighWaterMark();
+    printf("stack: ok\n");
+    return 0;
+}
@@ -0,0 +1,189 @@
+#include <Arduino.h>
+#include "check.h"
+#include "statemachine.h"
+
+namespace {
+
+enum class Phase { PAD, BOOST, COAST, DESCENT, LANDED, COUNT };
+enum class Input { LAUNCH, BURNOUT, APOGEE, TOUCHDOWN, COUNT };
+
+struct Flight {
+    bool armed;
+    float altitude;
+    float maxAltitude;
+};
+
+uint32_t timersStarted = 0;
+uint32_t deploys = 0;
+uint32_t falseApogees = 0;
+
+bool armed(const Flight &f) {
+    return f.armed;
+}
+
+bool descending(const Flight &f) {
+    return f.altitude < f.maxAltitude - 5.0f;
+}
+
+void startTimers(Flight &/*f*/) {
+    timersStarted++;
+}
+
+void deploy(Flight &/*f*/) {
+    deploys++;
+}
+
+void falseApogee(Flight &/*f*/) {
+    falseApogees++;
+}
+
+typedef StateMachine<Flight, Phase, Input, 6> FlightMachine;
+
+// competing APOGEE rules in COAST: the guarded one first, the fallback second
+constexpr FlightMachine::Rule rules[] = {
+    {Phase::PAD, Input::LAUNCH, Phase::BOOST, armed, startTimers},
+    {Phase::BOOST, Input::BURNOUT, Phase::COAST, nullptr, nullptr},
+    {Phase::COAST, Input::APOGEE, Phase::DESCENT, descending, deploy},
+    {Phase::COAST, Input::APOGEE, Phase::COAST, nullptr, falseApogee},
+    {Phase::DESCENT, Input::TOUCHDOWN, Phase::LANDED, nullptr, nullptr},
+    {Phase::BOOST, Input::APOGEE, Phase::DESCENT, nullptr, deploy},
+};
+
+// built by the compiler, constexpr fails to compile otherwise
+constexpr auto table = makeTransitionTable(rules);
+
+// lookups follow the rules in declaration order, with guards deciding
+void testTable() {
+    Flight f = {};
+    CHECK(table.find(Phase::PAD, Input::LAUNCH, f) == nullptr);
+    f.armed = true;
+    auto rule = table.find(Phase::PAD, Input::LAUNCH, f);
+    CHECK(rule != nullptr);
+    CHECK(rule->to == Phase::BOOST);
+    CHECK(rule->action == startTimers);
+
+    f.maxAltitude = 100.0f;
+    f.altitude = 99.0f;
+    rule = table.find(Phase::COAST, Input::APOGEE, f);
+    CHECK(rule != nullptr && rule->to == Phase::COAST && rule->action == falseApogee);
+    f.altitude = 90.0f;
+    rule = table.find(Phase::COAST, Input::APOGEE, f);
+    CHECK(rule != nullptr && rule->to == Phase::DESCENT && rule->action == deploy);
+
+    // unhandled, and out of range
+    CHECK(table.find(Phase::PAD, Input::TOUCHDOWN, f) == nullptr);
+    CHECK(table.find(Phase::LANDED, Input::LAUNCH, f) == nullptr);
+    CHECK(table.find(Phase::COUNT, Input::LAUNCH, f) == nullptr);
+    CHECK(table.find(Phase::PAD, Input::COUNT, f) == nullptr);
+}
+
+ReadWriteLock lock;
+DataThing<float> altitude(lock);
+DataThing<bool> arming(lock);
+FlightMachine machine("flight", table, Phase::PAD);
+
+void publish(DataThing<float> &thing, float value) {
+    thing.accessData([](float &data, void *args) {
+        data = *static_cast<float*>(args);
+    }, &value);
+}
+
+MachineState<Phase> published() {
+    MachineState<Phase> out;
+    machine.readData([](const MachineState<Phase> &data, void *args) {
+        *static_cast<MachineState<Phase>*>(args) = data;
+    }, &out);
+    return out;
+}
+
+uint32_t notified = 0;
+
+// any drop below the highest altitude may be apogee, the guard decides
+Input onAltitude(const float &value, Flight &f) {
+    f.altitude = value;
+    f.maxAltitude = value > f.maxAltitude ? value : f.maxAltitude;
+    return f.altitude < f.maxAltitude ? Input::APOGEE : Input::COUNT;
+}
+
+Input onArming(const bool &value, Flight &f) {
+    f.armed = value;
+    return Input::COUNT;
+}
+
+// a flight through the machine: watched inputs feed guards, posted events dispatch on tick()
+void testFlight() {
+    CHECK_EQ(machine.setup(), BaseSubsystem::READY);
+    CHECK(machine.watch(altitude, onAltitude));
+    CHECK(machine.watch(arming, onArming));
+    machine.registerCallback([](const MachineState<Phase> &/*state*/, void */*args*/) {
+        notified++;
+    }, nullptr);
+
+    // not armed: the launch is ignored
+    CHECK(machine.post(Input::LAUNCH));
+    machine.tick();
+    CHECK(machine.state() == Phase::PAD);
+    CHECK_EQ(notified, 0u);
+
+    arming.accessData([](bool &data, void */*args*/) {
+        data = true;
+    }, nullptr);
+    CHECK(machine.post(Input::LAUNCH));
+    CHECK(machine.post(Input::BURNOUT));
+    // events wait for tick()
+    CHECK(machine.state() == Phase::PAD);
+    machine.tick();
+    CHECK(machine.state() == Phase::COAST);
+    CHECK_EQ(timersStarted, 1u);
+    CHECK_EQ(notified, 2u);
+
+    // a dip smaller than the guard's margin is a false apogee, a larger one deploys
+    publish(altitude, 100.0f);
+    publish(altitude, 98.0f);
+    machine.tick();
+    CHECK(machine.state() == Phase::COAST);
+    CHECK_EQ(falseApogees, 1u);
+    publish(altitude, 90.0f);
+    machine.tick();
+    CHECK(machine.state() == Phase::DESCENT);
+    CHECK_EQ(deploys, 1u);
+
+    // unhandled events leave the state and its entry time alone
+    const auto before = published();
+    CHECK(machine.post(Input::LAUNCH));
+    CHECK(machine.post(Input::BURNOUT));
+    machine.tick();
+    CHECK(published().state == Phase::DESCENT);
+    CHECK_EQ(published().transitions, before.transitions);
+    CHECK_EQ(published().enteredMillis, before.enteredMillis);
+
+    CHECK(machine.post(Input::TOUCHDOWN));
+    machine.tick();
+    const auto landed = published();
+    CHECK(landed.state == Phase::LANDED);
+    // launch, burnout, the false apogee, deploy, touchdown
+    CHECK_EQ(landed.transitions, 5u);
+    CHECK_EQ(notified, 5u);
+}
+
+// post() never blocks, a full queue drops
+void testQueueFull() {
+    auto accepted = 0;
+    for (auto i = 0; i < 32; i++) {
+        accepted += machine.post(Input::TOUCHDOWN);
+    }
+    CHECK_EQ(accepted, 16);
+    machine.tick();
+    CHECK(machine.post(Input::TOUCHDOWN));
+    machine.tick();
+}
+
+}
+
+int main() {
+    testTable();
+    testFlight();
+    testQueueFull();
+    printf("statemachine: ok\n");
+    return 0;
+}
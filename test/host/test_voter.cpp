@@ -0,0 +1,101 @@
+#include <Arduino.h>
+#include "check.h"
+#include "voter.h"
+
+namespace {
+
+const uint32_t MAX_AGE = 1000;
+
+void publish(DataThing<float> &thing, float value) {
+    thing.accessData([](float &data, void *args) {
+        data = *static_cast<float*>(args);
+    }, &value);
+}
+
+Voted<float> result(const DataThing<Voted<float>> &voter) {
+    Voted<float> out;
+    voter.readData([](const Voted<float> &data, void *args) {
+        *static_cast<Voted<float>*>(args) = data;
+    }, &out);
+    return out;
+}
+
+// a source updated at an even or odd micros() is fresh right then
+void testTimestamps() {
+    for (const uint32_t now : {1000u, 1001u, 0u, 0xffffffffu}) {
+        ReadWriteLock lock;
+        DataThing<float> source(lock);
+        Voter<float, 3> voter(MAX_AGE, 1.0f);
+        CHECK(voter.attach(source));
+        hostClockSet(now);
+        publish(source, 5.0f);
+        const auto v = result(voter);
+        CHECK_EQ(v.sources, 1);
+        CHECK_EQ(v.fresh, 0x01);
+        CHECK_EQ(v.value, 5.0f);
+        CHECK_EQ(v.timestamp, now);
+    }
+}
+
+void testOneSource() {
+    ReadWriteLock lock;
+    DataThing<float> source(lock);
+    Voter<float, 1> voter(MAX_AGE, 1.0f);
+    CHECK(voter.attach(source));
+    CHECK(!voter.attach(source));
+    hostClockSet(2000);
+    publish(source, 7.0f);
+    CHECK_EQ(result(voter).sources, 1);
+    CHECK_EQ(result(voter).value, 7.0f);
+    hostClockSet(2000 + MAX_AGE);
+    publish(source, 8.0f);
+    CHECK_EQ(result(voter).sources, 1);
+    CHECK_EQ(result(voter).value, 8.0f);
+}
+
+void testVote() {
+    ReadWriteLock lockA, lockB, lockC;
+    DataThing<float> a(lockA), b(lockB), c(lockC);
+    Voter<float, 3> voter(MAX_AGE, 1.0f);
+    CHECK(voter.attach(a));
+    CHECK(voter.attach(b));
+    CHECK(voter.attach(c));
+
+    // stamps across the wrap of micros()
+    hostClockSet(0xffffff00u);
+    publish(a, 10.0f);
+    hostClockSet(0xffffff01u);
+    publish(b, 12.0f);
+    auto v = result(voter);
+    CHECK_EQ(v.sources, 2);
+    CHECK_EQ(v.value, 11.0f);
+    CHECK_EQ(v.disagreeing, 0);
+
+    // mid value select outvotes the faulty one
+    hostClockSet(0x00000100u);
+    publish(c, 50.0f);
+    v = result(voter);
+    CHECK_EQ(v.sources, 3);
+    CHECK_EQ(v.fresh, 0x07);
+    CHECK_EQ(v.value, 12.0f);
+    CHECK_EQ(v.disagreeing, 0x05);
+
+    // a and b go stale
+    hostClockSet(0x00000100u + MAX_AGE);
+    publish(c, 49.0f);
+    v = result(voter);
+    CHECK_EQ(v.sources, 1);
+    CHECK_EQ(v.fresh, 0x04);
+    CHECK_EQ(v.value, 49.0f);
+}
+
+}
+
+int main() {
+    testTimestamps();
+    testOneSource();
+    testVote();
+    hostClockRun();
+    printf("voter: ok\n");
+    return 0;
+}
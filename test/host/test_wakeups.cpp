@@ -0,0 +1,138 @@
+#include <Arduino.h>
+#include <atomic>
+#include "check.h"
+#include "metrics.h"
+#include "subsystem.h"
+
+namespace {
+
+// a periodic subsystem that also waits for data on notification 0, like UartIngest
+class Listener : public ThreadedSubsystem {
+public:
+    Listener() : cycles(0), notified(0) {
+        name = "listener";
+    }
+
+    Status setup() override {
+        setStatus(READY);
+        return READY;
+    }
+
+    using ThreadedSubsystem::setDecimation;
+
+    void dataReady() {
+        xTaskNotifyGive(taskHandle);
+    }
+
+    std::atomic<uint32_t> cycles;
+    std::atomic<uint32_t> notified;
+
+protected:
+    void taskFunction(void */*parameter*/) override {
+        for (;;) {
+            waitForNextCycle(pdMS_TO_TICKS(10));
+            cycles++;
+            if (ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(5))) {
+                notified++;
+            }
+        }
+    }
+};
+
+class Periodic : public ThreadedSubsystem {
+public:
+    Periodic(const char *name, TickType_t period, TickType_t slack) : period(period), slack(slack) {
+        this->name = name;
+    }
+
+    Status setup() override {
+        setStatus(READY);
+        return READY;
+    }
+
+protected:
+    TickType_t wakeSlack() const override {
+        return slack;
+    }
+
+    void taskFunction(void */*parameter*/) override {
+        for (;;) {
+            waitForNextCycle(period);
+        }
+    }
+
+private:
+    const TickType_t period;
+    const TickType_t slack;
+};
+
+Listener listener;
+// with a slot of slack, whatever their start phases, both wake on the slot grid
+Periodic imu("imu", pdMS_TO_TICKS(10), pdMS_TO_TICKS(10));
+Periodic baro("baro", pdMS_TO_TICKS(20), pdMS_TO_TICKS(10));
+
+// resuming a stopped subsystem doesn't leave a notification for the task function's own waits
+void testResumeNotification() {
+    CHECK_EQ(listener.setup(), BaseSubsystem::READY);
+    CHECK_EQ(listener.start(), BaseSubsystem::RUNNING);
+    // after the random start delay of up to 100 ms
+    delay(150);
+    CHECK(listener.cycles > 0);
+
+    // stop and resume before the task gets to see it stopped
+    for (auto i = 0; i < 20; i++) {
+        listener.setDecimation(0);
+        listener.setDecimation(1);
+        delay(7);
+    }
+    delay(50);
+    CHECK_EQ(listener.notified.load(), 0u);
+
+    listener.setDecimation(0);
+    delay(30);
+    const auto stopped = listener.cycles.load();
+    delay(100);
+    CHECK(listener.cycles - stopped <= 1);
+    listener.setDecimation(1);
+    delay(100);
+    CHECK(listener.cycles - stopped >= 5);
+    CHECK_EQ(listener.notified.load(), 0u);
+
+    listener.dataReady();
+    delay(50);
+    CHECK_EQ(listener.notified.load(), 1u);
+}
+
+// subsystems with slack share wakeups, and nextWakeTick() sees them sleep
+void testCoalescing() {
+    const auto shared = static_cast<Counter*>(Metrics.find("subsystem.wakeups.shared"));
+    CHECK(shared != nullptr);
+    const auto before = shared->value();
+    imu.setup();
+    baro.setup();
+    CHECK_EQ(imu.start(), BaseSubsystem::RUNNING);
+    CHECK_EQ(baro.start(), BaseSubsystem::RUNNING);
+    delay(150);
+    TickType_t longest = 0;
+    auto asleep = 0;
+    for (auto i = 0; i < 100; i++) {
+        delay(3);
+        const auto next = ThreadedSubsystem::nextWakeTick();
+        if (next != portMAX_DELAY) {
+            longest = next > longest ? next : longest;
+            asleep++;
+        }
+    }
+    CHECK(asleep >= 90);
+    CHECK(longest <= pdMS_TO_TICKS(20 + 10));
+    CHECK(shared->value() - before > 0);
+}
+
+}
+
+int main() {
+    testResumeNotification();
+    testCoalescing();
+    printf("wakeups: ok\n");
+    return 0;
+}
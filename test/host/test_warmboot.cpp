@@ -0,0 +1,102 @@
+#include <Arduino.h>
+#include <esp_system.h>
+#include "check.h"
+#include "warmboot.h"
+
+namespace {
+
+const uint32_t KEY = WarmBootClass::keyOf("imu");
+const uint16_t VERSION = 2;
+
+struct Calibration {
+    float bias[3];
+    uint32_t boots;
+};
+
+// one boot as SubsystemManager runs it: restore if warm, else set up, then save again;
+// returns the boots count the calibration ended up with, 0 after a full setup
+uint32_t boot(esp_reset_reason_t reason, uint32_t *restores = nullptr) {
+    hostSetResetReason(reason);
+    // a fresh instance, as after a reset, the pool it reads is kept
+    WarmBootClass warmBoot;
+    Calibration calibration = {{0.5f, -0.25f, 1.0f}, 0};
+    const auto saved = static_cast<const Calibration*>(warmBoot.find(KEY, VERSION, sizeof(calibration)));
+    if (saved) {
+        calibration = *saved;
+        calibration.boots++;
+    }
+    warmBoot.clear();
+    auto buf = warmBoot.reserve(KEY, VERSION, sizeof(calibration));
+    CHECK(buf != nullptr);
+    memcpy(buf, &calibration, sizeof(calibration));
+    warmBoot.commit();
+    if (restores) {
+        *restores = warmBoot.restores();
+    }
+    return calibration.boots;
+}
+
+// only unintended resets restore, deliberate ones set up again
+void testResetReasons() {
+    CHECK_EQ(boot(ESP_RST_POWERON), 0u);
+    CHECK_EQ(boot(ESP_RST_TASK_WDT), 1u);
+    CHECK_EQ(boot(ESP_RST_SW), 0u);
+    CHECK_EQ(boot(ESP_RST_BROWNOUT), 1u);
+    CHECK_EQ(boot(ESP_RST_DEEPSLEEP), 0u);
+}
+
+// a pool that fails its CRC or an entry of another layout is not restored
+void testInvalidPool() {
+    boot(ESP_RST_POWERON);
+    hostSetResetReason(ESP_RST_PANIC);
+    WarmBootClass warmBoot;
+    CHECK(warmBoot.isWarm());
+    CHECK(warmBoot.find(KEY, VERSION + 1, sizeof(Calibration)) == nullptr);
+    CHECK(warmBoot.find(KEY, VERSION, sizeof(Calibration) + 4) == nullptr);
+    CHECK(warmBoot.find(WarmBootClass::keyOf("baro"), VERSION, 4) == nullptr);
+    auto entry = static_cast<uint8_t*>(const_cast<void*>(warmBoot.find(KEY, VERSION, sizeof(Calibration))));
+    CHECK(entry != nullptr);
+    entry[0] ^= 1;
+    WarmBootClass afterCorruption;
+    CHECK(!afterCorruption.isWarm());
+}
+
+// a crash that follows every restore falls back to a full setup after WARMBOOT_MAX_RESTORES
+void testBootLoop() {
+    boot(ESP_RST_POWERON);
+    uint32_t restores;
+    for (uint32_t i = 1; i <= WARMBOOT_MAX_RESTORES; i++) {
+        CHECK_EQ(boot(ESP_RST_PANIC, &restores), i);
+        CHECK_EQ(restores, i);
+    }
+    CHECK_EQ(boot(ESP_RST_PANIC, &restores), 0u);
+    CHECK_EQ(restores, 0u);
+    // the state the full setup saved gets its own chances
+    CHECK_EQ(boot(ESP_RST_PANIC), 1u);
+}
+
+// markHealthy() lets resets far apart all restore
+void testMarkHealthy() {
+    boot(ESP_RST_POWERON);
+    for (uint32_t i = 1; i <= 2 * WARMBOOT_MAX_RESTORES; i++) {
+        hostSetResetReason(ESP_RST_INT_WDT);
+        WarmBootClass warmBoot;
+        CHECK(warmBoot.isWarm());
+        CHECK_EQ(warmBoot.restores(), 1u);
+        warmBoot.clear();
+        warmBoot.commit();
+        warmBoot.markHealthy();
+        CHECK_EQ(warmBoot.restores(), 0u);
+    }
+}
+
+}
+
+int main() {
+    testResetReasons();
+    testInvalidPool();
+    testBootLoop();
+    testMarkHealthy();
+    printf("warmboot: ok\n");
+    return 0;
+}